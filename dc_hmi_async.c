@@ -0,0 +1,641 @@
+#include "dc_hmi_internal.h"
+#include <sched.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+// ============================================================================
+// 異步發送佇列
+// ============================================================================
+//
+// 多個線程可以同時提交幀，由一個發送線程寫入串口。
+// 每個優先級一個有界無鎖環形佇列（多生產者、單消費者），以固定大小的單元存放
+// 編碼好的幀，一個幀佔用連續的若干單元：
+//   - 生產者以 CAS 推進 tail 一次認領所需單元，複製數據後設置首單元的
+//     seq = pos + 1 發布
+//   - 發送線程按順序取出已發布的幀，釋放單元時設置 seq = pos + 容量
+// 單元按順序釋放，所以最後一個單元可用即表示整段可用。
+// 提交只有一次 CAS 和一次複製；發送線程空閒時才需要 futex 喚醒。
+//
+// 發送線程每次取幀時先取完 URGENT，再取 NORMAL，BACKGROUND 在 NORMAL 也有積壓時
+// 只能分到 share% 的空間。不同佇列之間不保序，默認除蜂鳴器外都進 NORMAL。
+// 設置了 inflight 時按波特率估算已寫入的數據何時送完，驅動中未送出的數據超過
+// inflight 毫秒才取下一批，緊急幀不會排在驅動緩衝區中的大量數據之後
+// （pty 等不能可靠回報輸出佇列長度的設備同樣適用）。
+//
+// 由多屏管理器接管時（hmi_async_attach）沒有發送線程，由管理器的工作線程
+// 以非阻塞方式寫入（hmi_async_service），生產者改為通知工作線程的 eventfd。
+
+#define ASYNC_CELL_SIZE 32
+#define ASYNC_BACKGROUND_SHARE 25
+
+typedef struct {
+    uint64_t seq;                // pos 表示空閒，pos + 1 表示已發布
+    uint16_t length;             // 幀長度（首單元有效）
+    uint16_t cells;              // 佔用單元數（首單元有效）
+    uint64_t submit_ns;          // 提交時間（首單元有效），用於統計排隊時間
+    uint64_t deadline_ns;        // 超過此時間仍未發出則丟棄，0 表示不過期
+} async_cell_t;
+
+typedef struct {
+    // 生產者共用，單獨佔一條緩存行
+    uint64_t tail __attribute__((aligned(64)));   // 下一個可認領的單元位置
+    uint32_t queued;             // 佇列中的字節數
+
+    uint64_t head __attribute__((aligned(64)));   // 發送線程的讀位置
+    uint64_t drained;            // 已送上線路的單元位置（持 lock 修改）
+    async_cell_t *cells;
+    uint8_t *data;
+    uint64_t mask;               // 單元數 - 1
+} async_ring_t;
+
+struct hmi_async {
+    uint32_t sleeping __attribute__((aligned(64))); // 發送線程正在等待（futex 字）
+    async_ring_t ring[HMI_PRIO_COUNT];
+
+    uint8_t staging[HMI_TX_BUF_SIZE]; // 合併多個幀後一次寫入
+    uint32_t staged;             // staging 中的字節數，發送線程寫完一批後清零
+    uint32_t staged_off;         // staging 中已寫出的字節數（管理器模式）
+    uint32_t share;              // BACKGROUND 在 NORMAL 積壓時可佔的百分比
+    uint32_t inflight_ms;        // 驅動中未送出數據的線路時間上限，0 表示不限制
+    uint64_t wire_end_ns;        // 估算的已寫入數據送完的時間（發送線程使用）
+    int wake_fd;                 // 管理器模式下的喚醒通知，-1 表示使用發送線程
+
+    pthread_t thread;
+    pthread_mutex_t lock;        // 只用於 hmi_async_fence 的等待
+    pthread_cond_t progress;
+    uint32_t fencing;            // 正在等待的 hmi_async_fence 數（持 lock 修改）
+    hmi_controller_t *hmi;
+    int fd;
+    int running;
+    int error;                   // 寫入失敗後置位
+};
+
+// 由 hmi_set_priority 設置，對呼叫線程之後提交的幀生效
+static __thread int tls_priority = HMI_PRIO_AUTO;
+static __thread uint32_t tls_deadline_ms;
+
+static void futex_wait(uint32_t *addr, uint32_t value) {
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static void futex_wake(uint32_t *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+static void async_wake(hmi_async_t *q) {
+    if (__atomic_exchange_n(&q->sleeping, 0, __ATOMIC_SEQ_CST)) {
+        if (q->wake_fd >= 0) {
+            uint64_t one = 1;
+            if (write(q->wake_fd, &one, sizeof(one)) < 0) {
+                // eventfd 計數已滿時工作線程必然會被喚醒
+            }
+        } else {
+            futex_wake(&q->sleeping);
+        }
+    }
+}
+
+static int ring_ready(async_ring_t *r) {
+    async_cell_t *cell = &r->cells[r->head & r->mask];
+    return __atomic_load_n(&cell->seq, __ATOMIC_SEQ_CST) == r->head + 1;
+}
+
+static int async_empty(hmi_async_t *q) {
+    for (int p = 0; p < HMI_PRIO_COUNT; p++) {
+        if (q->ring[p].head != __atomic_load_n(&q->ring[p].tail, __ATOMIC_ACQUIRE)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 宣告消費者即將等待，之後仍有已發布的幀則撤銷並返回 0
+static int async_prepare_sleep(hmi_async_t *q) {
+    __atomic_store_n(&q->sleeping, 1, __ATOMIC_SEQ_CST);
+    for (int p = 0; p < HMI_PRIO_COUNT; p++) {
+        if (ring_ready(&q->ring[p])) {
+            __atomic_store_n(&q->sleeping, 0, __ATOMIC_RELAXED);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 從一個優先級的佇列取出已發布的幀追加到 staging，總長不超過 limit（staging 為空時
+// 至少取一幀），返回新的總長；過期的幀直接丟棄
+static uint32_t ring_collect(hmi_async_t *q, int prio, uint32_t length, uint32_t limit, uint64_t now) {
+    async_ring_t *r = &q->ring[prio];
+    hmi_stats_t *st = q->hmi->stats;
+    uint64_t capacity = r->mask + 1;
+
+    for (;;) {
+        async_cell_t *cell = &r->cells[r->head & r->mask];
+        if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != r->head + 1) {
+            break; // 尚未發布
+        }
+        uint16_t frame_len = cell->length;
+        uint16_t cells = cell->cells;
+        int expired = cell->deadline_ns != 0 && now > cell->deadline_ns;
+        if (!expired && length + frame_len > sizeof(q->staging)) {
+            break;
+        }
+        if (!expired && length > 0 && length + frame_len > limit) {
+            break;
+        }
+
+        if (expired) {
+            if (st) {
+                hmi_stat_bump(&st->prio_expired[prio], 1);
+            }
+        } else {
+            uint64_t offset = (r->head & r->mask) * ASYNC_CELL_SIZE;
+            uint64_t first = capacity * ASYNC_CELL_SIZE - offset;
+            if (first > frame_len) {
+                first = frame_len;
+            }
+            memcpy(q->staging + length, r->data + offset, first);
+            memcpy(q->staging + length + first, r->data, frame_len - first);
+            length += frame_len;
+            if (st) {
+                hmi_stat_bump(&st->prio_frames[prio], 1);
+                hmi_stats_time(st->queue_hist[prio], now - cell->submit_ns);
+            }
+        }
+
+        for (uint16_t i = 0; i < cells; i++) {
+            __atomic_store_n(&r->cells[(r->head + i) & r->mask].seq, r->head + i + capacity, __ATOMIC_RELEASE);
+        }
+        r->head += cells;
+        __atomic_fetch_sub(&r->queued, frame_len, __ATOMIC_RELAXED);
+    }
+    return length;
+}
+
+static uint32_t async_queued(hmi_async_t *q) {
+    uint32_t queued = 0;
+    for (int p = 0; p < HMI_PRIO_COUNT; p++) {
+        queued += __atomic_load_n(&q->ring[p].queued, __ATOMIC_RELAXED);
+    }
+    return queued;
+}
+
+// 按優先級取出已發布的幀放入 staging，返回字節數
+static uint32_t async_collect(hmi_async_t *q) {
+    uint64_t now = hmi_time_ns();
+    uint32_t limit = sizeof(q->staging);
+    if (q->inflight_ms > 0) {
+        uint64_t bytes = (uint64_t)hmi_baud_to_bps((baud_rate_t)q->hmi->baudrate) / 10 * q->inflight_ms / 1000;
+        if (bytes < limit) {
+            limit = bytes;
+        }
+    }
+
+    uint32_t length = ring_collect(q, HMI_PRIO_URGENT, 0, limit, now);
+
+    // BACKGROUND 有積壓時為它保留 share% 的剩餘空間，NORMAL 沒用完的部分也歸它
+    uint32_t left = limit > length ? limit - length : 0;
+    uint32_t reserve = ring_ready(&q->ring[HMI_PRIO_BACKGROUND]) ? (uint64_t)left * q->share / 100 : 0;
+    length = ring_collect(q, HMI_PRIO_NORMAL, length, limit - reserve, now);
+    length = ring_collect(q, HMI_PRIO_BACKGROUND, length, limit, now);
+
+    if (length > 0 && q->hmi->stats) {
+        __atomic_store_n(&q->hmi->stats->queue_depth, async_queued(q), __ATOMIC_RELAXED);
+    }
+    return length;
+}
+
+// 記錄目前為止取出的位置已送上線路，喚醒 hmi_async_fence
+static void async_mark_drained(hmi_async_t *q, const uint64_t *mark) {
+    pthread_mutex_lock(&q->lock);
+    for (int p = 0; p < HMI_PRIO_COUNT; p++) {
+        q->ring[p].drained = mark[p];
+    }
+    pthread_cond_broadcast(&q->progress);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// 標記佇列失敗並喚醒 hmi_async_fence；提交端看到 error 後不再等待空位
+static void async_fail(hmi_async_t *q) {
+    pthread_mutex_lock(&q->lock);
+    __atomic_store_n(&q->error, 1, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&q->progress);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// 驅動中估算的未送出數據超過 inflight 時等待，醒來後再按優先級取幀
+static void async_pace(hmi_async_t *q) {
+    uint64_t now = hmi_time_ns();
+    uint64_t window = (uint64_t)q->inflight_ms * 1000000ULL;
+    if (q->wire_end_ns > now + window) {
+        uint64_t wait = q->wire_end_ns - now - window;
+        struct timespec ts = { (time_t)(wait / 1000000000ULL), (long)(wait % 1000000000ULL) };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void *async_writer_thread(void *arg) {
+    hmi_async_t *q = (hmi_async_t*)arg;
+    int idle = 1;  // 上次 tcdrain 之後沒有新數據
+
+    for (;;) {
+        if (q->inflight_ms > 0) {
+            async_pace(q);
+        }
+        uint32_t length = async_collect(q);
+        if (length > 0) {
+            __atomic_store_n(&q->staged, length, __ATOMIC_RELAXED);   // 寫入期間仍計入 hmi_async_pending
+            uint64_t mark[HMI_PRIO_COUNT];
+            for (int p = 0; p < HMI_PRIO_COUNT; p++) {
+                mark[p] = q->ring[p].head;
+            }
+            uint64_t t0 = hmi_time_ns();
+            int ret = __atomic_load_n(&q->error, __ATOMIC_RELAXED) ? -1 : hmi_write_all(q->fd, q->staging, length);
+            if (ret > 0) {
+                __atomic_fetch_add(&q->hmi->tx_syscalls, ret, __ATOMIC_RELAXED);
+                if (q->hmi->stats) {
+                    hmi_stats_time(q->hmi->stats->write_hist, hmi_time_ns() - t0);
+                }
+                // 8N1 每字節 10 位，線路忙時接在已寫入的數據之後
+                uint64_t start = q->wire_end_ns > t0 ? q->wire_end_ns : t0;
+                q->wire_end_ns = start + (uint64_t)length * 10000000000ULL /
+                                 hmi_baud_to_bps((baud_rate_t)q->hmi->baudrate);
+
+                // 有 hmi_async_fence 在等待時每批寫完就等線路送完並推進標記，
+                // 佇列一直不空也不會讓它等到超時
+                if (__atomic_load_n(&q->fencing, __ATOMIC_ACQUIRE)) {
+                    tcdrain(q->fd);
+                    __atomic_fetch_add(&q->hmi->tx_syscalls, 1, __ATOMIC_RELAXED);
+                    async_mark_drained(q, mark);
+                }
+            } else if (!q->error) {
+                HMI_STAT_ADD(q->hmi, tx_errors, 1);
+                printf("異步發送失敗: %s\n", strerror(errno));
+                async_fail(q);
+            }
+            __atomic_store_n(&q->staged, 0, __ATOMIC_RELAXED);
+            idle = 0;
+            continue;
+        }
+
+        // 佇列已空時才等待線路發送完成
+        if (!idle) {
+            uint64_t mark[HMI_PRIO_COUNT];
+            for (int p = 0; p < HMI_PRIO_COUNT; p++) {
+                mark[p] = q->ring[p].head;
+            }
+            if (!q->error) {
+                tcdrain(q->fd);
+                __atomic_fetch_add(&q->hmi->tx_syscalls, 1, __ATOMIC_RELAXED);
+            }
+            async_mark_drained(q, mark);
+            idle = 1;
+            continue;
+        }
+
+        if (!__atomic_load_n(&q->running, __ATOMIC_ACQUIRE) && async_empty(q)) {
+            break; // 已停止且佇列已空
+        }
+
+        // 先宣告等待再檢查一次，生產者發布後看到 sleeping 會喚醒
+        if (!async_prepare_sleep(q) || !__atomic_load_n(&q->running, __ATOMIC_SEQ_CST)) {
+            __atomic_store_n(&q->sleeping, 0, __ATOMIC_RELAXED);
+            if (!q->running && !async_empty(q)) {
+                sched_yield(); // 停止時仍有生產者在複製
+            }
+            continue;
+        }
+        futex_wait(&q->sleeping, 1);
+    }
+    return NULL;
+}
+
+static void async_destroy(hmi_async_t *q) {
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->progress);
+    for (int p = 0; p < HMI_PRIO_COUNT; p++) {
+        free(q->ring[p].cells);
+        free(q->ring[p].data);
+    }
+    free(q);
+}
+
+static hmi_async_t *async_create(hmi_controller_t *hmi, uint32_t queue_size, int wake_fd) {
+    if (queue_size < HMI_FRAME_MAX) {
+        queue_size = HMI_ASYNC_QUEUE_SIZE;
+    }
+
+    // 每個優先級的單元數取 2 的冪
+    uint64_t capacity = 2;
+    while (capacity * ASYNC_CELL_SIZE < queue_size) {
+        capacity <<= 1;
+    }
+
+    hmi_async_t *q = aligned_alloc(64, sizeof(hmi_async_t));
+    if (!q) {
+        return NULL;
+    }
+    memset(q, 0, sizeof(hmi_async_t));
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&q->progress, &attr);
+    pthread_condattr_destroy(&attr);
+    for (int p = 0; p < HMI_PRIO_COUNT; p++) {
+        async_ring_t *r = &q->ring[p];
+        r->cells = malloc(capacity * sizeof(async_cell_t));
+        r->data = malloc(capacity * ASYNC_CELL_SIZE);
+        if (!r->cells || !r->data) {
+            async_destroy(q);
+            return NULL;
+        }
+        for (uint64_t i = 0; i < capacity; i++) {
+            r->cells[i].seq = i;
+        }
+        r->mask = capacity - 1;
+    }
+    q->hmi = hmi;
+    q->fd = hmi->fd;
+    q->wake_fd = wake_fd;
+    q->share = ASYNC_BACKGROUND_SHARE;
+    q->running = 1;
+    return q;
+}
+
+int hmi_async_start(hmi_controller_t *hmi, uint32_t queue_size) {
+    if (!hmi || !hmi->is_connected) {
+        return -1;
+    }
+    if (hmi->async) {
+        return hmi->async->wake_fd >= 0 ? -1 : 0; // 已由管理器接管
+    }
+
+    hmi_async_t *q = async_create(hmi, queue_size, -1);
+    if (!q) {
+        return -1;
+    }
+    if (pthread_create(&q->thread, NULL, async_writer_thread, q) != 0) {
+        async_destroy(q);
+        return -1;
+    }
+
+    hmi->async = q;
+    return 0;
+}
+
+int hmi_async_stop(hmi_controller_t *hmi) {
+    if (!hmi || !hmi->async || hmi->async->wake_fd >= 0) {
+        return -1;
+    }
+    hmi_async_t *q = hmi->async;
+    hmi_coalesce_stop(hmi);
+
+    // 先讓發送線程送完佇列中剩餘的幀
+    __atomic_store_n(&q->running, 0, __ATOMIC_SEQ_CST);
+    async_wake(q);
+    pthread_join(q->thread, NULL);
+
+    int error = q->error;
+    hmi->async = NULL;
+    async_destroy(q);
+    return error ? -1 : 0;
+}
+
+int hmi_async_schedule(hmi_controller_t *hmi, uint32_t background_share, uint32_t inflight_ms) {
+    if (!hmi || !hmi->async || background_share > 100) {
+        return -1;
+    }
+    hmi_async_t *q = hmi->async;
+    __atomic_store_n(&q->share, background_share ? background_share : ASYNC_BACKGROUND_SHARE, __ATOMIC_RELAXED);
+    __atomic_store_n(&q->inflight_ms, inflight_ms, __ATOMIC_RELAXED);
+    return 0;
+}
+
+void hmi_set_priority(int prio, uint32_t deadline_ms) {
+    tls_priority = prio >= HMI_PRIO_URGENT && prio < HMI_PRIO_COUNT ? prio : HMI_PRIO_AUTO;
+    tls_deadline_ms = deadline_ms;
+}
+
+// 未指定優先級時同一控制器的幀先到先發：清屏、顏色、切換畫面和繪圖互相依賴，
+// 分到不同佇列會讓後提交的狀態幀越過之前的繪圖。只有單獨提交的蜂鳴器幀
+// 不影響畫面，可以插隊；批量緩衝區和合併發送的多個幀一律為 NORMAL
+static int frame_priority(const uint8_t *frame, uint32_t length) {
+    if (tls_priority != HMI_PRIO_AUTO) {
+        return tls_priority;
+    }
+    if (length == 3 + FRAME_TAIL_SIZE && frame[1] == CMD_BUZZER_CONTROL) {
+        return HMI_PRIO_URGENT;
+    }
+    return HMI_PRIO_NORMAL;
+}
+
+int hmi_async_submit(hmi_controller_t *hmi, const uint8_t *frame, uint32_t length) {
+    hmi_async_t *q = hmi->async;
+    async_ring_t *r = &q->ring[frame_priority(frame, length)];
+    uint64_t capacity = r->mask + 1;
+    uint64_t cells = (length + ASYNC_CELL_SIZE - 1) / ASYNC_CELL_SIZE;
+    if (cells == 0 || cells > capacity || length > sizeof(q->staging) ||
+        __atomic_load_n(&q->error, __ATOMIC_RELAXED)) {
+        return -1;
+    }
+
+    // 認領 cells 個連續單元
+    uint64_t pos = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        uint64_t last = pos + cells - 1;
+        uint64_t seq = __atomic_load_n(&r->cells[last & r->mask].seq, __ATOMIC_ACQUIRE);
+        if (seq == last) {
+            if (__atomic_compare_exchange_n(&r->tail, &pos, pos + cells, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+            continue; // pos 已更新為最新的 tail
+        }
+        if ((int64_t)(seq - last) < 0) {
+            // 佇列已滿，等待發送線程騰出空間
+            if (!__atomic_load_n(&q->running, __ATOMIC_RELAXED) || __atomic_load_n(&q->error, __ATOMIC_RELAXED)) {
+                return -1;
+            }
+            sched_yield();
+        }
+        pos = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+    }
+
+    uint64_t offset = (pos & r->mask) * ASYNC_CELL_SIZE;
+    uint64_t first = capacity * ASYNC_CELL_SIZE - offset;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(r->data + offset, frame, first);
+    memcpy(r->data, frame + first, length - first);
+
+    async_cell_t *cell = &r->cells[pos & r->mask];
+    cell->length = length;
+    cell->cells = cells;
+    cell->submit_ns = hmi_time_ns();
+    cell->deadline_ns = tls_deadline_ms ? cell->submit_ns + (uint64_t)tls_deadline_ms * 1000000ULL : 0;
+    __atomic_add_fetch(&r->queued, length, __ATOMIC_RELAXED);
+    if (hmi->stats) {
+        uint64_t depth = async_queued(q);
+        uint64_t peak = __atomic_load_n(&hmi->stats->queue_peak, __ATOMIC_RELAXED);
+        while (depth > peak && !__atomic_compare_exchange_n(&hmi->stats->queue_peak, &peak, depth, 1,
+                                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            // 失敗時 peak 已更新為最新值
+        }
+    }
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&q->sleeping, __ATOMIC_SEQ_CST)) {
+        async_wake(q);
+    }
+    return 0;
+}
+
+int hmi_async_fence(hmi_controller_t *hmi, int timeout_ms) {
+    if (!hmi || !hmi->async) {
+        return 0; // 同步模式下每幀返回時已發送完成
+    }
+    hmi_async_t *q = hmi->async;
+
+    uint64_t deadline_ns = hmi_time_ns() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000000ULL;
+    struct timespec deadline = {
+        .tv_sec = deadline_ns / 1000000000ULL,
+        .tv_nsec = deadline_ns % 1000000000ULL
+    };
+
+    // 等待在此之前認領的所有單元送上線路
+    uint64_t target[HMI_PRIO_COUNT];
+    for (int p = 0; p < HMI_PRIO_COUNT; p++) {
+        target[p] = __atomic_load_n(&q->ring[p].tail, __ATOMIC_ACQUIRE);
+    }
+    int ret = 0;
+    pthread_mutex_lock(&q->lock);
+    __atomic_add_fetch(&q->fencing, 1, __ATOMIC_RELEASE);
+    for (int p = 0; p < HMI_PRIO_COUNT && ret == 0; p++) {
+        while ((int64_t)(q->ring[p].drained - target[p]) < 0 && !__atomic_load_n(&q->error, __ATOMIC_RELAXED)) {
+            if (pthread_cond_timedwait(&q->progress, &q->lock, &deadline) != 0) {
+                ret = -1; // 超時
+                break;
+            }
+        }
+    }
+    __atomic_sub_fetch(&q->fencing, 1, __ATOMIC_RELEASE);
+    if (q->error) {
+        ret = -1;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+uint32_t hmi_async_pending(hmi_controller_t *hmi) {
+    if (!hmi || !hmi->async) {
+        return 0;
+    }
+    hmi_async_t *q = hmi->async;
+    return async_queued(q) +
+           (__atomic_load_n(&q->staged, __ATOMIC_RELAXED) - __atomic_load_n(&q->staged_off, __ATOMIC_RELAXED));
+}
+
+// ============================================================================
+// 管理器模式
+// ============================================================================
+
+int hmi_async_attach(hmi_controller_t *hmi, uint32_t queue_size, int wake_fd) {
+    if (hmi->async) {
+        return -1;
+    }
+    hmi_async_t *q = async_create(hmi, queue_size, wake_fd);
+    if (!q) {
+        return -1;
+    }
+    hmi->async = q;
+    return 0;
+}
+
+void hmi_async_detach(hmi_controller_t *hmi) {
+    hmi_async_t *q = hmi->async;
+    if (!q || q->wake_fd < 0) {
+        return;
+    }
+    hmi_coalesce_stop(hmi);
+
+    // 以阻塞方式送完剩餘數據，之後回到同步模式
+    __atomic_store_n(&q->running, 0, __ATOMIC_SEQ_CST);
+    while (!q->error) {
+        if (q->staged_off == q->staged) {
+            if (async_empty(q)) {
+                break;
+            }
+            q->staged = async_collect(q);
+            q->staged_off = 0;
+            if (q->staged == 0) {
+                sched_yield(); // 仍有生產者在複製
+                continue;
+            }
+        }
+        if (hmi_write_all(q->fd, q->staging + q->staged_off, q->staged - q->staged_off) < 0) {
+            q->error = 1;
+        }
+        q->staged_off = q->staged;
+    }
+    hmi->async = NULL;
+    async_destroy(q);
+}
+
+int hmi_async_service(hmi_controller_t *hmi) {
+    hmi_async_t *q = hmi->async;
+
+    for (;;) {
+        if (q->staged_off == q->staged) {
+            // 上一批已全部交給驅動，每批推進一次標記；管理器模式不呼叫 tcdrain，以免阻塞其他串口
+            uint64_t mark[HMI_PRIO_COUNT];
+            int moved = 0;
+            for (int p = 0; p < HMI_PRIO_COUNT; p++) {
+                mark[p] = q->ring[p].head;
+                moved |= q->ring[p].drained != mark[p];
+            }
+            if (moved) {
+                async_mark_drained(q, mark);
+            }
+
+            uint32_t length = async_collect(q);
+            __atomic_store_n(&q->staged_off, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&q->staged, length, __ATOMIC_RELAXED);
+            if (length == 0) {
+                if (async_prepare_sleep(q)) {
+                    return 0;
+                }
+                continue;
+            }
+        }
+
+        uint64_t t0 = hmi_time_ns();
+        ssize_t n = write(q->fd, q->staging + q->staged_off, q->staged - q->staged_off);
+        __atomic_fetch_add(&hmi->tx_syscalls, 1, __ATOMIC_RELAXED);
+        if (hmi->stats) {
+            hmi_stats_time(hmi->stats->write_hist, hmi_time_ns() - t0);
+        }
+        if (n > 0) {
+            __atomic_fetch_add(&q->staged_off, (uint32_t)n, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno == EAGAIN) {
+            return 1; // 輸出緩衝區已滿，等待可寫
+        }
+        if (!q->error) {
+            HMI_STAT_ADD(hmi, tx_errors, 1);
+            printf("發送失敗: %s\n", strerror(errno));
+        }
+        async_fail(q);
+        return -1;
+    }
+}
+
+void hmi_async_fail(hmi_controller_t *hmi) {
+    if (hmi && hmi->async) {
+        async_fail(hmi->async);
+    }
+}
@@ -0,0 +1,240 @@
+#include "dc_hmi_internal.h"
+
+// ============================================================================
+// 收發抓包
+// ============================================================================
+//
+// 記錄追加到兩個緩衝區中的一個，寫滿（或每秒）交給後台線程寫盤，另一個繼續接收記錄。
+// 收發路徑只做一次加鎖和複製，不等待磁盤；兩個緩衝區都在寫盤時丟棄記錄並計數。
+// 抓包對象在 hmi_close 之前不釋放，停止後其他線程仍可安全地檢查 active。
+
+#define CAP_BUF_SIZE   (64 * 1024)
+#define CAP_FLUSH_MS   1000
+
+struct hmi_capture {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;         // 有緩衝區待寫盤或停止
+    pthread_t thread;
+    int active;
+    int fd;
+    uint64_t start_ns;
+    uint64_t last_ns;            // 已寫入記錄的時間（按微秒累加，不累積誤差）
+    uint8_t *buf[2];
+    uint32_t len[2];
+    int cur;                     // 正在接收記錄的緩衝區
+    int full;                    // 待寫盤的緩衝區，-1 表示沒有
+    uint64_t records;
+    uint64_t dropped;
+    int error;
+};
+
+// 交換緩衝區，由持鎖的呼叫者確認 full 為 -1
+static void cap_swap(hmi_capture_t *cap) {
+    cap->full = cap->cur;
+    cap->cur ^= 1;
+    cap->len[cap->cur] = 0;
+    pthread_cond_signal(&cap->wake);
+}
+
+static void *cap_writer_thread(void *arg) {
+    hmi_capture_t *cap = (hmi_capture_t*)arg;
+
+    pthread_mutex_lock(&cap->lock);
+    for (;;) {
+        if (cap->full < 0 && cap->active) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            ts.tv_sec += CAP_FLUSH_MS / 1000;
+            pthread_cond_timedwait(&cap->wake, &cap->lock, &ts);
+
+            // 定時寫盤，進程異常退出時最多損失一秒的記錄
+            if (cap->full < 0 && cap->len[cap->cur] > 0) {
+                cap_swap(cap);
+            }
+        }
+        if (cap->full < 0) {
+            if (!cap->active) {
+                break;
+            }
+            continue;
+        }
+
+        int index = cap->full;
+        pthread_mutex_unlock(&cap->lock);
+        if (!cap->error && hmi_write_all(cap->fd, cap->buf[index], cap->len[index]) < 0) {
+            cap->error = 1;
+            printf("抓包寫入失敗: %s\n", strerror(errno));
+        }
+        pthread_mutex_lock(&cap->lock);
+        cap->full = -1;
+    }
+    pthread_mutex_unlock(&cap->lock);
+    return NULL;
+}
+
+void hmi_capture_frame(hmi_controller_t *hmi, uint8_t type, uint8_t cmd, const uint8_t *data, uint16_t length) {
+    hmi_capture_t *cap = hmi->capture;
+    uint32_t size = sizeof(hmi_cap_record_t) + length + (type == HMI_CAP_RX ? 1 : 0);
+
+    pthread_mutex_lock(&cap->lock);
+    if (!cap->active) {
+        pthread_mutex_unlock(&cap->lock);
+        return;
+    }
+
+    uint64_t now = hmi_time_ns();
+    uint64_t delta_us = (now - cap->last_ns) / 1000;
+    uint32_t need = size + (delta_us > UINT32_MAX ? sizeof(hmi_cap_record_t) + sizeof(uint64_t) : 0);
+    if (cap->len[cap->cur] + need > CAP_BUF_SIZE) {
+        if (cap->full >= 0 || need > CAP_BUF_SIZE) {
+            cap->dropped++;
+            pthread_mutex_unlock(&cap->lock);
+            return;
+        }
+        cap_swap(cap);
+    }
+
+    uint8_t *dst = cap->buf[cap->cur] + cap->len[cap->cur];
+    if (delta_us > UINT32_MAX) {
+        hmi_cap_record_t mark = { 0, sizeof(uint64_t), HMI_CAP_TIME, 0 };
+        uint64_t offset = now - cap->start_ns;
+        memcpy(dst, &mark, sizeof(mark));
+        memcpy(dst + sizeof(mark), &offset, sizeof(offset));
+        dst += sizeof(mark) + sizeof(offset);
+        cap->last_ns = now;
+        delta_us = 0;
+    }
+
+    // RX 記錄以指令字節開頭，與解析出的幀一致
+    hmi_cap_record_t rec = { (uint32_t)delta_us, size - sizeof(hmi_cap_record_t), type, 0 };
+    memcpy(dst, &rec, sizeof(rec));
+    dst += sizeof(rec);
+    if (type == HMI_CAP_RX) {
+        *dst++ = cmd;
+    }
+    if (length > 0) {
+        memcpy(dst, data, length);
+    }
+
+    cap->len[cap->cur] += need;
+    cap->last_ns += delta_us * 1000;
+    cap->records++;
+    pthread_mutex_unlock(&cap->lock);
+}
+
+int hmi_capture_start(hmi_controller_t *hmi, const char *path) {
+    if (!hmi || !path || !hmi->is_connected) {
+        return -1;
+    }
+
+    hmi_capture_t *cap = hmi->capture;
+    if (!cap) {
+        cap = calloc(1, sizeof(hmi_capture_t));
+        if (!cap) {
+            return -1;
+        }
+        cap->buf[0] = malloc(CAP_BUF_SIZE);
+        cap->buf[1] = malloc(CAP_BUF_SIZE);
+        if (!cap->buf[0] || !cap->buf[1]) {
+            free(cap->buf[0]);
+            free(cap->buf[1]);
+            free(cap);
+            return -1;
+        }
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&cap->wake, &attr);
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_init(&cap->lock, NULL);
+        hmi->capture = cap;
+    } else if (cap->active) {
+        return -1; // 已在抓包
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        printf("無法創建抓包文件 %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct timespec real;
+    clock_gettime(CLOCK_REALTIME, &real);
+    hmi_cap_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HMI_CAP_MAGIC, sizeof(header.magic));
+    header.version = HMI_CAP_VERSION;
+    header.bps = hmi_baud_to_bps(hmi->baudrate);
+    header.start_ns = hmi_time_ns();
+    header.start_unix_ns = (uint64_t)real.tv_sec * 1000000000ULL + real.tv_nsec;
+    snprintf(header.device, sizeof(header.device), "%.63s", hmi->device);
+    if (hmi_write_all(fd, (const uint8_t*)&header, sizeof(header)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    pthread_mutex_lock(&cap->lock);
+    cap->fd = fd;
+    cap->start_ns = header.start_ns;
+    cap->last_ns = header.start_ns;
+    cap->len[0] = cap->len[1] = 0;
+    cap->cur = 0;
+    cap->full = -1;
+    cap->records = 0;
+    cap->dropped = 0;
+    cap->error = 0;
+    cap->active = 1;
+    pthread_mutex_unlock(&cap->lock);
+
+    if (pthread_create(&cap->thread, NULL, cap_writer_thread, cap) != 0) {
+        cap->active = 0;
+        close(fd);
+        return -1;
+    }
+    return 0;
+}
+
+int hmi_capture_stop(hmi_controller_t *hmi) {
+    hmi_capture_t *cap = hmi ? hmi->capture : NULL;
+    if (!cap || !cap->active) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&cap->lock);
+    cap->active = 0;
+    pthread_cond_signal(&cap->wake);
+    pthread_mutex_unlock(&cap->lock);
+    pthread_join(cap->thread, NULL);
+
+    // 寫盤線程只在沒有待寫緩衝區時退出，這裡補上停止前最後一批
+    if (cap->len[cap->cur] > 0 && !cap->error &&
+        hmi_write_all(cap->fd, cap->buf[cap->cur], cap->len[cap->cur]) < 0) {
+        cap->error = 1;
+    }
+    cap->len[cap->cur] = 0;
+    close(cap->fd);
+    cap->fd = -1;
+
+    printf("抓包結束: %llu 條記錄", (unsigned long long)cap->records);
+    if (cap->dropped) {
+        printf("，寫盤不及丟棄 %llu 條", (unsigned long long)cap->dropped);
+    }
+    printf("\n");
+    return cap->error ? -1 : 0;
+}
+
+void hmi_capture_free(hmi_controller_t *hmi) {
+    hmi_capture_t *cap = hmi->capture;
+    if (!cap) {
+        return;
+    }
+    if (cap->active) {
+        hmi_capture_stop(hmi);
+    }
+    pthread_mutex_destroy(&cap->lock);
+    pthread_cond_destroy(&cap->wake);
+    free(cap->buf[0]);
+    free(cap->buf[1]);
+    free(cap);
+    hmi->capture = NULL;
+}
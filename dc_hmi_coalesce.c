@@ -0,0 +1,275 @@
+#include "dc_hmi_internal.h"
+
+// ============================================================================
+// 合併發送
+// ============================================================================
+//
+// 以 (類別, screen_id, control_id) 為鍵的表保存每個控件尚未發出的最新幀，
+// 同一控件的新更新在原位覆蓋舊幀，等待發送的控件按首次變為待發的順序排隊，
+// 發出後即從表中刪除，表的大小只需容納同時待發的控件。
+// 調度線程以令牌桶限速：按 hmi->baudrate（8N1 每字節 10 位）和 share 計算每秒
+// 可發的字節數，按幀長扣除，不足時等待；異步佇列中積壓的數據（其他直接發送
+// 的幀）超過一個突發量時暫停，讓出線路。待發幀數不超過控件數，顯示延遲有上限。
+
+#define COALESCE_DEFAULT_ENTRIES 1024
+#define COALESCE_SHARE           80        // 默認佔用線路的百分比
+#define COALESCE_PROBE           16
+#define COALESCE_TICK_NS         5000000ULL // 令牌不足時的等待間隔
+#define COALESCE_BURST_NS        20000000ULL // 令牌桶容量（按速率折算的時間）
+
+// 可合併的類別：同一控件同一類別只保留最新一幀
+#define CO_VALUE    1            // 控件數值（更新、格式化文本、圖標幀）
+#define CO_FG       2
+#define CO_BG       3
+#define CO_POS      4
+
+typedef struct {
+    hmi_slot_t slot;             // 鍵為 screen_id << 16 | control_id，tag 為 CO_*
+    uint16_t length;
+    uint16_t capacity;
+    uint8_t *frame;
+} coalesce_entry_t;
+
+struct hmi_coalesce {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;         // 有新的待發控件或停止
+    pthread_t thread;
+    hmi_controller_t *hmi;
+    int running;
+    uint32_t share;
+    hmi_table_t table;
+    uint32_t *order;             // 待發序列（槽號環形佇列），每槽最多出現一次
+    uint32_t head;
+    uint32_t count;
+};
+
+int hmi_coalesce_kind(uint8_t sub_cmd) {
+    switch (sub_cmd) {
+        case CMD_UPDATE_CONTROL:
+        case CMD_FORMAT_TEXT:
+        case CMD_ANIM_FRAME:
+            return CO_VALUE;
+        case CMD_SET_FG_COLOR:
+            return CO_FG;
+        case CMD_SET_BK_COLOR:
+            return CO_BG;
+        case CMD_SET_ICON_POS:
+            return CO_POS;
+        default:
+            return 0;
+    }
+}
+
+// 按序取出待發幀放入 buf，總長不超過 limit，持鎖呼叫
+static uint32_t coalesce_collect(hmi_coalesce_t *co, uint8_t *buf, uint32_t size, uint64_t limit,
+                                 uint16_t *lengths, uint32_t *frames) {
+    uint32_t used = 0;
+    *frames = 0;
+    while (co->count > 0) {
+        coalesce_entry_t *e = hmi_table_at(&co->table, co->order[co->head]);
+        if (used + e->length > size || used + e->length > limit) {
+            break;
+        }
+        memcpy(buf + used, e->frame, e->length);
+        used += e->length;
+        lengths[(*frames)++] = e->length;
+        hmi_table_remove(&co->table, e);   // 已發出的控件不再佔用槽位，幀緩衝區留給之後的記錄
+        co->head = (co->head + 1) & co->table.mask;
+        co->count--;
+    }
+    return used;
+}
+
+// 計入統計和抓包後交給異步佇列
+static int coalesce_submit(hmi_controller_t *hmi, const uint8_t *buf, uint32_t length, const uint16_t *lengths,
+                           uint32_t frames) {
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < frames; i++) {
+        hmi_stats_tx(hmi, buf + offset, lengths[i]);
+        if (hmi->capture) {
+            hmi_capture_frame(hmi, HMI_CAP_TX, 0, buf + offset, lengths[i]);
+        }
+        offset += lengths[i];
+    }
+    return hmi_async_submit(hmi, buf, length);
+}
+
+static void *coalesce_thread(void *arg) {
+    hmi_coalesce_t *co = (hmi_coalesce_t*)arg;
+    hmi_controller_t *hmi = co->hmi;
+    uint8_t buf[HMI_TX_BUF_SIZE];
+    uint16_t lengths[HMI_TX_BUF_SIZE / 11];   // 最短的控件幀為 11 字節
+    uint32_t frames;
+    double tokens = 0;
+    uint64_t last = hmi_time_ns();
+
+    for (;;) {
+        pthread_mutex_lock(&co->lock);
+        while (co->running && co->count == 0) {
+            pthread_cond_wait(&co->wake, &co->lock);
+        }
+        if (!co->running) {
+            // 停止時不再限速，剩餘的更新全部交給異步佇列
+            uint32_t length;
+            while ((length = coalesce_collect(co, buf, sizeof(buf), UINT64_MAX, lengths, &frames)) > 0) {
+                coalesce_submit(hmi, buf, length, lengths, frames);
+            }
+            pthread_mutex_unlock(&co->lock);
+            break;
+        }
+        pthread_mutex_unlock(&co->lock);
+
+        // 速率在每次補充令牌時重新讀取，hmi_set_baudrate 之後自動生效
+        double rate = hmi_baud_to_bps((baud_rate_t)hmi->baudrate) / 10.0 * co->share / 100.0;
+        double burst = rate * COALESCE_BURST_NS / 1e9;
+        if (burst < HMI_FRAME_MAX) {
+            burst = HMI_FRAME_MAX;
+        }
+        uint64_t now = hmi_time_ns();
+        tokens += (now - last) / 1e9 * rate;
+        if (tokens > burst) {
+            tokens = burst;
+        }
+        last = now;
+
+        uint32_t length = 0;
+        if (hmi_async_pending(hmi) <= burst) {
+            pthread_mutex_lock(&co->lock);
+            length = coalesce_collect(co, buf, sizeof(buf), (uint64_t)tokens, lengths, &frames);
+            pthread_mutex_unlock(&co->lock);
+        }
+        if (length == 0) {
+            struct timespec ts = { 0, COALESCE_TICK_NS };
+            nanosleep(&ts, NULL);
+            continue;
+        }
+        tokens -= length;
+        coalesce_submit(hmi, buf, length, lengths, frames);
+    }
+    return NULL;
+}
+
+int hmi_coalesce_start(hmi_controller_t *hmi, uint32_t entries, uint32_t share) {
+    if (!hmi || !hmi->async || hmi->coalesce) {
+        return -1;
+    }
+    if (entries == 0) {
+        entries = COALESCE_DEFAULT_ENTRIES;
+    }
+    if (share == 0 || share > 100) {
+        share = COALESCE_SHARE;
+    }
+
+    hmi_coalesce_t *co = calloc(1, sizeof(hmi_coalesce_t));
+    if (!co) {
+        return -1;
+    }
+    if (hmi_table_init(&co->table, entries, sizeof(coalesce_entry_t), COALESCE_PROBE) < 0) {
+        free(co);
+        return -1;
+    }
+    co->order = malloc((co->table.mask + 1) * sizeof(uint32_t));   // 待發序列最長為槽數
+    if (!co->order) {
+        hmi_table_free(&co->table);
+        free(co);
+        return -1;
+    }
+    co->hmi = hmi;
+    co->share = share;
+    co->running = 1;
+    pthread_mutex_init(&co->lock, NULL);
+    pthread_cond_init(&co->wake, NULL);
+
+    if (pthread_create(&co->thread, NULL, coalesce_thread, co) != 0) {
+        pthread_mutex_destroy(&co->lock);
+        pthread_cond_destroy(&co->wake);
+        hmi_table_free(&co->table);
+        free(co->order);
+        free(co);
+        return -1;
+    }
+    hmi->coalesce = co;
+    return 0;
+}
+
+int hmi_coalesce_stop(hmi_controller_t *hmi) {
+    hmi_coalesce_t *co = hmi ? hmi->coalesce : NULL;
+    if (!co) {
+        return -1;
+    }
+    hmi->coalesce = NULL;
+
+    pthread_mutex_lock(&co->lock);
+    co->running = 0;
+    pthread_cond_signal(&co->wake);
+    pthread_mutex_unlock(&co->lock);
+    pthread_join(co->thread, NULL);
+
+    for (uint32_t i = 0; i <= co->table.mask; i++) {
+        free(((coalesce_entry_t*)hmi_table_at(&co->table, i))->frame);
+    }
+    pthread_mutex_destroy(&co->lock);
+    pthread_cond_destroy(&co->wake);
+    hmi_table_free(&co->table);
+    free(co->order);
+    free(co);
+    return 0;
+}
+
+uint32_t hmi_coalesce_pending(hmi_controller_t *hmi) {
+    hmi_coalesce_t *co = hmi ? hmi->coalesce : NULL;
+    if (!co) {
+        return 0;
+    }
+    pthread_mutex_lock(&co->lock);
+    uint32_t count = co->count;
+    pthread_mutex_unlock(&co->lock);
+    return count;
+}
+
+int hmi_coalesce_put(hmi_controller_t *hmi, int kind, const uint8_t *frame, uint16_t length) {
+    hmi_coalesce_t *co = hmi->coalesce;
+    uint32_t key = ((uint32_t)frame[3] << 24) | ((uint32_t)frame[4] << 16) | ((uint32_t)frame[5] << 8) | frame[6];
+
+    pthread_mutex_lock(&co->lock);
+    int created;
+    coalesce_entry_t *e = hmi_table_find(&co->table, key, (uint8_t)kind, HMI_TABLE_CREATE, &created);
+    if (!e) {
+        // 表已滿，這一幀不合併，直接交給異步佇列
+        pthread_mutex_unlock(&co->lock);
+        goto direct;
+    }
+    if (length > e->capacity) {
+        uint8_t *grown = realloc(e->frame, length);
+        if (!grown) {
+            if (created) {
+                hmi_table_remove(&co->table, e);
+            }
+            pthread_mutex_unlock(&co->lock);
+            goto direct;
+        }
+        e->frame = grown;
+        e->capacity = length;
+    }
+
+    memcpy(e->frame, frame, length);
+    e->length = length;
+    if (!created) {
+        pthread_mutex_unlock(&co->lock);
+        HMI_STAT_ADD(hmi, coalesced, 1);   // 覆蓋了尚未發出的舊值
+        return 0;
+    }
+    co->order[(co->head + co->count) & co->table.mask] = hmi_table_index(&co->table, e);
+    if (co->count++ == 0) {
+        pthread_cond_signal(&co->wake);
+    }
+    pthread_mutex_unlock(&co->lock);
+    return 0;
+
+direct:
+    hmi_stats_tx(hmi, frame, length);
+    if (hmi->capture) {
+        hmi_capture_frame(hmi, HMI_CAP_TX, 0, frame, length);
+    }
+    return hmi_async_submit(hmi, frame, length);
+}
@@ -1,9 +1,11 @@
-#include "dc_hmi_controller.h"
+#include "dc_hmi_internal.h"
+#include <poll.h>
 
 // 內部函數聲明
-static int set_serial_params(int fd, baud_rate_t baudrate);
-static uint32_t get_baud_value(baud_rate_t baudrate);
+static int set_serial_params(int fd, uint32_t bps);
 static void build_command_frame(uint8_t *frame, uint8_t cmd, uint8_t *data, uint16_t data_len, uint16_t *frame_len);
+static int rx_fill(hmi_controller_t *hmi, int wait_ms);
+static int send_frames(hmi_controller_t *hmi, const uint8_t *data, uint32_t length);
 
 // ============================================================================
 // 基本串口操作
@@ -15,6 +17,9 @@ int hmi_init(hmi_controller_t *hmi, const char *device, baud_rate_t baudrate) {
     }
 
     memset(hmi, 0, sizeof(hmi_controller_t));
+    if (hmi_stats_init(hmi) < 0) {
+        return -1;
+    }
     strncpy(hmi->device, device, sizeof(hmi->device) - 1);
     hmi->baudrate = baudrate;
     hmi->fg_color = COLOR_WHITE;
@@ -24,12 +29,14 @@ int hmi_init(hmi_controller_t *hmi, const char *device, baud_rate_t baudrate) {
     hmi->fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY);
     if (hmi->fd < 0) {
         printf("無法打開串口設備: %s, 錯誤: %s\n", device, strerror(errno));
+        hmi_stats_free(hmi);
         return -1;
     }
 
     // 設置串口參數
-    if (set_serial_params(hmi->fd, baudrate) < 0) {
+    if (set_serial_params(hmi->fd, hmi_baud_to_bps(baudrate)) < 0) {
         close(hmi->fd);
+        hmi_stats_free(hmi);
         return -1;
     }
 
@@ -49,8 +56,35 @@ int hmi_init(hmi_controller_t *hmi, const char *device, baud_rate_t baudrate) {
     return 0;
 }
 
+int hmi_init_fast(hmi_controller_t *hmi, const char *device, baud_rate_t safe, baud_rate_t fastest) {
+    if (hmi_init(hmi, device, safe) < 0) {
+        return -1;
+    }
+    if (hmi_upgrade_baudrate(hmi, fastest) == 0) {
+        return 0;
+    }
+
+    // 沒有切換：確認串口屏在安全速率上仍能響應，否則鏈路已不可用
+    if (hmi_handshake(hmi) < 0) {
+        printf("錯誤: 串口屏在 %u bps 上無響應\n", hmi_baud_to_bps(hmi->baudrate));
+        hmi_close(hmi);
+        return -1;
+    }
+    return 1;
+}
+
 void hmi_close(hmi_controller_t *hmi) {
     if (hmi && hmi->fd >= 0) {
+        hmi_flush(hmi);
+        if (hmi->async) {
+            hmi_async_stop(hmi);
+        }
+        hmi_dispatch_free(hmi);
+        hmi_capture_free(hmi);
+        hmi_shadow_free(hmi);
+        hmi_mirror_free(hmi);
+        hmi_drawlist_free(hmi);
+        hmi_stats_free(hmi);
         close(hmi->fd);
         hmi->fd = -1;
         hmi->is_connected = 0;
@@ -58,7 +92,7 @@ void hmi_close(hmi_controller_t *hmi) {
     }
 }
 
-static int set_serial_params(int fd, baud_rate_t baudrate) {
+static int set_serial_params(int fd, uint32_t bps) {
     struct termios options;
     
     if (tcgetattr(fd, &options) < 0) {
@@ -66,11 +100,6 @@ static int set_serial_params(int fd, baud_rate_t baudrate) {
         return -1;
     }
 
-    // 設置波特率
-    uint32_t baud_value = get_baud_value(baudrate);
-    cfsetispeed(&options, baud_value);
-    cfsetospeed(&options, baud_value);
-
     // 設置數據位、停止位、奇偶校驗
     options.c_cflag &= ~PARENB;   // 無奇偶校驗
     options.c_cflag &= ~CSTOPB;   // 1位停止位
@@ -80,7 +109,8 @@ static int set_serial_params(int fd, baud_rate_t baudrate) {
 
     // 設置輸入模式
     options.c_iflag &= ~(IXON | IXOFF | IXANY); // 禁用軟件流控
-    options.c_iflag &= ~(ICANON | ECHO | ECHOE | ISIG); // 原始輸入
+    options.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL); // 不轉換二進制數據
+    options.c_lflag &= ~(ICANON | ECHO | ECHOE | ECHONL | ISIG | IEXTEN); // 原始輸入
 
     // 設置輸出模式
     options.c_oflag &= ~OPOST; // 原始輸出
@@ -94,21 +124,98 @@ static int set_serial_params(int fd, baud_rate_t baudrate) {
         return -1;
     }
 
+    // 設置波特率（termios2，支持 1M/2M 等高速率）
+    if (hmi_serial_set_speed(fd, bps) < 0) {
+        printf("不支持的波特率: %u\n", bps);
+        return -1;
+    }
+
     return 0;
 }
 
-static uint32_t get_baud_value(baud_rate_t baudrate) {
+uint32_t hmi_baud_to_bps(baud_rate_t baudrate) {
     switch (baudrate) {
-        case BAUD_1200: return B1200;
-        case BAUD_2400: return B2400;
-        case BAUD_4800: return B4800;
-        case BAUD_9600: return B9600;
-        case BAUD_19200: return B19200;
-        case BAUD_38400: return B38400;
-        case BAUD_57600: return B57600;
-        case BAUD_115200: return B115200;
-        default: return B9600;
+        case BAUD_1200: return 1200;
+        case BAUD_2400: return 2400;
+        case BAUD_4800: return 4800;
+        case BAUD_9600: return 9600;
+        case BAUD_19200: return 19200;
+        case BAUD_38400: return 38400;
+        case BAUD_57600: return 57600;
+        case BAUD_115200: return 115200;
+        case BAUD_1M: return 1000000;
+        case BAUD_2M: return 2000000;
+        default: return 9600;
+    }
+}
+
+int hmi_bps_to_baud(uint32_t bps) {
+    for (int baud = BAUD_1200; baud <= BAUD_2M; baud++) {
+        if (hmi_baud_to_bps(baud) == bps) {
+            return baud;
+        }
+    }
+    return -1;
+}
+
+// ============================================================================
+// 鏈路速率協商
+// ============================================================================
+
+int hmi_set_line_bps(hmi_controller_t *hmi, uint32_t bps) {
+    if (!hmi || !hmi->is_connected) {
+        return -1;
+    }
+    if (set_serial_params(hmi->fd, bps) < 0) {
+        return -1;
     }
+    // 舊速率下殘留的數據已無意義
+    tcflush(hmi->fd, TCIOFLUSH);
+    hmi_parser_reset(&hmi->rx);
+    return 0;
+}
+
+// 通知串口屏切換速率，主機端跟隨切換後握手確認
+static int switch_baudrate(hmi_controller_t *hmi, baud_rate_t baudrate) {
+    if (hmi_set_baudrate(hmi, baudrate) < 0 || hmi_async_fence(hmi, 1000) < 0) {
+        return -1;
+    }
+    hmi_delay_ms(50); // 等待串口屏切換
+    if (hmi_set_line_bps(hmi, hmi_baud_to_bps(baudrate)) < 0) {
+        return -1;
+    }
+    return hmi_handshake(hmi);
+}
+
+int hmi_upgrade_baudrate(hmi_controller_t *hmi, baud_rate_t fastest) {
+    if (!hmi || !hmi->is_connected || hmi_rx_threaded(hmi)) {
+        return -1;
+    }
+    baud_rate_t safe = hmi->baudrate;
+    if (hmi_handshake(hmi) < 0) {
+        return -1; // 串口屏未響應，不嘗試切換
+    }
+
+    // 從最高速率開始嘗試，USB 轉接器或線纜不支持時逐級降低
+    for (int rate = fastest; rate > (int)safe; rate--) {
+        if (switch_baudrate(hmi, rate) == 0) {
+            hmi->baudrate = rate;
+            printf("鏈路速率已切換到 %u bps\n", hmi_baud_to_bps(rate));
+            return 0;
+        }
+
+        // 串口屏可能已經切換，以該速率通知它退回，再回到安全速率
+        hmi_set_line_bps(hmi, hmi_baud_to_bps(rate));
+        if (switch_baudrate(hmi, safe) < 0) {
+            hmi_set_line_bps(hmi, hmi_baud_to_bps(safe));
+            if (hmi_handshake(hmi) < 0) {
+                printf("警告: 速率協商後無法恢復連接\n");
+                return -1;
+            }
+        }
+    }
+    printf("鏈路速率保持 %u bps\n", hmi_baud_to_bps(safe));
+    return -1;
 }
 
 int hmi_send_command(hmi_controller_t *hmi, uint8_t *cmd, uint16_t length) {
@@ -116,17 +223,186 @@ int hmi_send_command(hmi_controller_t *hmi, uint8_t *cmd, uint16_t length) {
         return -1;
     }
 
-    int bytes_written = write(hmi->fd, cmd, length);
-    if (bytes_written != length) {
-        printf("發送指令失敗, 期望: %d, 實際: %d\n", length, bytes_written);
+    // 批量模式：追加到發送緩衝區，滿了先送出
+    uint8_t *dst = hmi_tx_reserve(hmi, length);
+    if (dst) {
+        memcpy(dst, cmd, length);
+        return hmi_tx_commit(hmi, length);
+    }
+
+    if (hmi->tx_len > 0 && hmi_tx_push(hmi) < 0) {
+        return -1;
+    }
+    hmi_stats_tx(hmi, cmd, length);
+    if (hmi->capture) {
+        hmi_capture_frame(hmi, HMI_CAP_TX, 0, cmd, length);
+    }
+
+    return send_frames(hmi, cmd, length);
+}
+
+// 可合併的控件更新幀在之後不再追加時才計入統計和抓包
+static void tx_seal(hmi_controller_t *hmi) {
+    if (hmi->tx_merge_end != 0 && hmi->tx_merge_end == hmi->tx_len) {
+        uint8_t *frame = hmi->tx_buf + hmi->tx_merge;
+        uint16_t length = hmi->tx_merge_end - hmi->tx_merge;
+        hmi_stats_tx(hmi, frame, length);
+        if (hmi->capture) {
+            hmi_capture_frame(hmi, HMI_CAP_TX, 0, frame, length);
+        }
+    }
+    hmi->tx_merge_end = 0;
+}
+
+uint8_t *hmi_tx_reserve(hmi_controller_t *hmi, uint16_t length) {
+    if (!hmi->tx_corked || length > HMI_TX_BUF_SIZE) {
+        return NULL;
+    }
+    tx_seal(hmi);
+    if (hmi->tx_len + length > HMI_TX_BUF_SIZE && hmi_tx_push(hmi) < 0) {
+        return NULL;
+    }
+    return hmi->tx_buf + hmi->tx_len;
+}
+
+int hmi_tx_commit(hmi_controller_t *hmi, uint16_t length) {
+    uint8_t *frame = hmi->tx_buf + hmi->tx_len;
+    hmi_stats_tx(hmi, frame, length);
+    if (hmi->capture) {
+        hmi_capture_frame(hmi, HMI_CAP_TX, 0, frame, length);
+    }
+    hmi->tx_len += length;
+    return 0;
+}
+
+// 更新幀: EE B1 10 screen(2) control(2) 數據 FF FC FF FF
+// 批量幀: EE B1 12 screen(2) { control(2) 長度(2) 數據 }... FF FC FF FF
+int hmi_tx_update(hmi_controller_t *hmi, const uint8_t *frame, uint16_t length) {
+    static const uint8_t tail[] = FRAME_TAIL;
+    uint16_t value_len = length - 11;
+
+    if (hmi->tx_merge_end != 0 && hmi->tx_merge_end == hmi->tx_len) {
+        uint8_t *last = hmi->tx_buf + hmi->tx_merge;
+        uint16_t last_len = hmi->tx_merge_end - hmi->tx_merge;
+        uint16_t grow = (last[2] == CMD_UPDATE_CONTROL ? 2 : 0) + 4 + value_len;
+
+        // 同一畫面且合併後不超過單幀上限，否則另起一幀
+        if (last[3] == frame[3] && last[4] == frame[4] && last_len + grow <= HMI_FRAME_MAX &&
+            hmi->tx_len + grow <= HMI_TX_BUF_SIZE) {
+            uint8_t *end = hmi->tx_buf + hmi->tx_len - FRAME_TAIL_SIZE;
+            if (last[2] == CMD_UPDATE_CONTROL) {
+                // 第二個更新到來時把單個更新改寫為批量格式，只有一個更新時保持原樣
+                uint16_t first_len = last_len - 11;
+                memmove(last + 9, last + 7, first_len);
+                last[2] = CMD_BATCH_UPDATE;
+                last[7] = first_len >> 8;
+                last[8] = first_len & 0xFF;
+                end += 2;
+            }
+            end[0] = frame[5];
+            end[1] = frame[6];
+            end[2] = value_len >> 8;
+            end[3] = value_len & 0xFF;
+            memcpy(end + 4, frame + 7, value_len);
+            memcpy(end + 4 + value_len, tail, FRAME_TAIL_SIZE);
+            hmi->tx_len += grow;
+            hmi->tx_merge_end = hmi->tx_len;
+            return 0;
+        }
+    }
+
+    uint8_t *dst = hmi_tx_reserve(hmi, length);
+    if (!dst) {
+        return hmi_send_command(hmi, (uint8_t*)frame, length);
+    }
+    memcpy(dst, frame, length);
+    hmi->tx_merge = hmi->tx_len;
+    hmi->tx_len += length;
+    hmi->tx_merge_end = hmi->tx_len;
+    return 0;
+}
+
+// 把數據交給發送佇列或直接寫入串口
+static int send_frames(hmi_controller_t *hmi, const uint8_t *data, uint32_t length) {
+    // 異步模式：放入佇列後立即返回
+    if (hmi->async) {
+        return hmi_async_submit(hmi, data, length);
+    }
+
+    uint64_t t0 = hmi_time_ns();
+    int calls = hmi_write_all(hmi->fd, data, length);
+    if (hmi->stats) {
+        hmi_stats_time(hmi->stats->write_hist, hmi_time_ns() - t0);
+    }
+    if (calls < 0) {
+        HMI_STAT_ADD(hmi, tx_errors, 1);
+        printf("發送指令失敗, 長度: %u, 錯誤: %s\n", length, strerror(errno));
         return -1;
     }
 
     // 確保數據發送完成
     tcdrain(hmi->fd);
+    hmi->tx_syscalls += calls + 1;
+    return 0;
+}
+
+// ============================================================================
+// 批量發送
+// ============================================================================
+
+int hmi_begin_batch(hmi_controller_t *hmi) {
+    if (!hmi || !hmi->is_connected) {
+        return -1;
+    }
+    hmi->tx_corked = 1;
     return 0;
 }
 
+int hmi_flush(hmi_controller_t *hmi) {
+    if (!hmi) {
+        return -1;
+    }
+    hmi->tx_corked = 0;
+    return hmi_tx_push(hmi);
+}
+
+int hmi_tx_push(hmi_controller_t *hmi) {
+    tx_seal(hmi);
+    if (hmi->tx_len == 0) {
+        return 0;
+    }
+    uint16_t length = hmi->tx_len;
+    hmi->tx_len = 0;
+    return send_frames(hmi, hmi->tx_buf, length);
+}
+
+int hmi_write_all(int fd, const uint8_t *data, uint32_t length) {
+    uint32_t written = 0;
+    int calls = 0;
+
+    while (written < length) {
+        ssize_t n = write(fd, data + written, length - written);
+        calls++;
+        if (n > 0) {
+            written += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN) {
+            return -1;
+        }
+
+        // 串口以非阻塞方式打開，輸出緩衝區滿時等待可寫
+        struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+        if (poll(&pfd, 1, 1000) <= 0) {
+            return -1;
+        }
+    }
+    return calls;
+}
+
 int hmi_send_data(hmi_controller_t *hmi, uint8_t cmd, uint8_t *data, uint16_t length) {
     uint8_t frame[1024];
     uint16_t frame_len;
@@ -135,72 +411,165 @@ int hmi_send_data(hmi_controller_t *hmi, uint8_t cmd, uint8_t *data, uint16_t le
     return hmi_send_command(hmi, frame, frame_len);
 }
 
-int hmi_receive_response(hmi_controller_t *hmi, hmi_response_t *response, int timeout_ms) {
+int hmi_receive_view(hmi_controller_t *hmi, hmi_response_t *response, int timeout_ms) {
     if (!hmi || !response || !hmi->is_connected) {
         return -1;
     }
 
-    uint8_t buffer[1024];
-    int bytes_read = 0;
-    time_t start_time = time(NULL);
+    // 接收線程獨佔串口，改為等待它分發的下一個幀
+    if (hmi_rx_threaded(hmi)) {
+        hmi_match_t any = { -1, -1, -1, -1 };
+        return hmi_expect_view(hmi, &any, response, timeout_ms);
+    }
 
-    while ((time(NULL) - start_time) * 1000 < timeout_ms) {
-        int n = read(hmi->fd, buffer + bytes_read, sizeof(buffer) - bytes_read);
-        if (n > 0) {
-            bytes_read += n;
-            
-            // 檢查是否收到完整幀
-            if (bytes_read >= 6) { // 最小幀長度
-                if (buffer[0] == FRAME_HEADER && 
-                    buffer[bytes_read-4] == 0xFF && buffer[bytes_read-3] == 0xFC &&
-                    buffer[bytes_read-2] == 0xFF && buffer[bytes_read-1] == 0xFF) {
-                    
-                    response->cmd = buffer[1];
-                    response->length = bytes_read - 6; // 除去幀頭和幀尾
-                    if (response->length > 0) {
-                        response->data = malloc(response->length);
-                        memcpy(response->data, buffer + 2, response->length);
-                    } else {
-                        response->data = NULL;
-                    }
-                    return 0;
-                }
+    // 等待回應前先送出批量緩衝區中的請求
+    if (hmi->tx_len > 0 && hmi_tx_push(hmi) < 0) {
+        return -1;
+    }
+
+    // 以單調時鐘計算毫秒級截止時間
+    uint64_t deadline = hmi_time_ns() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000000ULL;
+    int last_read = 0;
+
+    for (;;) {
+        if (hmi_parser_next(&hmi->rx, response) == 0) {
+            hmi_stats_rx(hmi, response);
+            if (hmi->shadow) {
+                hmi_shadow_rx(hmi, response);
+            }
+            if (hmi->mirror) {
+                hmi_mirror_rx(hmi, response);
+            }
+            if (hmi->capture) {
+                hmi_capture_frame(hmi, HMI_CAP_RX, response->cmd, response->data, response->length);
+            }
+            return 0;
+        }
+
+        // 到期後再不等待地讀取一次，timeout 為 0 時也能取到已到達串口的數據
+        uint64_t now = hmi_time_ns();
+        if (now >= deadline) {
+            if (last_read) {
+                break;
             }
+            last_read = 1;
+        }
+
+        // 等待數據到達，無數據時不佔用CPU
+        int wait_ms = now < deadline ? (int)((deadline - now + 999999ULL) / 1000000ULL) : 0;
+        if (rx_fill(hmi, wait_ms) < 0) {
+            return -1;
         }
-        usleep(1000); // 1ms延遲
     }
 
     return -1; // 超時
 }
 
-static void build_command_frame(uint8_t *frame, uint8_t cmd, uint8_t *data, uint16_t data_len, uint16_t *frame_len) {
-    uint8_t tail[] = FRAME_TAIL;
-    
-    frame[0] = FRAME_HEADER;
-    frame[1] = cmd;
-    
-    uint16_t pos = 2;
-    if (data && data_len > 0) {
-        memcpy(frame + pos, data, data_len);
-        pos += data_len;
+int hmi_receive_cmd(hmi_controller_t *hmi, uint8_t cmd, hmi_response_t *response, int timeout_ms) {
+    if (hmi && hmi_rx_threaded(hmi)) {
+        hmi_match_t match = { cmd, -1, -1, -1 };
+        return hmi_expect_view(hmi, &match, response, timeout_ms);
+    }
+
+    uint64_t deadline = hmi_time_ns() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000000ULL;
+
+    // 不相關的幀（例如夾在回應前的觸摸事件）交給事件訂閱
+    for (;;) {
+        uint64_t now = hmi_time_ns();
+        int remaining = now < deadline ? (int)((deadline - now + 999999ULL) / 1000000ULL) : 0;
+        if (hmi_receive_view(hmi, response, remaining) < 0) {
+            HMI_STAT_ADD(hmi, timeouts, 1);
+            return -1;
+        }
+        if (response->cmd == cmd) {
+            return 0;
+        }
+        hmi_dispatch_frame(hmi, response);
     }
-    
-    memcpy(frame + pos, tail, FRAME_TAIL_SIZE);
-    pos += FRAME_TAIL_SIZE;
-    
-    *frame_len = pos;
 }
 
-// 這個函數已被直接的幀構建方式替代，但保留以備將來使用
-#if 0
-static void build_config_frame(uint8_t *frame, uint8_t sub_cmd, uint8_t *data, uint16_t data_len, uint16_t *frame_len) {
+int hmi_receive_into(hmi_controller_t *hmi, hmi_response_t *response, uint8_t *buffer, uint16_t size,
+                     int timeout_ms) {
+    hmi_response_t view;
+    if (hmi_receive_view(hmi, &view, timeout_ms) < 0) {
+        return -1;
+    }
+    if (view.length > size) {
+        return -1; // 緩衝區不足，幀已丟棄
+    }
+
+    response->cmd = view.cmd;
+    response->length = view.length;
+    response->data = view.length > 0 ? buffer : NULL;
+    if (view.length > 0) {
+        memcpy(buffer, view.data, view.length);
+    }
+    return 0;
+}
+
+int hmi_receive_response(hmi_controller_t *hmi, hmi_response_t *response, int timeout_ms) {
+    hmi_response_t view;
+    if (hmi_receive_view(hmi, &view, timeout_ms) < 0) {
+        if (hmi && hmi->is_connected && !hmi_rx_threaded(hmi)) {
+            HMI_STAT_ADD(hmi, timeouts, 1); // 接收線程模式下已在等待時計入
+        }
+        return -1;
+    }
+
+    // 兼容舊接口：數據複製到堆上，由呼叫者釋放
+    response->cmd = view.cmd;
+    response->length = view.length;
+    response->data = NULL;
+    if (view.length > 0) {
+        response->data = malloc(view.length);
+        if (!response->data) {
+            return -1;
+        }
+        memcpy(response->data, view.data, view.length);
+    }
+    return 0;
+}
+
+// 等待串口可讀並把數據讀入接收緩衝區，返回讀到的字節數
+static int rx_fill(hmi_controller_t *hmi, int wait_ms) {
+    struct pollfd pfd = { .fd = hmi->fd, .events = POLLIN };
+
+    int ret = poll(&pfd, 1, wait_ms);
+    if (ret < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    if (ret == 0) {
+        return 0;
+    }
+    if (!(pfd.revents & POLLIN)) {
+        return -1; // POLLERR / POLLHUP / POLLNVAL
+    }
+
+    uint16_t space;
+    uint8_t *dst = hmi_parser_space(&hmi->rx, &space);
+    ssize_t n = read(hmi->fd, dst, space);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    }
+    hmi_parser_commit(&hmi->rx, n);
+    return (int)n;
+}
+
+int hmi_rx_ready(hmi_controller_t *hmi) {
+    if (hmi->rx.head != hmi->rx.tail) {
+        return 1;
+    }
+    struct pollfd pfd = { .fd = hmi->fd, .events = POLLIN };
+    return poll(&pfd, 1, 0) != 0;   // 出錯或掛斷也返回 1，由接收路徑報告
+}
+
+static void build_command_frame(uint8_t *frame, uint8_t cmd, uint8_t *data, uint16_t data_len, uint16_t *frame_len) {
     uint8_t tail[] = FRAME_TAIL;
     
     frame[0] = FRAME_HEADER;
-    frame[1] = CMD_CONFIG_BASE;
-    frame[2] = sub_cmd;
+    frame[1] = cmd;
     
-    uint16_t pos = 3;
+    uint16_t pos = 2;
     if (data && data_len > 0) {
         memcpy(frame + pos, data, data_len);
         pos += data_len;
@@ -211,7 +580,6 @@ static void build_config_frame(uint8_t *frame, uint8_t sub_cmd, uint8_t *data, u
     
     *frame_len = pos;
 }
-#endif
 
 // ============================================================================
 // 基本功能
@@ -223,24 +591,18 @@ int hmi_handshake(hmi_controller_t *hmi) {
     
     build_command_frame(frame, CMD_HANDSHAKE, NULL, 0, &frame_len);
     
-    if (hmi_send_command(hmi, frame, frame_len) < 0) {
-        return -1;
-    }
-    
+    hmi_match_t match = { 0x55, -1, -1, -1 };
     hmi_response_t response;
-    if (hmi_receive_response(hmi, &response, 1000) == 0) {
-        if (response.cmd == 0x55) {
-            if (response.data) free(response.data);
-            return 0;
-        }
-        if (response.data) free(response.data);
-    }
-    
-    return -1;
+    uint8_t buffer[HMI_FRAME_MAX];
+    return hmi_transact(hmi, frame, frame_len, &match, &response, buffer, sizeof(buffer), 1000);
 }
 
 int hmi_reset_device(hmi_controller_t *hmi) {
     uint8_t data[] = {0x35, 0x5A, 0x53, 0xA5};
+    // 重啟後控件回到工程初始值，影子緩存和鏡像全部作廢
+    hmi_shadow_invalidate(hmi, -1, -1);
+    hmi_mirror_invalidate(hmi, -1, -1);
+    hmi->colors_synced = 0;
     return hmi_send_data(hmi, CMD_RESET_DEVICE, data, sizeof(data));
 }
 
@@ -251,27 +613,26 @@ int hmi_get_version(hmi_controller_t *hmi, char *version) {
     
     build_command_frame(frame, CMD_GET_VERSION, data, sizeof(data), &frame_len);
     
-    if (hmi_send_command(hmi, frame, frame_len) < 0) {
-        return -1;
-    }
-    
+    hmi_match_t match = { CMD_GET_VERSION, -1, -1, -1 };
     hmi_response_t response;
-    if (hmi_receive_response(hmi, &response, 1000) == 0) {
-        if (response.cmd == CMD_GET_VERSION && response.data && response.length >= 6) {
+    uint8_t buffer[HMI_FRAME_MAX];
+    if (hmi_transact(hmi, frame, frame_len, &match, &response, buffer, sizeof(buffer), 1000) == 0) {
+        if (response.data && response.length >= 6) {
             sprintf(version, "%d.%d.%d.%d", 
                     response.data[0], response.data[1],
                     (response.data[2] << 8) | response.data[3],
                     (response.data[4] << 8) | response.data[5]);
-            free(response.data);
             return 0;
         }
-        if (response.data) free(response.data);
     }
     
     return -1;
 }
 
 int hmi_clean_screen(hmi_controller_t *hmi) {
+    if (hmi && hmi->drawlist) {
+        return hmi_drawlist_add(hmi, DRAW_OP_CLEAN, 0, 0, 0, 0, 0, 0, NULL);
+    }
     return hmi_send_data(hmi, CMD_CLEAN_SCREEN, NULL, 0);
 }
 
@@ -292,26 +653,52 @@ int hmi_set_baudrate(hmi_controller_t *hmi, baud_rate_t baudrate) {
 // 顏色設置
 // ============================================================================
 
+// 錄製繪圖時只記下顏色，由之後的圖形帶上；與串口屏上已設置的顏色相同時不重發
+
+static int colors_sent(hmi_controller_t *hmi, uint8_t which, int ret) {
+    hmi->colors_synced = ret == 0 ? hmi->colors_synced | which : hmi->colors_synced & ~which;
+    return ret;
+}
+
 int hmi_set_fg_color(hmi_controller_t *hmi, uint16_t color) {
+    if (!hmi->drawlist && (hmi->colors_synced & HMI_COLOR_FG) && hmi->fg_color == color) {
+        return 0;
+    }
     hmi->fg_color = color;
+    if (hmi->drawlist) {
+        return 0;
+    }
     uint8_t data[2] = {color >> 8, color & 0xFF};
-    return hmi_send_data(hmi, CMD_SET_FCOLOR, data, 2);
+    return colors_sent(hmi, HMI_COLOR_FG, hmi_send_data(hmi, CMD_SET_FCOLOR, data, 2));
 }
 
 int hmi_set_bg_color(hmi_controller_t *hmi, uint16_t color) {
+    if (!hmi->drawlist && (hmi->colors_synced & HMI_COLOR_BG) && hmi->bg_color == color) {
+        return 0;
+    }
     hmi->bg_color = color;
+    if (hmi->drawlist) {
+        return 0;
+    }
     uint8_t data[2] = {color >> 8, color & 0xFF};
-    return hmi_send_data(hmi, CMD_SET_BCOLOR, data, 2);
+    return colors_sent(hmi, HMI_COLOR_BG, hmi_send_data(hmi, CMD_SET_BCOLOR, data, 2));
 }
 
 int hmi_set_colors(hmi_controller_t *hmi, uint16_t fg_color, uint16_t bg_color) {
+    if (!hmi->drawlist && (hmi->colors_synced & (HMI_COLOR_FG | HMI_COLOR_BG)) == (HMI_COLOR_FG | HMI_COLOR_BG) &&
+        hmi->fg_color == fg_color && hmi->bg_color == bg_color) {
+        return 0;
+    }
     hmi->fg_color = fg_color;
     hmi->bg_color = bg_color;
+    if (hmi->drawlist) {
+        return 0;
+    }
     uint8_t data[4] = {
         fg_color >> 8, fg_color & 0xFF,
         bg_color >> 8, bg_color & 0xFF
     };
-    return hmi_send_data(hmi, CMD_SET_FB_COLOR, data, 4);
+    return colors_sent(hmi, HMI_COLOR_FG | HMI_COLOR_BG, hmi_send_data(hmi, CMD_SET_FB_COLOR, data, 4));
 }
 
 // ============================================================================
@@ -326,6 +713,12 @@ void hmi_delay_ms(uint32_t ms) {
     usleep(ms * 1000);
 }
 
+uint64_t hmi_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 void hmi_print_buffer(uint8_t *buffer, uint16_t length) {
     printf("Buffer [%d bytes]: ", length);
     for (int i = 0; i < length; i++) {
@@ -12,12 +12,51 @@
 #include <sys/stat.h>
 #include <stdint.h>
 #include <time.h>
+#include <pthread.h>
 
 // 指令幀格式
 #define FRAME_HEADER    0xEE
 #define FRAME_TAIL      {0xFF, 0xFC, 0xFF, 0xFF}
 #define FRAME_TAIL_SIZE 4
 
+#define HMI_FRAME_MAX   1024    // 單幀最大長度
+
+// 接收緩衝區大小（每個控制器持有一份，跨呼叫保留未處理的字節）
+#define HMI_RX_RING_SIZE 4096
+
+// 批量發送緩衝區大小（hmi_begin_batch 到 hmi_flush 之間的幀在此合併）
+#define HMI_TX_BUF_SIZE 4096
+
+// 異步發送佇列默認大小（每個優先級一份）
+#define HMI_ASYNC_QUEUE_SIZE 16384
+
+// 異步發送優先級
+#define HMI_PRIO_AUTO       (-1)   // 默認：單獨的蜂鳴器幀為 URGENT，其他為 NORMAL
+#define HMI_PRIO_URGENT     0      // 告警
+#define HMI_PRIO_NORMAL     1      // 控件更新、繪圖等，先到先發
+#define HMI_PRIO_BACKGROUND 2      // 由呼叫者指定的大量而不急的數據
+#define HMI_PRIO_COUNT      3
+
+// 接收分發：同時等待的回應數和事件訂閱數上限
+#define HMI_MAX_PENDING       32
+#define HMI_MAX_SUBSCRIPTIONS 32
+
+// 多屏管理器：串口屏數量和工作線程數上限
+#define HMI_MAX_PANELS  32
+#define HMI_MAX_WORKERS 8
+
+// 運行統計：共享內存標識和直方圖格數
+#define HMI_STATS_MAGIC   0x53494D48  // "HMIS"
+#define HMI_STATS_VERSION 4
+#define HMI_HIST_BUCKETS  32
+
+// 抓包文件：文件頭之後為連續的記錄，每條記錄為 hmi_cap_record_t 加 length 字節數據
+#define HMI_CAP_MAGIC     "HMICAP1"
+#define HMI_CAP_VERSION   1
+#define HMI_CAP_TX        0    // 發送的幀（完整幀，含幀頭幀尾）
+#define HMI_CAP_RX        1    // 收到的幀（指令字節加數據，不含幀頭幀尾）
+#define HMI_CAP_TIME      2    // 間隔超過 uint32 微秒時插入，數據為距開始的 uint64 納秒
+
 // 基本指令碼
 #define CMD_CLEAN_SCREEN        0x01
 #define CMD_HANDSHAKE          0x04
@@ -180,6 +219,93 @@ typedef struct {
     uint16_t time_s;
 } auto_sleep_t;
 
+// 流式幀解析器（緩衝區中 [head, tail) 為未處理數據）
+typedef struct {
+    uint16_t head;               // 未處理數據起點
+    uint16_t tail;               // 未處理數據終點
+    uint16_t scan;               // 幀尾已搜索到的位置
+    uint32_t resyncs;            // 重新同步次數
+    uint32_t dropped;            // 丟棄的字節數
+    uint8_t buf[HMI_RX_RING_SIZE];
+} hmi_parser_t;
+
+// 異步發送佇列（由 hmi_async_start 創建）
+typedef struct hmi_async hmi_async_t;
+
+// 接收分發（等待中的請求、事件訂閱和接收線程）
+typedef struct hmi_dispatch hmi_dispatch_t;
+
+// 多屏管理器（由 hmi_manager_create 創建）
+typedef struct hmi_manager hmi_manager_t;
+
+// 收發抓包（由 hmi_capture_start 創建）
+typedef struct hmi_capture hmi_capture_t;
+
+// 控件影子緩存（由 hmi_shadow_enable 創建）
+typedef struct hmi_shadow hmi_shadow_t;
+
+// 合併發送（由 hmi_coalesce_start 創建）
+typedef struct hmi_coalesce hmi_coalesce_t;
+
+// 控件狀態鏡像（由 hmi_set_read_mode 創建）
+typedef struct hmi_mirror hmi_mirror_t;
+
+// 主機端幀緩衝（由 hmi_fb_create 創建）
+typedef struct hmi_fb hmi_fb_t;
+
+// 繪圖顯示列表（由 hmi_begin_drawing 創建）
+typedef struct hmi_drawlist hmi_drawlist_t;
+
+typedef struct {
+    char magic[8];               // HMI_CAP_MAGIC
+    uint32_t version;            // HMI_CAP_VERSION
+    uint32_t bps;                // 開始抓包時的線路速率
+    uint64_t start_ns;           // 開始時間（單調時鐘）
+    uint64_t start_unix_ns;      // 開始時間（系統時間），用於對照日誌
+    char device[64];
+} hmi_cap_header_t;
+
+typedef struct {
+    uint32_t delta_us;           // 距上一條記錄的時間
+    uint16_t length;             // 數據字節數
+    uint8_t type;                // HMI_CAP_TX / HMI_CAP_RX / HMI_CAP_TIME
+    uint8_t reserved;
+} hmi_cap_record_t;
+
+// 按指令碼統計的幀數和字節數
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;
+} hmi_cmd_stats_t;
+
+// 運行統計，計數器以原子操作累加，hmi_stats_export 後同一結構位於共享內存
+// 直方圖第 0 格為 1 微秒以下，第 i 格為 [2^(i-1), 2^i) 微秒，最後一格包含更長的時間
+typedef struct {
+    uint32_t magic;              // HMI_STATS_MAGIC
+    uint32_t version;            // HMI_STATS_VERSION
+    uint64_t start_ns;           // 統計開始時間（單調時鐘）
+    char name[64];               // 共享內存名稱，未導出時為空
+    hmi_cmd_stats_t tx[256];     // 發送，按幀指令字節
+    hmi_cmd_stats_t tx_config[256]; // 0xB1 組態指令，按子指令字節
+    hmi_cmd_stats_t rx[256];     // 接收，按幀指令字節
+    uint64_t tx_errors;          // 寫入失敗
+    uint64_t timeouts;           // 等待回應超時
+    uint64_t resyncs;            // 接收時重新同步
+    uint64_t dropped_bytes;      // 解析時丟棄的字節
+    uint64_t events;             // 交給事件訂閱的幀
+    uint64_t unhandled;          // 無人處理的幀
+    uint64_t queue_depth;        // 異步佇列中的字節數
+    uint64_t queue_peak;         // 異步佇列最大字節數
+    uint64_t shadow_sent;        // 影子緩存判定有變化而發送的寫入
+    uint64_t shadow_suppressed;  // 與上次相同而丟棄的寫入
+    uint64_t coalesced;          // 合併發送時被新值覆蓋、沒有發出的更新
+    uint64_t prio_frames[HMI_PRIO_COUNT];  // 異步模式按優先級發出的提交數
+    uint64_t prio_expired[HMI_PRIO_COUNT]; // 超過期限未發出而丟棄的提交數
+    uint64_t queue_hist[HMI_PRIO_COUNT][HMI_HIST_BUCKETS]; // 按優先級的排隊時間（提交到取出寫入）
+    uint64_t write_hist[HMI_HIST_BUCKETS]; // 每次寫入串口的耗時
+    uint64_t rtt_hist[HMI_HIST_BUCKETS];   // 請求到回應的往返時間
+} hmi_stats_t;
+
 // 串口屏控制器結構
 typedef struct {
     int fd;                      // 串口文件描述符
@@ -188,25 +314,178 @@ typedef struct {
     uint16_t current_screen;     // 當前畫面ID
     uint16_t fg_color;           // 前景色
     uint16_t bg_color;           // 背景色
+    uint8_t colors_synced;       // 前景色/背景色已發送到串口屏，相同時不重發
     uint8_t is_connected;        // 連接狀態
+    hmi_async_t *async;          // 異步發送佇列，NULL 表示同步模式
+    hmi_dispatch_t *dispatch;    // 接收分發，首次使用時創建
+    uint32_t tx_syscalls;        // 發送路徑的系統呼叫次數（write/tcdrain）
+    hmi_stats_t *stats;          // 運行統計，hmi_init 時創建
+    hmi_capture_t *capture;      // 收發抓包，NULL 表示從未開啟
+    hmi_shadow_t *shadow;        // 控件影子緩存，NULL 表示不過濾重複寫入
+    hmi_coalesce_t *coalesce;    // 合併發送，NULL 表示每次更新都發送
+    hmi_mirror_t *mirror;        // 控件狀態鏡像，NULL 表示不維護
+    hmi_drawlist_t *drawlist;    // 繪圖錄製，NULL 表示基本繪圖直接發送
+    uint8_t read_mode;           // HMI_READ_DEVICE / HMI_READ_MIRROR
+    uint8_t tx_corked;           // 批量模式，幀暫存於 tx_buf
+    uint16_t tx_len;             // tx_buf 已用長度
+    uint16_t tx_merge;           // 最後一個控件更新幀在 tx_buf 中的位置
+    uint16_t tx_merge_end;       // 該幀的結束位置，不等於 tx_len 時沒有可合併的幀
+    uint8_t tx_buf[HMI_TX_BUF_SIZE]; // 批量發送緩衝區
+    hmi_parser_t rx;             // 接收緩衝區及解析狀態
 } hmi_controller_t;
 
-// 回應數據結構
+// 回應數據結構（hmi_receive_response 的 data 需由呼叫者 free）
 typedef struct {
     uint8_t cmd;
     uint8_t *data;
     uint16_t length;
 } hmi_response_t;
 
+// 批量讀取請求
+#define HMI_READ_DATA_MAX      128     // 每個請求保存的最大數據長度
+#define HMI_READ_WINDOW        16      // 同時在途的最大請求數
+
+#define HMI_READ_DONE          0
+#define HMI_READ_TIMEOUT       (-1)
+#define HMI_READ_ERROR         (-2)    // 回應格式錯誤（過短或過長）
+#define HMI_READ_PENDING       1
+
+typedef struct {
+    uint16_t screen_id;          // 輸入：畫面ID
+    uint16_t control_id;         // 輸入：控件ID
+    int timeout_ms;              // 輸入：單個請求的超時，0 使用呼叫參數
+    int status;                  // 輸出：HMI_READ_DONE / HMI_READ_TIMEOUT / HMI_READ_ERROR
+    uint8_t type;                // 輸出：控件類型
+    uint16_t length;             // 輸出：數據長度
+    uint32_t rtt_us;             // 輸出：往返時間（微秒）
+    uint8_t data[HMI_READ_DATA_MAX]; // 輸出：控件類型之後的數據
+    uint64_t sent_ns;            // 內部使用
+    uint64_t deadline_ns;        // 內部使用
+    int slot;                    // 內部使用
+} hmi_read_req_t;
+
+typedef void (*hmi_read_cb_t)(hmi_read_req_t *req, void *user);
+
+// 事件回呼（觸摸、控件上傳等主動上報的幀），frame->data 僅在回呼期間有效
+typedef void (*hmi_event_cb_t)(hmi_controller_t *hmi, const hmi_response_t *frame, void *user);
+
 // 函數聲明
 
 // 基本串口操作
 int hmi_init(hmi_controller_t *hmi, const char *device, baud_rate_t baudrate);
 void hmi_close(hmi_controller_t *hmi);
+
+// 高速鏈路：先以 safe 連接，再把串口屏切換到不超過 fastest 的最高速率
+// 返回 0 已切換；1 協商失敗，保持 safe 且串口屏仍能響應；-1 無法連接或協商後無法恢復（已關閉）
+int hmi_init_fast(hmi_controller_t *hmi, const char *device, baud_rate_t safe, baud_rate_t fastest);
+int hmi_upgrade_baudrate(hmi_controller_t *hmi, baud_rate_t fastest); // 需在 hmi_rx_start 之前呼叫
+int hmi_set_line_bps(hmi_controller_t *hmi, uint32_t bps);  // 只設置主機端速率，可用非標準速率
+uint32_t hmi_baud_to_bps(baud_rate_t baudrate);
+int hmi_bps_to_baud(uint32_t bps);                          // 不支持的速率返回 -1
 int hmi_send_command(hmi_controller_t *hmi, uint8_t *cmd, uint16_t length);
 int hmi_send_data(hmi_controller_t *hmi, uint8_t cmd, uint8_t *data, uint16_t length);
 int hmi_receive_response(hmi_controller_t *hmi, hmi_response_t *response, int timeout_ms);
 
+// 無內存分配的接收（view/cmd 的 data 指向接收緩衝區，下次接收前有效；接收線程運行時
+// 每個呼叫線程各有一個緩衝區，在同一線程下次接收前有效；into 把數據複製到呼叫者提供的緩衝區）
+int hmi_receive_view(hmi_controller_t *hmi, hmi_response_t *response, int timeout_ms);
+int hmi_receive_cmd(hmi_controller_t *hmi, uint8_t cmd, hmi_response_t *response, int timeout_ms);
+int hmi_receive_into(hmi_controller_t *hmi, hmi_response_t *response, uint8_t *buffer, uint16_t size,
+                     int timeout_ms);
+
+// 批量發送（begin 與 flush 之間的幀合併為一次 write）
+// 期間同一畫面連續的控件更新合併為 0xB1 0x12 批量更新幀，超過 HMI_FRAME_MAX 時分為多幀
+int hmi_begin_batch(hmi_controller_t *hmi);
+int hmi_flush(hmi_controller_t *hmi);
+
+// 接收線程與事件訂閱
+// cmd 為幀指令字節；sub_cmd/screen_id/control_id 用於 0xB1 組態幀（如 0xB1 0x11 控件上傳），-1 表示任意。
+// 接收線程運行時回呼在接收線程中執行，回呼中呼叫需要等待回應的函數（hmi_read_* 等）會立即
+// 返回 -1；多屏管理器的工作線程相同。沒有接收線程時，事件在 hmi_poll_events 或等待回應期間分發。
+// 接收線程因串口錯誤退出後，可再次呼叫 hmi_rx_start 重新啟動。
+// hmi_unsubscribe 返回前等待其他線程中正在執行的該訂閱回呼結束，之後可以釋放 user。
+int hmi_subscribe(hmi_controller_t *hmi, uint8_t cmd, int sub_cmd, int screen_id, int control_id,
+                  hmi_event_cb_t callback, void *user);
+int hmi_unsubscribe(hmi_controller_t *hmi, int handle);
+int hmi_rx_start(hmi_controller_t *hmi);
+int hmi_rx_stop(hmi_controller_t *hmi);
+int hmi_poll_events(hmi_controller_t *hmi, int timeout_ms);
+uint32_t hmi_rx_unhandled(hmi_controller_t *hmi);
+
+// 異步發送（呼叫立即返回，由發送線程寫入串口）
+// 開啟後可從多個線程同時呼叫更新和繪圖函數；批量模式和讀取仍需在同一線程
+int hmi_async_start(hmi_controller_t *hmi, uint32_t queue_size);
+int hmi_async_stop(hmi_controller_t *hmi);
+int hmi_async_fence(hmi_controller_t *hmi, int timeout_ms);   // 等待此前提交的幀送上線路，超時返回 -1
+uint32_t hmi_async_pending(hmi_controller_t *hmi);   // 佇列中和正在寫入串口的字節數
+
+// 發送優先級（異步模式）：每個優先級一個佇列，每次寫入前先取 URGENT，再取 NORMAL；
+// NORMAL 也有積壓時 BACKGROUND 最多分到每次寫入的 background_share%（0 為默認 25）。
+// 不同優先級之間不保序。默認只有單獨的蜂鳴器幀為 URGENT，其他幀都為 NORMAL，按提交順序發出；
+// URGENT 和 BACKGROUND 由 hmi_set_priority 指定，繪圖依賴的顏色和畫面切換要在同一優先級提交。
+// inflight_ms 非 0 時按 hmi->baudrate 估算驅動中尚未送出的數據，超過該時間的量就先等待
+// 再挑下一批，緊急幀不會排在驅動緩衝區的大量數據之後（只對 hmi_async_start 的發送線程有效）
+int hmi_async_schedule(hmi_controller_t *hmi, uint32_t background_share, uint32_t inflight_ms);
+// 指定呼叫線程之後提交的幀的優先級（HMI_PRIO_AUTO 恢復默認）和期限，
+// 超過期限（毫秒）仍未取出的幀被丟棄並計入 prio_expired，0 表示不過期；同步模式下無效
+void hmi_set_priority(int prio, uint32_t deadline_ms);
+
+// 多屏管理器：以 epoll 在少量工作線程中驅動多個串口屏的收發
+// 加入後發送為異步模式，事件和回應由工作線程分發；hmi_close 前先 hmi_manager_destroy
+hmi_manager_t *hmi_manager_create(int workers);
+int hmi_manager_add(hmi_manager_t *mgr, hmi_controller_t *hmi);   // 返回串口屏編號
+int hmi_manager_start(hmi_manager_t *mgr);
+void hmi_manager_destroy(hmi_manager_t *mgr);                     // 送完佇列中的數據後返回
+int hmi_manager_count(hmi_manager_t *mgr);
+uint32_t hmi_manager_queue_depth(hmi_manager_t *mgr, int panel);  // 待發送字節數
+
+// 運行統計
+// export 把統計移到共享內存 /dev/shm/<name>（name 以 / 開頭），外部程式可隨時只讀映射；
+// 需在 hmi_rx_start/hmi_async_start 之前呼叫，hmi_close 時刪除
+int hmi_get_stats(hmi_controller_t *hmi, hmi_stats_t *stats);
+void hmi_stats_reset(hmi_controller_t *hmi);
+int hmi_stats_export(hmi_controller_t *hmi, const char *name);
+void hmi_stats_copy(hmi_stats_t *dst, const hmi_stats_t *src);       // 逐個計數器原子讀取
+uint32_t hmi_hist_percentile_us(const uint64_t *hist, int per_mille); // 返回所在格的上限（微秒）
+
+// 收發抓包：每個發送和收到的幀連同單調時間戳追加到文件，由後台線程寫盤
+// 寫盤跟不上時丟棄記錄而不阻塞收發；可用 hmi_replay 重放
+int hmi_capture_start(hmi_controller_t *hmi, const char *path);
+int hmi_capture_stop(hmi_controller_t *hmi);
+
+// 控件影子緩存：記住每個控件最後寫入的數值、文本哈希和顏色，不會改變顯示的寫入在編碼前丟棄。
+// entries 為緩存的控件數（0 使用默認 1024），滿了覆蓋舊記錄，最多多發一次。
+// 串口屏上報控件變化（0xB1 0x11）時自動清除該控件；hmi_reset_device 清除全部。
+// 其他方式改變了串口屏狀態時（如直接發送原始指令）呼叫 invalidate，-1 表示任意
+int hmi_shadow_enable(hmi_controller_t *hmi, uint32_t entries);
+void hmi_shadow_invalidate(hmi_controller_t *hmi, int screen_id, int control_id);
+
+// 合併發送：控件更新、格式化文本、圖標幀、顏色和圖標位置不立即發送，同一控件尚未發出的
+// 舊值由新值覆蓋，調度線程按 hmi->baudrate 換算的速率發出，佔用線路的 share%（0 為 80）。
+// 生產者再快，待發數據也不超過每個控件一幀，顯示延遲有上限。需先 hmi_async_start；
+// 合併的幀與其他指令之間不保證順序。entries 為同時待發的控件數（0 為 1024），表滿時直接發送。
+// stop 送出剩餘的更新，需在生產者停止後呼叫；hmi_async_stop 和 hmi_manager_destroy 會先自動停止
+int hmi_coalesce_start(hmi_controller_t *hmi, uint32_t entries, uint32_t share);
+int hmi_coalesce_stop(hmi_controller_t *hmi);
+uint32_t hmi_coalesce_pending(hmi_controller_t *hmi);   // 等待發送的控件數
+
+// 控件狀態鏡像：本機寫入的數值和串口屏上報的控件變化（0xB1 0x11）保存在本地。
+// HMI_READ_MIRROR 模式下 hmi_read_text/button_state/progress/slider/meter/icon 直接查表返回，
+// 鏡像中沒有的控件才詢問串口屏；refresh 強制詢問一次並更新鏡像。
+// 沒有接收線程時每次讀取前先處理已到達的上報，為此每次讀取要一次 poll 系統呼叫；
+// 開啟 hmi_rx_start 後讀取只查表。hmi_reset_device 清空鏡像
+#define HMI_READ_DEVICE        0       // 每次讀取都詢問串口屏（默認）
+#define HMI_READ_MIRROR        1       // 優先從鏡像讀取
+int hmi_set_read_mode(hmi_controller_t *hmi, int mode);
+int hmi_mirror_refresh(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id);
+
+// 流式幀解析（data 指向解析器緩衝區，下次寫入前有效）
+void hmi_parser_reset(hmi_parser_t *parser);
+uint8_t *hmi_parser_space(hmi_parser_t *parser, uint16_t *space);
+void hmi_parser_commit(hmi_parser_t *parser, uint16_t length);
+uint16_t hmi_parser_feed(hmi_parser_t *parser, const uint8_t *data, uint16_t length);
+int hmi_parser_next(hmi_parser_t *parser, hmi_response_t *frame);
+
 // 基本功能
 int hmi_handshake(hmi_controller_t *hmi);
 int hmi_reset_device(hmi_controller_t *hmi);
@@ -267,6 +546,54 @@ int hmi_stop_animation(hmi_controller_t *hmi, uint16_t screen_id, uint16_t contr
 int hmi_pause_animation(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id);
 int hmi_set_animation_frame(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t frame_id);
 
+// 曲線控件：數據點為 0～255 的縱坐標，每點一個字節，超過單幀上限時自動分幀
+int hmi_curve_add_channel(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t channel,
+                          uint16_t color);
+int hmi_curve_remove_channel(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t channel);
+int hmi_curve_clear(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t channel);
+int hmi_curve_set_scale(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t x_offset,
+                        uint16_t x_mul, uint16_t y_offset, uint16_t y_mul);
+int hmi_curve_add_data(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t channel,
+                       const uint8_t *points, uint32_t count);
+int hmi_curve_insert_data(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t channel,
+                          const uint8_t *points, uint32_t count);
+// 高速採樣：count 超過 max_points 時分為 max_points/2 個桶，每桶發送最小值和最大值兩個點，
+// 尖峰保留在曲線上；decimate 只做抽取，points 至少 2*buckets 字節，返回點數
+int hmi_curve_stream(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t channel,
+                     const uint8_t *samples, uint32_t count, uint32_t max_points);
+uint32_t hmi_curve_decimate(const uint8_t *samples, uint32_t count, uint32_t buckets, uint8_t *points);
+
+// 記錄控件：每行為以 ';' 分隔各列的文本，索引從 0 開始
+// add_rows 把多行打包為 0xB1 0x5B 批量幀（每幀盡量多行），同步模式下一次寫入。
+// export 請求 [start, start+count) 的行，串口屏逐行回覆，每收到一行呼叫一次 callback，
+// 不緩存整個表；row 不以 '\0' 結尾，只在回呼期間有效，接收線程運行時回呼在接收線程中執行。
+// timeout_ms 為兩行之間的最長間隔，返回收到的行數，未收到結束標記時返回 -1
+// 返回後 callback 不會再被呼叫。在接收線程的事件回呼中呼叫會立即返回 -1（導出的行要由該線程接收）
+#define HMI_RECORD_END         0xFFFF  // 導出結束標記（行索引）
+typedef void (*hmi_record_cb_t)(uint16_t index, const char *row, uint16_t length, void *user);
+int hmi_record_add(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, const char *row);
+int hmi_record_add_rows(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, const char *const *rows,
+                        uint32_t count);
+int hmi_record_insert(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t index,
+                      const char *row);
+int hmi_record_modify(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t index,
+                      const char *row);
+int hmi_record_delete(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t index);
+int hmi_record_clear(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id);
+int hmi_record_select(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t index);
+int hmi_record_set_offset(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t offset);
+int hmi_record_count(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t *count);
+int hmi_record_read(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t index, char *row,
+                    uint16_t size);
+int hmi_record_export(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t start,
+                      uint16_t count, hmi_record_cb_t callback, void *user, int timeout_ms);
+
+// 批量讀取：連續發送多個讀控件請求，按 screen_id/control_id 匹配回應，
+// 每完成一個請求（成功、超時或回應錯誤）呼叫一次 callback，返回成功的請求數
+int hmi_read_controls(hmi_controller_t *hmi, hmi_read_req_t *reqs, uint16_t count, int timeout_ms,
+                      hmi_read_cb_t callback, void *user);
+uint32_t hmi_read_value(const hmi_read_req_t *req);
+
 // 基本繪圖
 int hmi_draw_point(hmi_controller_t *hmi, uint16_t x, uint16_t y);
 int hmi_draw_line(hmi_controller_t *hmi, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
@@ -275,9 +602,41 @@ int hmi_draw_circle(hmi_controller_t *hmi, uint16_t x, uint16_t y, uint16_t radi
 int hmi_display_text(hmi_controller_t *hmi, uint16_t x, uint16_t y, uint8_t background, 
                      font_type_t font, const char *text);
 
+// 繪圖錄製：begin 之後的基本繪圖、清屏和顏色設置記入顯示列表，不發送；end 時丟棄重複的
+// 顏色切換和被之後的實心矩形蓋住的圖形，合併同色共線的點和線段，在不改變重疊部分
+// 先後次序的前提下把同色圖形排在一起，然後一次發出。其他指令在錄製期間照常直接發送
+int hmi_begin_drawing(hmi_controller_t *hmi);
+int hmi_end_drawing(hmi_controller_t *hmi);
+
+// 圖片：show 顯示串口屏中存儲的圖片，cut 把存儲圖片的一塊剪切到 (x, y)。
+// draw_image 上傳主機端的像素到區域 (x, y, width, height)：轉換為 RGB565 後按幀長上限
+// 切塊發送，同步模式下整幅圖合併寫入。stride 為每行字節數，0 表示緊密排列
+#define HMI_PIXEL_RGB565       2       // 大端 RGB565，與串口屏相同，不需轉換
+#define HMI_PIXEL_RGB888       3       // 每像素 R G B
+#define HMI_PIXEL_RGBA8888     4       // 每像素 R G B A，A 忽略
+int hmi_show_image(hmi_controller_t *hmi, uint16_t image_id);
+int hmi_cut_image(hmi_controller_t *hmi, uint16_t x, uint16_t y, uint16_t image_id, uint16_t left, uint16_t top,
+                  uint16_t width, uint16_t height);
+int hmi_draw_image(hmi_controller_t *hmi, uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                   const uint8_t *pixels, uint32_t stride, int format);
+// 轉換 pixels 個像素為大端 RGB565（dst 至少 2*pixels 字節），按 CPU 選擇向量實現；
+// kernel 返回所選實現的名稱（avx2/ssse3/sse2/neon/scalar）
+int hmi_rgb565_convert(uint8_t *dst, const uint8_t *src, uint32_t pixels, int format);
+const char *hmi_rgb565_kernel(void);
+
+// 幀緩衝：在主機端保存屏幕區域 (x, y, width, height) 的內容。present 傳入完整的一幀，
+// 按 16x16 像素分塊與上一幀比較，變化的塊合併為矩形並裁去未變的邊，只上傳這些矩形，
+// 返回發送的像素數。第一次 present 和 invalidate 之後整個區域重發；清屏、切換畫面或
+// 其他指令畫到這個區域之後應呼叫 invalidate
+hmi_fb_t *hmi_fb_create(uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+void hmi_fb_destroy(hmi_fb_t *fb);
+void hmi_fb_invalidate(hmi_fb_t *fb);
+int hmi_fb_present(hmi_controller_t *hmi, hmi_fb_t *fb, const uint8_t *pixels, uint32_t stride, int format);
+
 // 實用函數
 uint16_t hmi_rgb(uint8_t r, uint8_t g, uint8_t b);
 void hmi_delay_ms(uint32_t ms);
+uint64_t hmi_time_ns(void);      // 單調時鐘（納秒），不受系統時間調整影響
 void hmi_print_buffer(uint8_t *buffer, uint16_t length);
 
 #endif // DC_HMI_CONTROLLER_H 
\ No newline at end of file
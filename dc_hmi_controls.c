@@ -1,4 +1,33 @@
-#include "dc_hmi_controller.h"
+#include "dc_hmi_internal.h"
+
+static int send_read_request(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id);
+static int read_control(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t *buffer,
+                        const uint8_t **value, uint16_t *length);
+static int read_device(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t *buffer,
+                       const uint8_t **value, uint16_t *length);
+
+// 影子緩存：與上次寫入相同時返回 1，呼叫者不再編碼發送
+static int shadow_same(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t kind,
+                       uint64_t value) {
+    return hmi && hmi->shadow && hmi_shadow_check(hmi, screen_id, control_id, kind, value);
+}
+
+// 發送失敗時清除影子記錄，下次照常發送
+static int shadow_result(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, int ret) {
+    if (ret < 0 && hmi && hmi->shadow) {
+        hmi_shadow_invalidate(hmi, screen_id, control_id);
+    }
+    return ret;
+}
+
+// 寫入成功後記入控件狀態鏡像，value 與讀控件回應中的數據格式相同
+static int mirror_result(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, const void *value,
+                         uint16_t length, int ret) {
+    if (ret == 0 && hmi && hmi->mirror) {
+        hmi_mirror_store(hmi, screen_id, control_id, -1, value, length);
+    }
+    return ret;
+}
 
 // ============================================================================
 // 畫面控制
@@ -6,77 +35,29 @@
 
 int hmi_switch_screen(hmi_controller_t *hmi, uint16_t screen_id) {
     hmi->current_screen = screen_id;
-    uint8_t frame[16];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_SWITCH_SCREEN;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    return hmi_send_frame(hmi, HMI_FRAME_SWITCH_SCREEN, screen_id);
 }
 
 int hmi_switch_screen_with_effect(hmi_controller_t *hmi, uint16_t screen_id, uint8_t effect, 
                                   uint8_t area_en, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom) {
     hmi->current_screen = screen_id;
-    uint8_t data[12] = {
-        screen_id >> 8, screen_id & 0xFF,
-        effect, area_en,
-        left >> 8, left & 0xFF,
-        right >> 8, right & 0xFF,
-        top >> 8, top & 0xFF,
-        bottom >> 8, bottom & 0xFF
-    };
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_ANIM_SWITCH;
-    
-    memcpy(frame + frame_len, data, sizeof(data));
-    frame_len += sizeof(data);
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    return hmi_send_frame(hmi, HMI_FRAME_ANIM_SWITCH, screen_id, effect, area_en, left, right, top, bottom);
 }
 
 int hmi_read_screen(hmi_controller_t *hmi, uint16_t *screen_id) {
     uint8_t frame[16];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_READ_SCREEN;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    if (hmi_send_command(hmi, frame, frame_len) < 0) {
-        return -1;
-    }
+    uint16_t frame_len = hmi_encode_frame(frame, HMI_FRAME_READ_SCREEN);
     
+    // 回應: B1 01 screen_id(2)
+    hmi_match_t match = { CMD_CONFIG_BASE, CMD_READ_SCREEN, -1, -1 };
     hmi_response_t response;
-    if (hmi_receive_response(hmi, &response, 1000) == 0) {
-        if (response.data && response.length >= 3) {
-            *screen_id = (response.data[1] << 8) | response.data[2];
-            free(response.data);
-            return 0;
-        }
-        if (response.data) free(response.data);
+    uint8_t buffer[HMI_FRAME_MAX];
+    if (hmi_transact(hmi, frame, frame_len, &match, &response, buffer, sizeof(buffer), 1000) < 0 ||
+        response.length < 3) {
+        return -1;
     }
-    
-    return -1;
+    *screen_id = (response.data[1] << 8) | response.data[2];
+    return 0;
 }
 
 // ============================================================================
@@ -90,15 +71,15 @@ int hmi_config_touch(hmi_controller_t *hmi, touch_config_t *config) {
     cmd |= (config->upload_mode & 0x07) << 2;
     cmd |= (config->calibrate_disable & 0x01) << 5;
     
-    return hmi_send_data(hmi, CMD_TOUCH_CONFIG, &cmd, 1);
+    return hmi_send_frame(hmi, HMI_FRAME_TOUCH_CONFIG, cmd);
 }
 
 int hmi_calibrate_touch(hmi_controller_t *hmi) {
-    return hmi_send_data(hmi, CMD_TOUCH_CALIBRATE, NULL, 0);
+    return hmi_send_frame(hmi, HMI_FRAME_TOUCH_CALIBRATE);
 }
 
 int hmi_test_touch(hmi_controller_t *hmi, uint8_t enable) {
-    return hmi_send_data(hmi, CMD_TOUCH_TEST, &enable, 1);
+    return hmi_send_frame(hmi, HMI_FRAME_TOUCH_TEST, enable);
 }
 
 // ============================================================================
@@ -106,187 +87,71 @@ int hmi_test_touch(hmi_controller_t *hmi, uint8_t enable) {
 // ============================================================================
 
 int hmi_update_text(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, const char *text) {
-    uint16_t text_len = strlen(text);
-    uint8_t frame[1024];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_UPDATE_CONTROL;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    
-    memcpy(frame + frame_len, text, text_len);
-    frame_len += text_len;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    unsigned length = strlen(text);
+    if (shadow_same(hmi, screen_id, control_id, SHADOW_TEXT, hmi_shadow_hash(text, length))) {
+        return 0;
+    }
+    int ret = shadow_result(hmi, screen_id, control_id,
+                            hmi_send_frame(hmi, HMI_FRAME_CONTROL_BYTES, screen_id, control_id, text, length));
+    return mirror_result(hmi, screen_id, control_id, text, length, ret);
 }
 
 int hmi_clear_text(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_UPDATE_CONTROL;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    if (shadow_same(hmi, screen_id, control_id, SHADOW_TEXT, hmi_shadow_hash(NULL, 0))) {
+        return 0;
+    }
+    int ret = shadow_result(hmi, screen_id, control_id,
+                            hmi_send_frame(hmi, HMI_FRAME_CONTROL_BYTES, screen_id, control_id, NULL, 0u));
+    return mirror_result(hmi, screen_id, control_id, NULL, 0, ret);
 }
 
 int hmi_read_text(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, char *text, uint16_t max_len) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_READ_CONTROL;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    if (hmi_send_command(hmi, frame, frame_len) < 0) {
+    const uint8_t *value;
+    uint16_t length;
+    uint8_t buffer[HMI_FRAME_MAX];
+
+    if (max_len == 0 || read_control(hmi, screen_id, control_id, buffer, &value, &length) < 0) {
         return -1;
     }
-    
-    hmi_response_t response;
-    if (hmi_receive_response(hmi, &response, 1000) == 0) {
-        if (response.data && response.length > 5) {
-            uint16_t copy_len = (response.length - 5 < max_len - 1) ? response.length - 5 : max_len - 1;
-            memcpy(text, response.data + 5, copy_len);
-            text[copy_len] = '\0';
-            free(response.data);
-            return 0;
-        }
-        if (response.data) free(response.data);
-    }
-    
-    return -1;
+
+    uint16_t copy_len = (length < max_len - 1) ? length : max_len - 1;
+    memcpy(text, value, copy_len);
+    text[copy_len] = '\0';
+    return 0;
 }
 
 int hmi_set_text_blink(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t cycle_10ms) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_SET_BLINK;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    frame[frame_len++] = cycle_10ms >> 8;
-    frame[frame_len++] = cycle_10ms & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    return hmi_send_frame(hmi, HMI_FRAME_SET_BLINK, screen_id, control_id, cycle_10ms);
 }
 
 int hmi_set_text_scroll(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t speed) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_SET_SCROLL;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    frame[frame_len++] = speed >> 8;
-    frame[frame_len++] = speed & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    return hmi_send_frame(hmi, HMI_FRAME_SET_SCROLL, screen_id, control_id, speed);
 }
 
 int hmi_set_text_color(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t fg_color, uint16_t bg_color) {
-    // 設置背景色
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_SET_BK_COLOR;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    frame[frame_len++] = bg_color >> 8;
-    frame[frame_len++] = bg_color & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    hmi_send_command(hmi, frame, frame_len);
-    
-    // 設置前景色
-    frame_len = 0;
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_SET_FG_COLOR;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    frame[frame_len++] = fg_color >> 8;
-    frame[frame_len++] = fg_color & 0xFF;
-    
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    // 先設置背景色，再設置前景色，顏色未變的一半不發送
+    if (!(hmi && hmi->shadow && hmi_shadow_check_color(hmi, screen_id, control_id, SHADOW_BG, bg_color))) {
+        shadow_result(hmi, screen_id, control_id,
+                      hmi_send_frame(hmi, HMI_FRAME_SET_BK_COLOR, screen_id, control_id, bg_color));
+    }
+    if (hmi && hmi->shadow && hmi_shadow_check_color(hmi, screen_id, control_id, SHADOW_FG, fg_color)) {
+        return 0;
+    }
+    return shadow_result(hmi, screen_id, control_id,
+                         hmi_send_frame(hmi, HMI_FRAME_SET_FG_COLOR, screen_id, control_id, fg_color));
 }
 
 int hmi_format_text(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, 
                     data_type_t type, uint8_t decimal, uint32_t value) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_FORMAT_TEXT;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    frame[frame_len++] = (uint8_t)type;
-    frame[frame_len++] = decimal;
-    frame[frame_len++] = (value >> 24) & 0xFF;
-    frame[frame_len++] = (value >> 16) & 0xFF;
-    frame[frame_len++] = (value >> 8) & 0xFF;
-    frame[frame_len++] = value & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    uint64_t shown = ((uint64_t)type << 40) | ((uint64_t)decimal << 32) | value;
+    if (shadow_same(hmi, screen_id, control_id, SHADOW_FORMAT, shown)) {
+        return 0;
+    }
+    // 格式化後的文本由串口屏生成，鏡像中的舊文本作廢
+    hmi_mirror_invalidate(hmi, screen_id, control_id);
+    return shadow_result(hmi, screen_id, control_id,
+                         hmi_send_frame(hmi, HMI_FRAME_FORMAT_TEXT, screen_id, control_id, (uint8_t)type,
+                                        decimal, value));
 }
 
 // ============================================================================
@@ -294,56 +159,24 @@ int hmi_format_text(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_
 // ============================================================================
 
 int hmi_set_button_state(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t state) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_UPDATE_CONTROL;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    frame[frame_len++] = state;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    if (shadow_same(hmi, screen_id, control_id, SHADOW_NUMBER, state)) {
+        return 0;
+    }
+    int ret = shadow_result(hmi, screen_id, control_id,
+                            hmi_send_frame(hmi, HMI_FRAME_CONTROL_U8, screen_id, control_id, state));
+    return mirror_result(hmi, screen_id, control_id, &state, 1, ret);
 }
 
 int hmi_read_button_state(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t *state) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_READ_CONTROL;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    if (hmi_send_command(hmi, frame, frame_len) < 0) {
+    const uint8_t *value;
+    uint16_t length;
+    uint8_t buffer[HMI_FRAME_MAX];
+
+    if (read_control(hmi, screen_id, control_id, buffer, &value, &length) < 0 || length < 1) {
         return -1;
     }
-    
-    hmi_response_t response;
-    if (hmi_receive_response(hmi, &response, 1000) == 0) {
-        if (response.data && response.length >= 7) {
-            *state = response.data[6];
-            free(response.data);
-            return 0;
-        }
-        if (response.data) free(response.data);
-    }
-    
-    return -1;
+    *state = value[0];
+    return 0;
 }
 
 // ============================================================================
@@ -351,60 +184,25 @@ int hmi_read_button_state(hmi_controller_t *hmi, uint16_t screen_id, uint16_t co
 // ============================================================================
 
 int hmi_update_progress(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint32_t value) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_UPDATE_CONTROL;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    frame[frame_len++] = (value >> 24) & 0xFF;
-    frame[frame_len++] = (value >> 16) & 0xFF;
-    frame[frame_len++] = (value >> 8) & 0xFF;
-    frame[frame_len++] = value & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    if (shadow_same(hmi, screen_id, control_id, SHADOW_NUMBER, value)) {
+        return 0;
+    }
+    int ret = shadow_result(hmi, screen_id, control_id,
+                            hmi_send_frame(hmi, HMI_FRAME_CONTROL_U32, screen_id, control_id, value));
+    uint8_t data[4] = { value >> 24, value >> 16, value >> 8, value };
+    return mirror_result(hmi, screen_id, control_id, data, sizeof(data), ret);
 }
 
 int hmi_read_progress(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint32_t *value) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_READ_CONTROL;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    if (hmi_send_command(hmi, frame, frame_len) < 0) {
+    const uint8_t *data;
+    uint16_t length;
+    uint8_t buffer[HMI_FRAME_MAX];
+
+    if (read_control(hmi, screen_id, control_id, buffer, &data, &length) < 0 || length < 4) {
         return -1;
     }
-    
-    hmi_response_t response;
-    if (hmi_receive_response(hmi, &response, 1000) == 0) {
-        if (response.data && response.length >= 9) {
-            *value = (response.data[5] << 24) | (response.data[6] << 16) | 
-                     (response.data[7] << 8) | response.data[8];
-            free(response.data);
-            return 0;
-        }
-        if (response.data) free(response.data);
-    }
-    
-    return -1;
+    *value = ((uint32_t)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+    return 0;
 }
 
 int hmi_update_slider(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint32_t value) {
@@ -432,79 +230,24 @@ int hmi_read_meter(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_i
 // ============================================================================
 
 int hmi_show_icon(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t frame_id) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_ANIM_FRAME;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    frame[frame_len++] = frame_id;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    return mirror_result(hmi, screen_id, control_id, &frame_id, 1,
+                         hmi_send_frame(hmi, HMI_FRAME_ANIM_FRAME, screen_id, control_id, frame_id));
 }
 
 int hmi_set_icon_position(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t x, uint16_t y) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_SET_ICON_POS;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    frame[frame_len++] = x >> 8;
-    frame[frame_len++] = x & 0xFF;
-    frame[frame_len++] = y >> 8;
-    frame[frame_len++] = y & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    return hmi_send_frame(hmi, HMI_FRAME_ICON_POS, screen_id, control_id, x, y);
 }
 
 int hmi_read_icon(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t *frame_id) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_READ_CONTROL;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    if (hmi_send_command(hmi, frame, frame_len) < 0) {
+    const uint8_t *value;
+    uint16_t length;
+    uint8_t buffer[HMI_FRAME_MAX];
+
+    if (read_control(hmi, screen_id, control_id, buffer, &value, &length) < 0 || length < 1) {
         return -1;
     }
-    
-    hmi_response_t response;
-    if (hmi_receive_response(hmi, &response, 1000) == 0) {
-        if (response.data && response.length >= 6) {
-            *frame_id = response.data[5];
-            free(response.data);
-            return 0;
-        }
-        if (response.data) free(response.data);
-    }
-    
-    return -1;
+    *frame_id = value[0];
+    return 0;
 }
 
 // ============================================================================
@@ -512,129 +255,230 @@ int hmi_read_icon(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id
 // ============================================================================
 
 int hmi_start_animation(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_ANIM_START;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    hmi_mirror_invalidate(hmi, screen_id, control_id);   // 播放中的當前幀只有串口屏知道
+    return hmi_send_frame(hmi, HMI_FRAME_ANIM_START, screen_id, control_id);
 }
 
 int hmi_stop_animation(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_ANIM_STOP;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    return hmi_send_frame(hmi, HMI_FRAME_ANIM_STOP, screen_id, control_id);
 }
 
 int hmi_pause_animation(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_ANIM_PAUSE;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    return hmi_send_frame(hmi, HMI_FRAME_ANIM_PAUSE, screen_id, control_id);
 }
 
 int hmi_set_animation_frame(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t frame_id) {
-    uint8_t frame[32];
-    uint16_t frame_len = 0;
-    
-    frame[frame_len++] = FRAME_HEADER;
-    frame[frame_len++] = CMD_CONFIG_BASE;
-    frame[frame_len++] = CMD_ANIM_FRAME;
-    frame[frame_len++] = screen_id >> 8;
-    frame[frame_len++] = screen_id & 0xFF;
-    frame[frame_len++] = control_id >> 8;
-    frame[frame_len++] = control_id & 0xFF;
-    frame[frame_len++] = frame_id;
-    
-    uint8_t tail[] = FRAME_TAIL;
-    memcpy(frame + frame_len, tail, FRAME_TAIL_SIZE);
-    frame_len += FRAME_TAIL_SIZE;
-    
-    return hmi_send_command(hmi, frame, frame_len);
+    return mirror_result(hmi, screen_id, control_id, &frame_id, 1,
+                         hmi_send_frame(hmi, HMI_FRAME_ANIM_FRAME, screen_id, control_id, frame_id));
+}
+
+// ============================================================================
+// 批量讀取（流水線）
+// ============================================================================
+
+int hmi_read_controls(hmi_controller_t *hmi, hmi_read_req_t *reqs, uint16_t count, int timeout_ms,
+                      hmi_read_cb_t callback, void *user) {
+    if (!hmi || !reqs || !hmi->is_connected) {
+        return -1;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        reqs[i].status = HMI_READ_PENDING;
+        reqs[i].slot = -1;
+        reqs[i].length = 0;
+    }
+
+    uint16_t next = 0;        // 下一個待發送的請求
+    uint16_t in_flight = 0;
+    uint16_t completed = 0;
+    uint16_t finished = 0;
+    uint8_t buffer[HMI_FRAME_MAX];
+
+    while (finished < count) {
+        // 補滿發送窗口，多個請求合併為一次寫入；回應按 screen_id/control_id 匹配
+        if (next < count && in_flight < HMI_READ_WINDOW) {
+            uint8_t corked = hmi->tx_corked;
+            hmi->tx_corked = 1;
+            uint64_t now = hmi_time_ns();
+            while (next < count && in_flight < HMI_READ_WINDOW) {
+                hmi_read_req_t *req = &reqs[next++];
+                int req_timeout = req->timeout_ms > 0 ? req->timeout_ms : timeout_ms;
+                hmi_match_t match = { CMD_CONFIG_BASE, CMD_READ_CONTROL, req->screen_id, req->control_id };
+
+                req->sent_ns = now;
+                req->deadline_ns = now + (uint64_t)req_timeout * 1000000ULL;
+                req->slot = hmi_expect(hmi, &match);
+                if (req->slot < 0 || send_read_request(hmi, req->screen_id, req->control_id) < 0) {
+                    req->deadline_ns = now; // 無法發送，按超時處理
+                }
+                in_flight++;
+            }
+            hmi->tx_corked = corked;
+            hmi_tx_push(hmi);
+        }
+
+        // 收集已完成和已到期的請求
+        uint32_t generation = hmi_expect_generation(hmi);
+        uint64_t now = hmi_time_ns();
+        uint64_t earliest = UINT64_MAX;
+        for (uint16_t i = 0; i < next; i++) {
+            hmi_read_req_t *req = &reqs[i];
+            if (req->status != HMI_READ_PENDING) {
+                continue;
+            }
+
+            hmi_response_t response;
+            int ret = req->slot >= 0 ? hmi_expect_poll(hmi, req->slot, &response, buffer, sizeof(buffer)) : -1;
+            if (ret == 0 && response.length >= 6) {
+                uint16_t length = response.length - 6;
+                if (length > HMI_READ_DATA_MAX) {
+                    length = HMI_READ_DATA_MAX;
+                }
+                req->type = response.data[5];
+                req->length = length;
+                memcpy(req->data, response.data + 6, length);
+                req->status = HMI_READ_DONE;
+                req->rtt_us = (uint32_t)((now - req->sent_ns) / 1000);
+                completed++;
+            } else if (ret == -1 && req->deadline_ns > now) {
+                if (req->deadline_ns < earliest) {
+                    earliest = req->deadline_ns;
+                }
+                continue;
+            } else if (ret == -1) {
+                hmi_expect_cancel(hmi, req->slot);
+                req->status = HMI_READ_TIMEOUT;
+                HMI_STAT_ADD(hmi, timeouts, 1);
+            } else {
+                // 回應過短或超出緩衝區，槽位已由 hmi_expect_poll 釋放
+                req->status = HMI_READ_ERROR;
+            }
+
+            req->slot = -1;
+            in_flight--;
+            finished++;
+            if (callback) {
+                callback(req, user);
+            }
+        }
+
+        if (earliest != UINT64_MAX) {
+            hmi_expect_wait_any(hmi, generation, earliest);
+        }
+    }
+
+    return completed;
+}
+
+uint32_t hmi_read_value(const hmi_read_req_t *req) {
+    uint32_t value = 0;
+    for (uint16_t i = 0; i < req->length && i < 4; i++) {
+        value = (value << 8) | req->data[i];
+    }
+    return value;
 }
 
 // ============================================================================
 // 基本繪圖
 // ============================================================================
 
+// 錄製時記入顯示列表，由 hmi_end_drawing 優化後發送
+
 int hmi_draw_point(hmi_controller_t *hmi, uint16_t x, uint16_t y) {
-    uint8_t data[4] = {x >> 8, x & 0xFF, y >> 8, y & 0xFF};
-    return hmi_send_data(hmi, CMD_DRAW_POINT, data, sizeof(data));
+    if (hmi && hmi->drawlist) {
+        return hmi_drawlist_add(hmi, DRAW_OP_POINT, x, y, 0, 0, 0, 0, NULL);
+    }
+    return hmi_send_frame(hmi, HMI_FRAME_DRAW_POINT, x, y);
 }
 
 int hmi_draw_line(hmi_controller_t *hmi, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
-    uint8_t data[8] = {
-        x0 >> 8, x0 & 0xFF, y0 >> 8, y0 & 0xFF,
-        x1 >> 8, x1 & 0xFF, y1 >> 8, y1 & 0xFF
-    };
-    return hmi_send_data(hmi, CMD_DRAW_LINE, data, sizeof(data));
+    if (hmi && hmi->drawlist) {
+        return hmi_drawlist_add(hmi, DRAW_OP_LINE, x0, y0, x1, y1, 0, 0, NULL);
+    }
+    return hmi_send_frame(hmi, HMI_FRAME_DRAW_LINE, x0, y0, x1, y1);
 }
 
 int hmi_draw_rectangle(hmi_controller_t *hmi, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t filled) {
-    uint8_t data[8] = {
-        x0 >> 8, x0 & 0xFF, y0 >> 8, y0 & 0xFF,
-        x1 >> 8, x1 & 0xFF, y1 >> 8, y1 & 0xFF
-    };
-    uint8_t cmd = filled ? CMD_DRAW_RECT_FILL : CMD_DRAW_RECT;
-    return hmi_send_data(hmi, cmd, data, sizeof(data));
+    if (hmi && hmi->drawlist) {
+        return hmi_drawlist_add(hmi, filled ? DRAW_OP_RECT_FILL : DRAW_OP_RECT, x0, y0, x1, y1, 0, 0, NULL);
+    }
+    return hmi_send_frame(hmi, filled ? HMI_FRAME_DRAW_RECT_FILL : HMI_FRAME_DRAW_RECT, x0, y0, x1, y1);
 }
 
 int hmi_draw_circle(hmi_controller_t *hmi, uint16_t x, uint16_t y, uint16_t radius, uint8_t filled) {
-    uint8_t data[6] = {x >> 8, x & 0xFF, y >> 8, y & 0xFF, radius >> 8, radius & 0xFF};
-    uint8_t cmd = filled ? CMD_DRAW_CIRCLE_FILL : CMD_DRAW_CIRCLE;
-    return hmi_send_data(hmi, cmd, data, sizeof(data));
+    if (hmi && hmi->drawlist) {
+        return hmi_drawlist_add(hmi, filled ? DRAW_OP_CIRCLE_FILL : DRAW_OP_CIRCLE, x, y, radius, 0, 0, 0, NULL);
+    }
+    return hmi_send_frame(hmi, filled ? HMI_FRAME_DRAW_CIRCLE_FILL : HMI_FRAME_DRAW_CIRCLE, x, y, radius);
 }
 
 int hmi_display_text(hmi_controller_t *hmi, uint16_t x, uint16_t y, uint8_t background, 
                      font_type_t font, const char *text) {
-    uint16_t text_len = strlen(text);
-    uint8_t *data = malloc(6 + text_len);
-    if (!data) return -1;
-    
-    data[0] = x >> 8;
-    data[1] = x & 0xFF;
-    data[2] = y >> 8;
-    data[3] = y & 0xFF;
-    data[4] = background;
-    data[5] = (uint8_t)font;
-    memcpy(data + 6, text, text_len);
-    
-    int result = hmi_send_data(hmi, CMD_TEXT_DISPLAY, data, 6 + text_len);
-    free(data);
-    return result;
-} 
\ No newline at end of file
+    if (hmi && hmi->drawlist) {
+        return hmi_drawlist_add(hmi, DRAW_OP_TEXT, x, y, 0, 0, background, (uint8_t)font, text);
+    }
+    return hmi_send_frame(hmi, HMI_FRAME_TEXT_DISPLAY, x, y, background, (uint8_t)font, text,
+                          (unsigned)strlen(text));
+}
+
+// ============================================================================
+// 讀取回應
+// ============================================================================
+
+// 發送讀控件指令
+static int send_read_request(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id) {
+    return hmi_send_frame(hmi, HMI_FRAME_READ_CONTROL, screen_id, control_id);
+}
+
+// 讀取控件數值，鏡像模式下先查鏡像，鏡像中沒有時詢問串口屏（回應同時記入鏡像）
+// 數據複製到 buffer（HMI_FRAME_MAX 字節），value 指向控件類型之後的數據
+static int read_control(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t *buffer,
+                        const uint8_t **value, uint16_t *length) {
+    if (hmi && hmi->read_mode == HMI_READ_MIRROR) {
+        // 沒有接收線程時先處理已到達的上報，否則串口屏上的改動不會進入鏡像；
+        // 沒有數據時只多一次 poll，不送出批量緩衝區，也不進入分發
+        if (!hmi_rx_threaded(hmi) && hmi_rx_ready(hmi) && hmi_poll_events(hmi, 0) < 0) {
+            return -1;
+        }
+    }
+    if (hmi && hmi->read_mode == HMI_READ_MIRROR &&
+        hmi_mirror_get(hmi, screen_id, control_id, buffer, HMI_FRAME_MAX, length) == 0) {
+        *value = buffer;
+        return 0;
+    }
+    return read_device(hmi, screen_id, control_id, buffer, value, length);
+}
+
+int hmi_mirror_refresh(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id) {
+    const uint8_t *value;
+    uint16_t length;
+    uint8_t buffer[HMI_FRAME_MAX];
+
+    if (!hmi || !hmi->mirror) {
+        return -1;
+    }
+    return read_device(hmi, screen_id, control_id, buffer, &value, &length);
+}
+
+// 回應格式: B1 11 screen_id(2) control_id(2) control_type(1) 數據...
+static int read_device(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t *buffer,
+                       const uint8_t **value, uint16_t *length) {
+    // 先登記再發送，回應不會被其他讀取者或事件訂閱取走
+    hmi_match_t match = { CMD_CONFIG_BASE, CMD_READ_CONTROL, screen_id, control_id };
+    int slot = hmi_expect(hmi, &match);
+    if (slot < 0) {
+        return -1;
+    }
+    if (send_read_request(hmi, screen_id, control_id) < 0) {
+        hmi_expect_cancel(hmi, slot);
+        return -1;
+    }
+
+    hmi_response_t response;
+    if (hmi_expect_wait(hmi, slot, &response, buffer, HMI_FRAME_MAX, 1000) < 0 || response.length < 6) {
+        return -1;
+    }
+    *value = response.data + 6;
+    *length = response.length - 6;
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "dc_hmi_internal.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// ============================================================================
+// 曲線控件
+// ============================================================================
+//
+// 數據點為 0～255 的縱坐標，每個 0xB1 0x32 幀可帶多個點，由串口屏按控件的
+// 縮放參數畫出，一個點只佔一個字節。採樣比屏幕能顯示的點多時在本機抽取：
+// 每個桶取最小值和最大值兩個點，曲線在桶內畫成一條豎線，尖峰不會被平均掉。
+
+// 數據幀: EE B1 32 screen_id(2) control_id(2) channel(1) count(2) 數據... FF FC FF FF
+#define CURVE_FRAME_OVERHEAD   14
+#define CURVE_FRAME_POINTS     (HMI_FRAME_MAX - CURVE_FRAME_OVERHEAD)
+
+int hmi_curve_add_channel(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t channel,
+                          uint16_t color) {
+    return hmi_send_frame(hmi, HMI_FRAME_CURVE_ADD_CH, screen_id, control_id, channel, color);
+}
+
+int hmi_curve_remove_channel(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t channel) {
+    return hmi_send_frame(hmi, HMI_FRAME_CURVE_DEL_CH, screen_id, control_id, channel);
+}
+
+int hmi_curve_clear(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t channel) {
+    return hmi_send_frame(hmi, HMI_FRAME_CURVE_CLEAR_CH, screen_id, control_id, channel);
+}
+
+int hmi_curve_set_scale(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t x_offset,
+                        uint16_t x_mul, uint16_t y_offset, uint16_t y_mul) {
+    return hmi_send_frame(hmi, HMI_FRAME_CURVE_SCALE, screen_id, control_id, x_offset, x_mul, y_offset, y_mul);
+}
+
+// 按幀長上限分幀發送；同步模式下多幀合併為一次寫入
+static int curve_send(hmi_controller_t *hmi, hmi_frame_id_t id, uint16_t screen_id, uint16_t control_id,
+                      uint8_t channel, const uint8_t *points, uint32_t count) {
+    if (!hmi || !hmi->is_connected || (!points && count > 0)) {
+        return -1;
+    }
+    int cork = count > CURVE_FRAME_POINTS && !hmi->tx_corked && !hmi->async;
+    if (cork) {
+        hmi_begin_batch(hmi);
+    }
+
+    int ret = 0;
+    for (uint32_t sent = 0; sent < count && ret == 0; ) {
+        uint32_t n = count - sent < CURVE_FRAME_POINTS ? count - sent : CURVE_FRAME_POINTS;
+        ret = hmi_send_frame(hmi, id, screen_id, control_id, channel, n, points + sent, n);
+        sent += n;
+    }
+
+    if (cork && hmi_flush(hmi) < 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+int hmi_curve_add_data(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t channel,
+                       const uint8_t *points, uint32_t count) {
+    return curve_send(hmi, HMI_FRAME_CURVE_DATA, screen_id, control_id, channel, points, count);
+}
+
+int hmi_curve_insert_data(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t channel,
+                          const uint8_t *points, uint32_t count) {
+    return curve_send(hmi, HMI_FRAME_CURVE_INSERT, screen_id, control_id, channel, points, count);
+}
+
+// ============================================================================
+// 最小值/最大值抽取
+// ============================================================================
+
+// 一個桶內的最小值和最大值；16 字節以上用向量比較，最後不足 16 字節的部分
+// 與前面重疊再讀一次，不需要逐字節處理尾部
+static void span_minmax(const uint8_t *p, uint32_t n, uint8_t *lo, uint8_t *hi) {
+    uint8_t min = 255, max = 0;
+    uint32_t i = 0;
+
+#if defined(__SSE2__)
+    if (n >= 16) {
+        __m128i vmin = _mm_loadu_si128((const __m128i*)p);
+        __m128i vmax = vmin;
+        for (i = 16; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+            vmin = _mm_min_epu8(vmin, v);
+            vmax = _mm_max_epu8(vmax, v);
+        }
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + n - 16));
+        vmin = _mm_min_epu8(vmin, v);
+        vmax = _mm_max_epu8(vmax, v);
+
+        // 16 個字節折半比較四次
+        vmin = _mm_min_epu8(vmin, _mm_srli_si128(vmin, 8));
+        vmin = _mm_min_epu8(vmin, _mm_srli_si128(vmin, 4));
+        vmin = _mm_min_epu8(vmin, _mm_srli_si128(vmin, 2));
+        vmin = _mm_min_epu8(vmin, _mm_srli_si128(vmin, 1));
+        vmax = _mm_max_epu8(vmax, _mm_srli_si128(vmax, 8));
+        vmax = _mm_max_epu8(vmax, _mm_srli_si128(vmax, 4));
+        vmax = _mm_max_epu8(vmax, _mm_srli_si128(vmax, 2));
+        vmax = _mm_max_epu8(vmax, _mm_srli_si128(vmax, 1));
+        min = (uint8_t)_mm_cvtsi128_si32(vmin);
+        max = (uint8_t)_mm_cvtsi128_si32(vmax);
+        i = n;
+    }
+#elif defined(__aarch64__)
+    if (n >= 16) {
+        uint8x16_t vmin = vld1q_u8(p);
+        uint8x16_t vmax = vmin;
+        for (i = 16; i + 16 <= n; i += 16) {
+            uint8x16_t v = vld1q_u8(p + i);
+            vmin = vminq_u8(vmin, v);
+            vmax = vmaxq_u8(vmax, v);
+        }
+        uint8x16_t v = vld1q_u8(p + n - 16);
+        min = vminvq_u8(vminq_u8(vmin, v));
+        max = vmaxvq_u8(vmaxq_u8(vmax, v));
+        i = n;
+    }
+#endif
+
+    for (; i < n; i++) {
+        if (p[i] < min) {
+            min = p[i];
+        }
+        if (p[i] > max) {
+            max = p[i];
+        }
+    }
+    *lo = min;
+    *hi = max;
+}
+
+uint32_t hmi_curve_decimate(const uint8_t *samples, uint32_t count, uint32_t buckets, uint8_t *points) {
+    if (buckets == 0 || count <= buckets * 2) {
+        memcpy(points, samples, count);
+        return count;
+    }
+
+    for (uint32_t b = 0; b < buckets; b++) {
+        uint32_t start = (uint32_t)((uint64_t)b * count / buckets);
+        uint32_t end = (uint32_t)((uint64_t)(b + 1) * count / buckets);
+        uint8_t lo, hi;
+        span_minmax(samples + start, end - start, &lo, &hi);
+
+        // 桶內上升時先低後高，下降時先高後低，與相鄰桶連接的線段不會交叉
+        if (samples[start] <= samples[end - 1]) {
+            points[2 * b] = lo;
+            points[2 * b + 1] = hi;
+        } else {
+            points[2 * b] = hi;
+            points[2 * b + 1] = lo;
+        }
+    }
+    return buckets * 2;
+}
+
+int hmi_curve_stream(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t channel,
+                     const uint8_t *samples, uint32_t count, uint32_t max_points) {
+    if (!samples || max_points < 2) {
+        return -1;
+    }
+    if (count <= max_points) {
+        return hmi_curve_add_data(hmi, screen_id, control_id, channel, samples, count);
+    }
+
+    uint8_t stack[2 * CURVE_FRAME_POINTS];
+    uint8_t *points = max_points <= sizeof(stack) ? stack : malloc(max_points);
+    if (!points) {
+        return -1;
+    }
+    uint32_t n = hmi_curve_decimate(samples, count, max_points / 2, points);
+    int ret = hmi_curve_add_data(hmi, screen_id, control_id, channel, points, n);
+    if (points != stack) {
+        free(points);
+    }
+    return ret;
+}
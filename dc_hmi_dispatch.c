@@ -0,0 +1,559 @@
+#include "dc_hmi_internal.h"
+#include <poll.h>
+#include <sys/eventfd.h>
+
+// ============================================================================
+// 接收分發
+// ============================================================================
+//
+// 每個解析出的幀按以下順序分發：
+//   1. 等待中的請求（hmi_expect 登記，同條件時先登記者優先）
+//   2. 訂閱的事件回呼（觸摸、控件上傳等主動上報的幀）
+// 接收線程運行時由它獨佔串口讀取；否則由等待回應的呼叫者在等待期間讀取並分發。
+
+typedef struct {
+    uint8_t in_use;
+    uint8_t done;
+    uint32_t seq;                // 登記順序
+    uint64_t start_ns;           // 登記時間，用於往返時間統計
+    hmi_match_t match;
+    uint8_t cmd;
+    uint16_t length;
+    uint8_t data[HMI_FRAME_MAX];
+} pending_t;
+
+typedef struct {
+    uint8_t in_use;
+    uint32_t active;             // 正在執行的回呼數，退訂時等待歸零
+    hmi_match_t match;
+    hmi_event_cb_t callback;
+    void *user;
+} subscription_t;
+
+struct hmi_dispatch {
+    pthread_mutex_t lock;
+    pthread_cond_t completed;    // 有請求完成
+    pthread_cond_t idle;         // 有回呼執行完畢
+    uint32_t generation;         // 請求完成計數，避免遺漏喚醒
+    uint32_t seq;
+    uint32_t unhandled;          // 無人處理而丟棄的幀數
+    pending_t pending[HMI_MAX_PENDING];
+    subscription_t subs[HMI_MAX_SUBSCRIPTIONS];
+    pthread_t thread;
+    int running;                 // 接收線程運行中
+    int wake_fd;                 // 通知接收線程退出
+};
+
+// 接收線程模式下 hmi_receive_view 的數據，每個呼叫線程各一份
+static __thread uint8_t tls_view_buf[HMI_FRAME_MAX];
+
+// 當前線程正在 hmi_rx_pump 中分發（接收線程或管理器工作線程）
+static __thread int tls_rx_reader;
+
+// 當前線程正在執行其回呼的分發器，回呼中退訂時不等待自己
+static __thread hmi_dispatch_t *tls_dispatching;
+
+static hmi_dispatch_t *dispatch_get(hmi_controller_t *hmi) {
+    if (hmi->dispatch) {
+        return hmi->dispatch;
+    }
+
+    hmi_dispatch_t *d = calloc(1, sizeof(hmi_dispatch_t));
+    if (!d) {
+        return NULL;
+    }
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&d->completed, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_cond_init(&d->idle, NULL);
+    pthread_mutex_init(&d->lock, NULL);
+    d->wake_fd = -1;
+
+    hmi->dispatch = d;
+    return d;
+}
+
+void hmi_dispatch_free(hmi_controller_t *hmi) {
+    hmi_dispatch_t *d = hmi->dispatch;
+    if (!d) {
+        return;
+    }
+    hmi_rx_stop(hmi);
+    pthread_mutex_destroy(&d->lock);
+    pthread_cond_destroy(&d->completed);
+    pthread_cond_destroy(&d->idle);
+    free(d);
+    hmi->dispatch = NULL;
+}
+
+int hmi_match_frame(const hmi_match_t *match, const hmi_response_t *frame) {
+    if (match->cmd >= 0 && frame->cmd != match->cmd) {
+        return 0;
+    }
+    if (match->sub_cmd >= 0 && (frame->length < 1 || frame->data[0] != match->sub_cmd)) {
+        return 0;
+    }
+    if (match->screen_id >= 0 &&
+        (frame->length < 3 || ((frame->data[1] << 8) | frame->data[2]) != match->screen_id)) {
+        return 0;
+    }
+    if (match->control_id >= 0 &&
+        (frame->length < 5 || ((frame->data[3] << 8) | frame->data[4]) != match->control_id)) {
+        return 0;
+    }
+    return 1;
+}
+
+void hmi_dispatch_frame(hmi_controller_t *hmi, const hmi_response_t *frame) {
+    hmi_dispatch_t *d = hmi->dispatch;
+    if (!d) {
+        return;
+    }
+
+    pthread_mutex_lock(&d->lock);
+
+    // 優先交給等待中的請求
+    pending_t *best = NULL;
+    for (int i = 0; i < HMI_MAX_PENDING; i++) {
+        pending_t *p = &d->pending[i];
+        if (p->in_use && !p->done && hmi_match_frame(&p->match, frame) &&
+            (!best || (int32_t)(p->seq - best->seq) < 0)) {
+            best = p;
+        }
+    }
+    if (best) {
+        if (hmi->stats) {
+            hmi_stats_time(hmi->stats->rtt_hist, hmi_time_ns() - best->start_ns);
+        }
+        best->cmd = frame->cmd;
+        best->length = frame->length;
+        if (frame->length > 0) {
+            memcpy(best->data, frame->data, frame->length);
+        }
+        best->done = 1;
+        d->generation++;
+        pthread_cond_broadcast(&d->completed);
+        pthread_mutex_unlock(&d->lock);
+        return;
+    }
+
+    // 主動上報的事件，解鎖後呼叫回呼，回呼中可以再訂閱或退訂；
+    // active 計數讓 hmi_unsubscribe 等待已取出的回呼執行完畢
+    hmi_event_cb_t callbacks[HMI_MAX_SUBSCRIPTIONS];
+    void *users[HMI_MAX_SUBSCRIPTIONS];
+    uint8_t handles[HMI_MAX_SUBSCRIPTIONS];
+    int count = 0;
+    for (int i = 0; i < HMI_MAX_SUBSCRIPTIONS; i++) {
+        subscription_t *s = &d->subs[i];
+        if (s->in_use && hmi_match_frame(&s->match, frame)) {
+            callbacks[count] = s->callback;
+            users[count] = s->user;
+            handles[count] = i;
+            s->active++;
+            count++;
+        }
+    }
+    if (count == 0) {
+        d->unhandled++;
+        HMI_STAT_ADD(hmi, unhandled, 1);
+    } else {
+        HMI_STAT_ADD(hmi, events, 1);
+    }
+    pthread_mutex_unlock(&d->lock);
+
+    hmi_dispatch_t *outer = tls_dispatching;
+    tls_dispatching = d;
+    for (int i = 0; i < count; i++) {
+        callbacks[i](hmi, frame, users[i]);
+        pthread_mutex_lock(&d->lock);
+        if (--d->subs[handles[i]].active == 0) {
+            pthread_cond_broadcast(&d->idle);
+        }
+        pthread_mutex_unlock(&d->lock);
+    }
+    tls_dispatching = outer;
+}
+
+// ============================================================================
+// 等待回應
+// ============================================================================
+
+int hmi_rx_threaded(hmi_controller_t *hmi) {
+    return hmi->dispatch && __atomic_load_n(&hmi->dispatch->running, __ATOMIC_ACQUIRE);
+}
+
+int hmi_expect(hmi_controller_t *hmi, const hmi_match_t *match) {
+    hmi_dispatch_t *d = dispatch_get(hmi);
+    if (!d) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&d->lock);
+    int slot = -1;
+    for (int i = 0; i < HMI_MAX_PENDING; i++) {
+        pending_t *p = &d->pending[i];
+        if (!p->in_use) {
+            p->in_use = 1;
+            p->done = 0;
+            p->seq = d->seq++;
+            p->start_ns = hmi_time_ns();
+            p->match = *match;
+            slot = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&d->lock);
+    return slot;
+}
+
+void hmi_expect_cancel(hmi_controller_t *hmi, int slot) {
+    hmi_dispatch_t *d = hmi->dispatch;
+    if (!d || slot < 0) {
+        return;
+    }
+    pthread_mutex_lock(&d->lock);
+    d->pending[slot].in_use = 0;
+    pthread_mutex_unlock(&d->lock);
+}
+
+uint32_t hmi_expect_generation(hmi_controller_t *hmi) {
+    return hmi->dispatch ? __atomic_load_n(&hmi->dispatch->generation, __ATOMIC_ACQUIRE) : 0;
+}
+
+int hmi_expect_poll(hmi_controller_t *hmi, int slot, hmi_response_t *response, uint8_t *buffer, uint16_t size) {
+    hmi_dispatch_t *d = hmi->dispatch;
+    pending_t *p = &d->pending[slot];
+
+    pthread_mutex_lock(&d->lock);
+    if (!p->done) {
+        pthread_mutex_unlock(&d->lock);
+        return -1;
+    }
+
+    int ret = 0;
+    if (p->length > size) {
+        ret = -2; // 緩衝區不足
+    } else {
+        response->cmd = p->cmd;
+        response->length = p->length;
+        response->data = p->length > 0 ? buffer : NULL;
+        if (p->length > 0) {
+            memcpy(buffer, p->data, p->length);
+        }
+    }
+    p->in_use = 0;
+    pthread_mutex_unlock(&d->lock);
+    return ret;
+}
+
+int hmi_expect_wait_any(hmi_controller_t *hmi, uint32_t generation, uint64_t deadline_ns) {
+    hmi_dispatch_t *d = hmi->dispatch;
+
+    // 先送出批量緩衝區中的請求
+    if (hmi->tx_len > 0 && hmi_tx_push(hmi) < 0) {
+        return -1;
+    }
+
+    uint64_t now = hmi_time_ns();
+    if (now >= deadline_ns) {
+        return -1;
+    }
+
+    if (hmi_rx_threaded(hmi)) {
+        // 在接收線程的回呼中等待：能讀取回應的只有自己，直接失敗而不是等到超時
+        if (hmi_rx_on_reader()) {
+            return -1;
+        }
+        struct timespec ts = {
+            .tv_sec = deadline_ns / 1000000000ULL,
+            .tv_nsec = deadline_ns % 1000000000ULL
+        };
+        pthread_mutex_lock(&d->lock);
+        while (d->generation == generation && d->running) {
+            if (pthread_cond_timedwait(&d->completed, &d->lock, &ts) != 0) {
+                break;
+            }
+        }
+        pthread_mutex_unlock(&d->lock);
+        return 0;
+    }
+
+    // 沒有接收線程：自己讀取一個幀並分發
+    hmi_response_t frame;
+    int remaining = (int)((deadline_ns - now + 999999ULL) / 1000000ULL);
+    if (hmi_receive_view(hmi, &frame, remaining) == 0) {
+        hmi_dispatch_frame(hmi, &frame);
+    }
+    return 0;
+}
+
+int hmi_expect_wait(hmi_controller_t *hmi, int slot, hmi_response_t *response, uint8_t *buffer, uint16_t size,
+                    int timeout_ms) {
+    uint64_t deadline = hmi_time_ns() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000000ULL;
+
+    for (;;) {
+        uint32_t generation = hmi_expect_generation(hmi);
+        int ret = hmi_expect_poll(hmi, slot, response, buffer, size);
+        if (ret != -1) {
+            return ret == 0 ? 0 : -1;
+        }
+        if (hmi_time_ns() >= deadline) {
+            hmi_expect_cancel(hmi, slot);
+            HMI_STAT_ADD(hmi, timeouts, 1);
+            return -1;
+        }
+        if (hmi_expect_wait_any(hmi, generation, deadline) < 0 && hmi_time_ns() < deadline) {
+            hmi_expect_cancel(hmi, slot);
+            return -1;
+        }
+    }
+}
+
+int hmi_transact(hmi_controller_t *hmi, const uint8_t *frame, uint16_t length, const hmi_match_t *match,
+                 hmi_response_t *response, uint8_t *buffer, uint16_t size, int timeout_ms) {
+    // 先登記再發送，回應不會在登記之前到達
+    int slot = hmi_expect(hmi, match);
+    if (slot < 0) {
+        return -1;
+    }
+    if (hmi_send_command(hmi, (uint8_t*)frame, length) < 0) {
+        hmi_expect_cancel(hmi, slot);
+        return -1;
+    }
+    return hmi_expect_wait(hmi, slot, response, buffer, size, timeout_ms);
+}
+
+int hmi_expect_view(hmi_controller_t *hmi, const hmi_match_t *match, hmi_response_t *response, int timeout_ms) {
+    int slot = hmi_expect(hmi, match);
+    if (slot < 0) {
+        return -1;
+    }
+    return hmi_expect_wait(hmi, slot, response, tls_view_buf, HMI_FRAME_MAX, timeout_ms);
+}
+
+// ============================================================================
+// 事件訂閱
+// ============================================================================
+
+int hmi_subscribe(hmi_controller_t *hmi, uint8_t cmd, int sub_cmd, int screen_id, int control_id,
+                  hmi_event_cb_t callback, void *user) {
+    if (!hmi || !callback) {
+        return -1;
+    }
+    hmi_dispatch_t *d = dispatch_get(hmi);
+    if (!d) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&d->lock);
+    int handle = -1;
+    for (int i = 0; i < HMI_MAX_SUBSCRIPTIONS; i++) {
+        subscription_t *s = &d->subs[i];
+        if (!s->in_use) {
+            s->in_use = 1;
+            s->match.cmd = cmd;
+            s->match.sub_cmd = sub_cmd;
+            s->match.screen_id = screen_id;
+            s->match.control_id = control_id;
+            s->callback = callback;
+            s->user = user;
+            handle = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&d->lock);
+    return handle;
+}
+
+int hmi_unsubscribe(hmi_controller_t *hmi, int handle) {
+    if (!hmi || !hmi->dispatch || handle < 0 || handle >= HMI_MAX_SUBSCRIPTIONS) {
+        return -1;
+    }
+    hmi_dispatch_t *d = hmi->dispatch;
+    pthread_mutex_lock(&d->lock);
+    d->subs[handle].in_use = 0;
+
+    // 等待其他線程中已取出的回呼執行完畢，返回後回呼不會再使用 user；
+    // 在本分發器的回呼中退訂時不等待，以免等待自己
+    while (d->subs[handle].active > 0 && tls_dispatching != d) {
+        pthread_cond_wait(&d->idle, &d->lock);
+    }
+    pthread_mutex_unlock(&d->lock);
+    return 0;
+}
+
+int hmi_poll_events(hmi_controller_t *hmi, int timeout_ms) {
+    if (!hmi || !hmi->is_connected) {
+        return -1;
+    }
+    if (hmi_rx_threaded(hmi)) {
+        return 0; // 由接收線程分發
+    }
+    if (!dispatch_get(hmi)) {
+        return -1;
+    }
+
+    // 等待第一個幀，之後把已到達的幀全部分發
+    int count = 0;
+    hmi_response_t frame;
+    while (hmi_receive_view(hmi, &frame, count == 0 ? timeout_ms : 0) == 0) {
+        hmi_dispatch_frame(hmi, &frame);
+        count++;
+    }
+    return count;
+}
+
+// ============================================================================
+// 接收線程
+// ============================================================================
+
+int hmi_rx_on_reader(void) {
+    return tls_rx_reader;
+}
+
+int hmi_rx_pump(hmi_controller_t *hmi) {
+    uint16_t space;
+    uint8_t *dst = hmi_parser_space(&hmi->rx, &space);
+    ssize_t n = read(hmi->fd, dst, space);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    }
+    if (n == 0) {
+        return 0;
+    }
+    hmi_parser_commit(&hmi->rx, n);
+
+    hmi_response_t frame;
+    tls_rx_reader = 1;
+    while (hmi_parser_next(&hmi->rx, &frame) == 0) {
+        hmi_stats_rx(hmi, &frame);
+        if (hmi->shadow) {
+            hmi_shadow_rx(hmi, &frame);
+        }
+        if (hmi->mirror) {
+            hmi_mirror_rx(hmi, &frame);
+        }
+        if (hmi->capture) {
+            hmi_capture_frame(hmi, HMI_CAP_RX, frame.cmd, frame.data, frame.length);
+        }
+        hmi_dispatch_frame(hmi, &frame);
+    }
+    tls_rx_reader = 0;
+    return (int)n;
+}
+
+static void *rx_thread(void *arg) {
+    hmi_controller_t *hmi = (hmi_controller_t*)arg;
+    hmi_dispatch_t *d = hmi->dispatch;
+    struct pollfd pfd[2] = {
+        { .fd = hmi->fd, .events = POLLIN },
+        { .fd = d->wake_fd, .events = POLLIN }
+    };
+
+    while (__atomic_load_n(&d->running, __ATOMIC_ACQUIRE)) {
+        int ret = poll(pfd, 2, -1);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (pfd[1].revents) {
+            break;
+        }
+        if (pfd[0].revents & POLLIN) {
+            if (hmi_rx_pump(hmi) < 0) {
+                break;
+            }
+        } else if (pfd[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            printf("接收線程: 串口錯誤，停止接收\n");
+            break;
+        }
+    }
+
+    // 喚醒仍在等待的呼叫者，讓它們按超時處理
+    pthread_mutex_lock(&d->lock);
+    d->running = 0;
+    pthread_cond_broadcast(&d->completed);
+    pthread_mutex_unlock(&d->lock);
+    return NULL;
+}
+
+int hmi_rx_start(hmi_controller_t *hmi) {
+    if (!hmi || !hmi->is_connected) {
+        return -1;
+    }
+    hmi_dispatch_t *d = dispatch_get(hmi);
+    if (!d) {
+        return -1;
+    }
+    if (d->wake_fd >= 0) {
+        if (__atomic_load_n(&d->running, __ATOMIC_ACQUIRE)) {
+            return 0; // 已啟動
+        }
+        // 接收線程因串口錯誤已退出：回收後重新啟動
+        pthread_join(d->thread, NULL);
+        close(d->wake_fd);
+        d->wake_fd = -1;
+    }
+    if (d->running) {
+        return -1; // 已由管理器接收
+    }
+
+    d->wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (d->wake_fd < 0) {
+        return -1;
+    }
+    d->running = 1;
+    if (pthread_create(&d->thread, NULL, rx_thread, hmi) != 0) {
+        d->running = 0;
+        close(d->wake_fd);
+        d->wake_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int hmi_rx_stop(hmi_controller_t *hmi) {
+    hmi_dispatch_t *d = hmi ? hmi->dispatch : NULL;
+    if (!d || d->wake_fd < 0) {
+        return -1;
+    }
+
+    uint64_t one = 1;
+    if (write(d->wake_fd, &one, sizeof(one)) != sizeof(one)) {
+        return -1;
+    }
+    pthread_join(d->thread, NULL);
+    close(d->wake_fd);
+    d->wake_fd = -1;
+    d->running = 0;
+    return 0;
+}
+
+// 由多屏管理器的工作線程接收：等待回應的呼叫者不再自行讀取串口
+int hmi_rx_attach(hmi_controller_t *hmi) {
+    hmi_dispatch_t *d = dispatch_get(hmi);
+    if (!d || d->running) {
+        return -1;
+    }
+    __atomic_store_n(&d->running, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void hmi_rx_detach(hmi_controller_t *hmi) {
+    hmi_dispatch_t *d = hmi->dispatch;
+    if (!d || d->wake_fd >= 0) {
+        return;
+    }
+    pthread_mutex_lock(&d->lock);
+    d->running = 0;
+    pthread_cond_broadcast(&d->completed);
+    pthread_mutex_unlock(&d->lock);
+}
+
+uint32_t hmi_rx_unhandled(hmi_controller_t *hmi) {
+    return hmi && hmi->dispatch ? hmi->dispatch->unhandled : 0;
+}
@@ -0,0 +1,468 @@
+#include "dc_hmi_internal.h"
+
+// ============================================================================
+// 繪圖錄製
+// ============================================================================
+//
+// 錄製期間的基本繪圖和清屏記入顯示列表，每項帶當時的前景色和背景色；顏色設置只改
+// hmi->fg_color/bg_color，不發送。結束時依次：
+//   1. 最後一次清屏之前的繪圖全部丟棄
+//   2. 被之後的實心矩形完全蓋住的圖形丟棄
+//   3. 同色、共線且相接或重疊的點和線段合併為一條線段（只處理水平、豎直和 45 度，
+//      這些方向上線段覆蓋的像素是確定的，合併前後畫出的像素相同）
+//   4. 不改變重疊部分先後次序的前提下，把同色的圖形提前排在一起
+//   5. 按需發送顏色（前景和背景都要換時用一個 0x40 幀），一次寫出
+// 文字的寬度取決於字庫，不計算外框，視為與所有圖形重疊：不丟棄、不越過它重排。
+
+#define DRAW_TEXT_MAX  (HMI_FRAME_MAX - 16)
+#define MERGE_WINDOW   64            // 合併時向前找的項數上限
+
+typedef struct {
+    uint8_t type;
+    uint8_t background;          // 文字：是否畫背景色
+    uint8_t font;
+    uint8_t dead;                // 已丟棄或併入其他項
+    uint16_t fg, bg;
+    uint16_t a[4];               // 點 x y，線和矩形 x0 y0 x1 y1，圓 x y r
+    int32_t box[4];              // 外框 [x0, x1] x [y0, y1]（含端點）
+    uint32_t text;               // 文字在 text 緩衝區中的位置（以 '\0' 結尾）
+} draw_op_t;
+
+struct hmi_drawlist {
+    draw_op_t *ops;
+    uint32_t count;
+    uint32_t capacity;
+    char *text;
+    uint32_t text_len;
+    uint32_t text_capacity;
+    uint16_t dev_fg, dev_bg;     // 開始錄製時串口屏的顏色
+};
+
+int hmi_begin_drawing(hmi_controller_t *hmi) {
+    if (!hmi || !hmi->is_connected) {
+        return -1;
+    }
+    if (hmi->drawlist) {
+        return 0;
+    }
+    hmi_drawlist_t *dl = calloc(1, sizeof(hmi_drawlist_t));
+    if (!dl) {
+        return -1;
+    }
+    dl->dev_fg = hmi->fg_color;
+    dl->dev_bg = hmi->bg_color;
+    hmi->drawlist = dl;
+    return 0;
+}
+
+void hmi_drawlist_free(hmi_controller_t *hmi) {
+    if (hmi->drawlist) {
+        free(hmi->drawlist->ops);
+        free(hmi->drawlist->text);
+        free(hmi->drawlist);
+        hmi->drawlist = NULL;
+    }
+}
+
+static void op_box(draw_op_t *op) {
+    switch (op->type) {
+        case DRAW_OP_POINT:
+            op->box[0] = op->box[1] = op->a[0];
+            op->box[2] = op->box[3] = op->a[1];
+            break;
+        case DRAW_OP_LINE:
+        case DRAW_OP_RECT:
+        case DRAW_OP_RECT_FILL:
+            op->box[0] = op->a[0] < op->a[2] ? op->a[0] : op->a[2];
+            op->box[1] = op->a[0] < op->a[2] ? op->a[2] : op->a[0];
+            op->box[2] = op->a[1] < op->a[3] ? op->a[1] : op->a[3];
+            op->box[3] = op->a[1] < op->a[3] ? op->a[3] : op->a[1];
+            break;
+        case DRAW_OP_CIRCLE:
+        case DRAW_OP_CIRCLE_FILL:
+            op->box[0] = (int32_t)op->a[0] - op->a[2];
+            op->box[1] = (int32_t)op->a[0] + op->a[2];
+            op->box[2] = (int32_t)op->a[1] - op->a[2];
+            op->box[3] = (int32_t)op->a[1] + op->a[2];
+            break;
+        default:
+            // 清屏和文字視為覆蓋整個屏幕
+            op->box[0] = op->box[2] = INT32_MIN;
+            op->box[1] = op->box[3] = INT32_MAX;
+            break;
+    }
+}
+
+int hmi_drawlist_add(hmi_controller_t *hmi, int type, uint16_t a0, uint16_t a1, uint16_t a2, uint16_t a3,
+                     uint8_t background, uint8_t font, const char *text) {
+    hmi_drawlist_t *dl = hmi->drawlist;
+    if (dl->count == dl->capacity) {
+        uint32_t capacity = dl->capacity ? dl->capacity * 2 : 64;
+        draw_op_t *ops = realloc(dl->ops, sizeof(draw_op_t) * capacity);
+        if (!ops) {
+            return -1;
+        }
+        dl->ops = ops;
+        dl->capacity = capacity;
+    }
+
+    draw_op_t *op = &dl->ops[dl->count];
+    memset(op, 0, sizeof(*op));
+    op->type = (uint8_t)type;
+    op->fg = hmi->fg_color;
+    op->bg = hmi->bg_color;
+    op->a[0] = a0;
+    op->a[1] = a1;
+    op->a[2] = a2;
+    op->a[3] = a3;
+    op->background = background;
+    op->font = font;
+    if (text) {
+        size_t length = strlen(text) + 1;
+        if (length > DRAW_TEXT_MAX) {
+            return -1;
+        }
+        if (dl->text_len + length > dl->text_capacity) {
+            uint32_t capacity = dl->text_capacity ? dl->text_capacity : 1024;
+            while (capacity < dl->text_len + length) {
+                capacity *= 2;
+            }
+            char *buf = realloc(dl->text, capacity);
+            if (!buf) {
+                return -1;
+            }
+            dl->text = buf;
+            dl->text_capacity = capacity;
+        }
+        memcpy(dl->text + dl->text_len, text, length);
+        op->text = dl->text_len;
+        dl->text_len += length;
+    }
+    op_box(op);
+    dl->count++;
+    return 0;
+}
+
+// ============================================================================
+// 優化
+// ============================================================================
+
+static int box_overlap(const int32_t *a, const int32_t *b) {
+    return a[0] <= b[1] && b[0] <= a[1] && a[2] <= b[3] && b[2] <= a[3];
+}
+
+static int box_inside(const int32_t *inner, const int32_t *outer) {
+    return inner[0] >= outer[0] && inner[1] <= outer[1] && inner[2] >= outer[2] && inner[3] <= outer[3];
+}
+
+static int uses_bg(const draw_op_t *op) {
+    return op->type == DRAW_OP_CLEAN || (op->type == DRAW_OP_TEXT && op->background);
+}
+
+// 兩項畫出的像素顏色相同，重疊時先後次序不影響結果
+static int same_paint(const draw_op_t *a, const draw_op_t *b) {
+    if (a->type == DRAW_OP_CLEAN || b->type == DRAW_OP_CLEAN || uses_bg(a) != uses_bg(b)) {
+        return 0;
+    }
+    return a->fg == b->fg && (!uses_bg(a) || a->bg == b->bg);
+}
+
+// 交換次序不影響結果
+static int commutes(const draw_op_t *a, const draw_op_t *b) {
+    return !box_overlap(a->box, b->box) || same_paint(a, b);
+}
+
+// 被之後的實心矩形完全蓋住的圖形丟棄；清屏之前的全部丟棄
+static void drop_covered(hmi_drawlist_t *dl) {
+    for (uint32_t j = dl->count; j-- > 0; ) {
+        if (dl->ops[j].type == DRAW_OP_CLEAN) {
+            for (uint32_t i = 0; i < j; i++) {
+                dl->ops[i].dead = 1;
+            }
+            break;
+        }
+    }
+
+    for (uint32_t j = 0; j < dl->count; j++) {
+        const draw_op_t *fill = &dl->ops[j];
+        if (fill->dead || fill->type != DRAW_OP_RECT_FILL) {
+            continue;
+        }
+        for (uint32_t i = 0; i < j; i++) {
+            draw_op_t *op = &dl->ops[i];
+            if (!op->dead && op->type != DRAW_OP_TEXT && op->type != DRAW_OP_CLEAN &&
+                box_inside(op->box, fill->box)) {
+                op->dead = 1;
+            }
+        }
+    }
+}
+
+// 線段所在直線：方向 (dx, dy) 為 (1,0) (0,1) (1,1) (1,-1) 之一，點沒有方向
+static int seg_dir(const draw_op_t *op, int *dx, int *dy) {
+    int ex = (int)op->a[2] - op->a[0];
+    int ey = (int)op->a[3] - op->a[1];
+    if (op->type == DRAW_OP_POINT || (ex == 0 && ey == 0)) {
+        return 0;
+    }
+    if (ex != 0 && ey != 0 && ex != ey && ex != -ey) {
+        return -1;
+    }
+    if (ex < 0 || (ex == 0 && ey < 0)) {
+        ex = -ex;
+        ey = -ey;
+    }
+    *dx = ex > 0;
+    *dy = ey > 0 ? 1 : ey < 0 ? -1 : 0;
+    return 1;
+}
+
+static void seg_ends(const draw_op_t *op, int32_t *x0, int32_t *y0, int32_t *x1, int32_t *y1) {
+    *x0 = op->a[0];
+    *y0 = op->a[1];
+    *x1 = op->type == DRAW_OP_POINT ? op->a[0] : op->a[2];
+    *y1 = op->type == DRAW_OP_POINT ? op->a[1] : op->a[3];
+}
+
+// b 併入 a：兩者在同一條水平、豎直或 45 度直線上且相接或重疊時，a 延長為兩者的並集
+static int seg_merge(draw_op_t *a, const draw_op_t *b) {
+    int dx = 0, dy = 0, bx, by;
+    int ka = seg_dir(a, &dx, &dy);
+    int kb = seg_dir(b, &bx, &by);
+    if (ka < 0 || kb < 0 || (ka && kb && (dx != bx || dy != by))) {
+        return 0;
+    }
+
+    int32_t ax0, ay0, ax1, ay1, bx0, by0, bx1, by1;
+    seg_ends(a, &ax0, &ay0, &ax1, &ay1);
+    seg_ends(b, &bx0, &by0, &bx1, &by1);
+    if (!ka && !kb) {
+        // 兩個點：相同時丟棄後一個，八鄰接時連成線段
+        int32_t ex = bx0 - ax0, ey = by0 - ay0;
+        if (ex < -1 || ex > 1 || ey < -1 || ey > 1) {
+            return 0;
+        }
+        if (ex == 0 && ey == 0) {
+            return 1;
+        }
+        if (ex < 0 || (ex == 0 && ey < 0)) {
+            ex = -ex;
+            ey = -ey;
+        }
+        dx = ex;
+        dy = ey;
+    } else if (!ka) {
+        dx = bx;
+        dy = by;
+    }
+
+    // 直線上的位置 t 與直線編號 c（同一直線上所有點的 c 相同）
+    #define SEG_T(x, y) (dx ? (x) : (y))
+    #define SEG_C(x, y) (dy == 0 ? (y) : dx == 0 ? (x) : dy > 0 ? (y) - (x) : (y) + (x))
+    int32_t c = SEG_C(ax0, ay0);
+    if (SEG_C(bx0, by0) != c || SEG_C(bx1, by1) != c) {
+        return 0;
+    }
+    int32_t a_lo = SEG_T(ax0, ay0), a_hi = SEG_T(ax1, ay1);
+    int32_t b_lo = SEG_T(bx0, by0), b_hi = SEG_T(bx1, by1);
+    if (a_lo > a_hi) {
+        int32_t t = a_lo; a_lo = a_hi; a_hi = t;
+    }
+    if (b_lo > b_hi) {
+        int32_t t = b_lo; b_lo = b_hi; b_hi = t;
+    }
+    if ((a_lo > b_lo ? a_lo : b_lo) > (a_hi < b_hi ? a_hi : b_hi) + 1) {
+        return 0;
+    }
+    int32_t lo = a_lo < b_lo ? a_lo : b_lo;
+    int32_t hi = a_hi > b_hi ? a_hi : b_hi;
+
+    // 由位置換回端點坐標
+    int32_t x0, y0, x1, y1;
+    if (dx) {
+        x0 = lo;
+        x1 = hi;
+        y0 = dy == 0 ? c : dy > 0 ? c + lo : c - lo;
+        y1 = dy == 0 ? c : dy > 0 ? c + hi : c - hi;
+    } else {
+        x0 = x1 = c;
+        y0 = lo;
+        y1 = hi;
+    }
+    #undef SEG_T
+    #undef SEG_C
+    if (x0 < 0 || y0 < 0 || x1 < 0 || y1 < 0 || x0 > 0xFFFF || y0 > 0xFFFF || x1 > 0xFFFF || y1 > 0xFFFF) {
+        return 0;
+    }
+
+    a->type = DRAW_OP_LINE;
+    a->a[0] = (uint16_t)x0;
+    a->a[1] = (uint16_t)y0;
+    a->a[2] = (uint16_t)x1;
+    a->a[3] = (uint16_t)y1;
+    op_box(a);
+    return 1;
+}
+
+// 每個點或線段向前找可以併入的同色點或線段；中間有與它重疊且顏色不同的圖形時停止，
+// 否則提前畫它會改變重疊部分的結果
+static void merge_segments(hmi_drawlist_t *dl) {
+    for (uint32_t k = 1; k < dl->count; k++) {
+        draw_op_t *op = &dl->ops[k];
+        if (op->dead || (op->type != DRAW_OP_POINT && op->type != DRAW_OP_LINE)) {
+            continue;
+        }
+        uint32_t window = MERGE_WINDOW;
+        for (uint32_t i = k; i-- > 0 && window > 0; ) {
+            draw_op_t *prev = &dl->ops[i];
+            if (prev->dead) {
+                continue;
+            }
+            window--;
+            if ((prev->type == DRAW_OP_POINT || prev->type == DRAW_OP_LINE) && prev->fg == op->fg &&
+                seg_merge(prev, op)) {
+                op->dead = 1;
+                break;
+            }
+            if (!commutes(prev, op)) {
+                break;
+            }
+        }
+    }
+}
+
+// 依次取出每一項，並把後面同色、可以越過中間各項的圖形提前到它之後。
+// 被越過的不同色圖形外框合併成一個，新圖形與它不重疊才提前；遇到文字或清屏時停止
+static uint32_t order_by_color(hmi_drawlist_t *dl, uint32_t *order) {
+    uint32_t n = 0;
+    uint8_t *taken = calloc(dl->count, 1);
+    if (!taken) {
+        for (uint32_t i = 0; i < dl->count; i++) {
+            if (!dl->ops[i].dead) {
+                order[n++] = i;
+            }
+        }
+        return n;
+    }
+
+    for (uint32_t i = 0; i < dl->count; i++) {
+        const draw_op_t *head = &dl->ops[i];
+        if (head->dead || taken[i]) {
+            continue;
+        }
+        order[n++] = i;
+        taken[i] = 1;
+
+        int32_t skipped[4] = { INT32_MAX, INT32_MIN, INT32_MAX, INT32_MIN };
+        for (uint32_t k = i + 1; k < dl->count; k++) {
+            const draw_op_t *op = &dl->ops[k];
+            if (op->dead || taken[k]) {
+                continue;
+            }
+            if (same_paint(op, head)) {
+                if (!box_overlap(op->box, skipped)) {
+                    order[n++] = k;
+                    taken[k] = 1;
+                }
+                continue;
+            }
+            if (op->type == DRAW_OP_TEXT || op->type == DRAW_OP_CLEAN) {
+                break;
+            }
+            skipped[0] = op->box[0] < skipped[0] ? op->box[0] : skipped[0];
+            skipped[1] = op->box[1] > skipped[1] ? op->box[1] : skipped[1];
+            skipped[2] = op->box[2] < skipped[2] ? op->box[2] : skipped[2];
+            skipped[3] = op->box[3] > skipped[3] ? op->box[3] : skipped[3];
+        }
+    }
+    free(taken);
+    return n;
+}
+
+// ============================================================================
+// 發送
+// ============================================================================
+
+// 前景和背景都要換時合為一個 0x40 幀
+static int set_colors(hmi_controller_t *hmi, uint16_t fg, uint16_t bg, int fg_stale, int bg_stale) {
+    if (fg_stale && bg_stale) {
+        return hmi_set_colors(hmi, fg, bg);
+    }
+    if (fg_stale) {
+        return hmi_set_fg_color(hmi, fg);
+    }
+    if (bg_stale) {
+        return hmi_set_bg_color(hmi, bg);
+    }
+    return 0;
+}
+
+static int send_op(hmi_controller_t *hmi, hmi_drawlist_t *dl, const draw_op_t *op) {
+    // 只在串口屏上的顏色與這一項不同時發送
+    int fg_stale = op->type != DRAW_OP_CLEAN &&
+                   !((hmi->colors_synced & HMI_COLOR_FG) && hmi->fg_color == op->fg);
+    int bg_stale = uses_bg(op) && !((hmi->colors_synced & HMI_COLOR_BG) && hmi->bg_color == op->bg);
+    if (set_colors(hmi, op->fg, op->bg, fg_stale, bg_stale) < 0) {
+        return -1;
+    }
+
+    switch (op->type) {
+        case DRAW_OP_CLEAN:
+            return hmi_clean_screen(hmi);
+        case DRAW_OP_POINT:
+            return hmi_draw_point(hmi, op->a[0], op->a[1]);
+        case DRAW_OP_LINE:
+            return hmi_draw_line(hmi, op->a[0], op->a[1], op->a[2], op->a[3]);
+        case DRAW_OP_RECT:
+        case DRAW_OP_RECT_FILL:
+            return hmi_draw_rectangle(hmi, op->a[0], op->a[1], op->a[2], op->a[3], op->type == DRAW_OP_RECT_FILL);
+        case DRAW_OP_CIRCLE:
+        case DRAW_OP_CIRCLE_FILL:
+            return hmi_draw_circle(hmi, op->a[0], op->a[1], op->a[2], op->type == DRAW_OP_CIRCLE_FILL);
+        default:
+            return hmi_display_text(hmi, op->a[0], op->a[1], op->background, (font_type_t)op->font,
+                                    dl->text + op->text);
+    }
+}
+
+int hmi_end_drawing(hmi_controller_t *hmi) {
+    if (!hmi || !hmi->drawlist) {
+        return -1;
+    }
+    hmi_drawlist_t *dl = hmi->drawlist;
+    uint16_t want_fg = hmi->fg_color;
+    uint16_t want_bg = hmi->bg_color;
+
+    drop_covered(dl);
+    merge_segments(dl);
+    uint32_t *order = malloc(sizeof(uint32_t) * (dl->count ? dl->count : 1));
+    uint32_t n = order ? order_by_color(dl, order) : 0;
+
+    // 之後的繪圖呼叫直接發送；顏色恢復為串口屏上的狀態，發送時按需切換
+    hmi->drawlist = NULL;
+    hmi->fg_color = dl->dev_fg;
+    hmi->bg_color = dl->dev_bg;
+
+    int cork = !hmi->tx_corked && !hmi->async;
+    if (cork) {
+        hmi_begin_batch(hmi);
+    }
+    int ret = order ? 0 : -1;
+    for (uint32_t i = 0; i < n && ret == 0; i++) {
+        ret = send_op(hmi, dl, &dl->ops[order[i]]);
+    }
+    // 最後設置的顏色沒有被任何圖形用到時也要發出，之後直接繪圖的顏色才正確
+    if (ret == 0) {
+        ret = set_colors(hmi, want_fg, want_bg, want_fg != hmi->fg_color, want_bg != hmi->bg_color);
+    }
+    if (cork && hmi_flush(hmi) < 0) {
+        ret = -1;
+    }
+
+    hmi->fg_color = want_fg;
+    hmi->bg_color = want_bg;
+    free(order);
+    hmi->drawlist = dl;
+    hmi_drawlist_free(hmi);
+    return ret;
+}
@@ -0,0 +1,195 @@
+#include "dc_hmi_internal.h"
+#include <stdarg.h>
+
+// ============================================================================
+// 幀描述表
+// ============================================================================
+//
+// 新增一類指令只需在 hmi_frame_id_t 和這裡各加一項，呼叫 hmi_send_frame 即可。
+
+#define B1(sub)  CMD_CONFIG_BASE, (sub)
+#define RAW(cmd) (cmd), -1
+
+const hmi_frame_desc_t hmi_frame_table[HMI_FRAME_COUNT] = {
+    [HMI_FRAME_SWITCH_SCREEN]    = { B1(CMD_SWITCH_SCREEN),  { ENC_U16 } },
+    [HMI_FRAME_ANIM_SWITCH]      = { B1(CMD_ANIM_SWITCH),    { ENC_U16, ENC_U8, ENC_U8, ENC_U16, ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_READ_SCREEN]      = { B1(CMD_READ_SCREEN),    { ENC_END } },
+    [HMI_FRAME_CONTROL_BYTES]    = { B1(CMD_UPDATE_CONTROL), { ENC_U16, ENC_U16, ENC_BYTES } },
+    [HMI_FRAME_CONTROL_U8]       = { B1(CMD_UPDATE_CONTROL), { ENC_U16, ENC_U16, ENC_U8 } },
+    [HMI_FRAME_CONTROL_U32]      = { B1(CMD_UPDATE_CONTROL), { ENC_U16, ENC_U16, ENC_U32 } },
+    [HMI_FRAME_READ_CONTROL]     = { B1(CMD_READ_CONTROL),   { ENC_U16, ENC_U16 } },
+    [HMI_FRAME_SET_BLINK]        = { B1(CMD_SET_BLINK),      { ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_SET_SCROLL]       = { B1(CMD_SET_SCROLL),     { ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_SET_BK_COLOR]     = { B1(CMD_SET_BK_COLOR),   { ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_SET_FG_COLOR]     = { B1(CMD_SET_FG_COLOR),   { ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_FORMAT_TEXT]      = { B1(CMD_FORMAT_TEXT),    { ENC_U16, ENC_U16, ENC_U8, ENC_U8, ENC_U32 } },
+    [HMI_FRAME_ANIM_FRAME]       = { B1(CMD_ANIM_FRAME),     { ENC_U16, ENC_U16, ENC_U8 } },
+    [HMI_FRAME_ICON_POS]         = { B1(CMD_SET_ICON_POS),   { ENC_U16, ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_ANIM_START]       = { B1(CMD_ANIM_START),     { ENC_U16, ENC_U16 } },
+    [HMI_FRAME_ANIM_STOP]        = { B1(CMD_ANIM_STOP),      { ENC_U16, ENC_U16 } },
+    [HMI_FRAME_ANIM_PAUSE]       = { B1(CMD_ANIM_PAUSE),     { ENC_U16, ENC_U16 } },
+    [HMI_FRAME_CURVE_ADD_CH]     = { B1(CMD_CURVE_ADD_CH),   { ENC_U16, ENC_U16, ENC_U8, ENC_U16 } },
+    [HMI_FRAME_CURVE_DEL_CH]     = { B1(CMD_CURVE_DEL_CH),   { ENC_U16, ENC_U16, ENC_U8 } },
+    [HMI_FRAME_CURVE_DATA]       = { B1(CMD_CURVE_ADD_DATA), { ENC_U16, ENC_U16, ENC_U8, ENC_U16, ENC_BYTES } },
+    [HMI_FRAME_CURVE_CLEAR_CH]   = { B1(CMD_CURVE_CLEAR_CH), { ENC_U16, ENC_U16, ENC_U8 } },
+    [HMI_FRAME_CURVE_SCALE]      = { B1(CMD_CURVE_SCALE),    { ENC_U16, ENC_U16, ENC_U16, ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_CURVE_INSERT]     = { B1(CMD_CURVE_INSERT),   { ENC_U16, ENC_U16, ENC_U8, ENC_U16, ENC_BYTES } },
+    [HMI_FRAME_RECORD_ADD]       = { B1(CMD_RECORD_ADD),     { ENC_U16, ENC_U16, ENC_BYTES } },
+    [HMI_FRAME_RECORD_CLEAR]     = { B1(CMD_RECORD_CLEAR),   { ENC_U16, ENC_U16 } },
+    [HMI_FRAME_RECORD_OFFSET]    = { B1(CMD_RECORD_OFFSET),  { ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_RECORD_COUNT]     = { B1(CMD_RECORD_COUNT),   { ENC_U16, ENC_U16 } },
+    [HMI_FRAME_RECORD_READ]      = { B1(CMD_RECORD_READ),    { ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_RECORD_MODIFY]    = { B1(CMD_RECORD_MODIFY),  { ENC_U16, ENC_U16, ENC_U16, ENC_BYTES } },
+    [HMI_FRAME_RECORD_DELETE]    = { B1(CMD_RECORD_DELETE),  { ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_RECORD_INSERT]    = { B1(CMD_RECORD_INSERT),  { ENC_U16, ENC_U16, ENC_U16, ENC_BYTES } },
+    [HMI_FRAME_RECORD_SELECT]    = { B1(CMD_RECORD_SELECT),  { ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_RECORD_EXPORT]    = { B1(CMD_RECORD_EXPORT),  { ENC_U16, ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_TOUCH_CONFIG]     = { RAW(CMD_TOUCH_CONFIG),     { ENC_U8 } },
+    [HMI_FRAME_TOUCH_CALIBRATE]  = { RAW(CMD_TOUCH_CALIBRATE),  { ENC_END } },
+    [HMI_FRAME_TOUCH_TEST]       = { RAW(CMD_TOUCH_TEST),       { ENC_U8 } },
+    [HMI_FRAME_DRAW_POINT]       = { RAW(CMD_DRAW_POINT),       { ENC_U16, ENC_U16 } },
+    [HMI_FRAME_DRAW_LINE]        = { RAW(CMD_DRAW_LINE),        { ENC_U16, ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_DRAW_RECT]        = { RAW(CMD_DRAW_RECT),        { ENC_U16, ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_DRAW_RECT_FILL]   = { RAW(CMD_DRAW_RECT_FILL),   { ENC_U16, ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_DRAW_CIRCLE]      = { RAW(CMD_DRAW_CIRCLE),      { ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_DRAW_CIRCLE_FILL] = { RAW(CMD_DRAW_CIRCLE_FILL), { ENC_U16, ENC_U16, ENC_U16 } },
+    [HMI_FRAME_TEXT_DISPLAY]     = { RAW(CMD_TEXT_DISPLAY),     { ENC_U16, ENC_U16, ENC_U8, ENC_U8, ENC_BYTES } },
+    [HMI_FRAME_FULL_IMAGE]       = { RAW(CMD_FULL_IMAGE),       { ENC_U16 } },
+    [HMI_FRAME_CUT_IMAGE]        = { RAW(CMD_CUT_IMAGE),        { ENC_U16, ENC_U16, ENC_U16, ENC_U16, ENC_U16, ENC_U16, ENC_U16 } },
+};
+
+// ============================================================================
+// 編碼
+// ============================================================================
+
+// 第一遍只計算長度，變長字段需要讀取參數
+static uint32_t frame_length(const hmi_frame_desc_t *desc, va_list ap) {
+    uint32_t length = 2 + (desc->sub_cmd >= 0 ? 1 : 0) + FRAME_TAIL_SIZE;
+
+    for (int i = 0; i < HMI_ENC_FIELDS && desc->fields[i] != ENC_END; i++) {
+        switch (desc->fields[i]) {
+            case ENC_U8:
+                (void)va_arg(ap, unsigned);
+                length += 1;
+                break;
+            case ENC_U16:
+                (void)va_arg(ap, unsigned);
+                length += 2;
+                break;
+            case ENC_U32:
+                (void)va_arg(ap, unsigned);
+                length += 4;
+                break;
+            case ENC_BYTES:
+                (void)va_arg(ap, const void*);
+                length += va_arg(ap, unsigned);
+                break;
+        }
+    }
+    return length;
+}
+
+static void encode_fields(uint8_t *dst, const hmi_frame_desc_t *desc, va_list ap) {
+    static const uint8_t tail[] = FRAME_TAIL;
+
+    *dst++ = FRAME_HEADER;
+    *dst++ = desc->cmd;
+    if (desc->sub_cmd >= 0) {
+        *dst++ = (uint8_t)desc->sub_cmd;
+    }
+
+    for (int i = 0; i < HMI_ENC_FIELDS && desc->fields[i] != ENC_END; i++) {
+        unsigned value;
+        switch (desc->fields[i]) {
+            case ENC_U8:
+                *dst++ = (uint8_t)va_arg(ap, unsigned);
+                break;
+            case ENC_U16:
+                value = va_arg(ap, unsigned);
+                *dst++ = value >> 8;
+                *dst++ = value & 0xFF;
+                break;
+            case ENC_U32:
+                value = va_arg(ap, unsigned);
+                *dst++ = (value >> 24) & 0xFF;
+                *dst++ = (value >> 16) & 0xFF;
+                *dst++ = (value >> 8) & 0xFF;
+                *dst++ = value & 0xFF;
+                break;
+            case ENC_BYTES: {
+                const void *data = va_arg(ap, const void*);
+                value = va_arg(ap, unsigned);
+                if (value > 0) {
+                    memcpy(dst, data, value);
+                    dst += value;
+                }
+                break;
+            }
+        }
+    }
+    memcpy(dst, tail, FRAME_TAIL_SIZE);
+}
+
+uint16_t hmi_encode_frame(uint8_t *dst, hmi_frame_id_t id, ...) {
+    const hmi_frame_desc_t *desc = &hmi_frame_table[id];
+    va_list ap, sizing;
+
+    va_start(ap, id);
+    va_copy(sizing, ap);
+    uint32_t length = frame_length(desc, sizing);
+    va_end(sizing);
+    if (length > HMI_FRAME_MAX) {
+        va_end(ap);
+        return 0;
+    }
+    encode_fields(dst, desc, ap);
+    va_end(ap);
+    return (uint16_t)length;
+}
+
+int hmi_send_frame(hmi_controller_t *hmi, hmi_frame_id_t id, ...) {
+    if (!hmi || !hmi->is_connected) {
+        return -1;
+    }
+    const hmi_frame_desc_t *desc = &hmi_frame_table[id];
+    va_list ap, sizing;
+
+    va_start(ap, id);
+    va_copy(sizing, ap);
+    uint32_t length = frame_length(desc, sizing);
+    va_end(sizing);
+    if (length > HMI_FRAME_MAX) {
+        va_end(ap);
+        return -1;
+    }
+
+    // 合併發送模式下可合併的幀交給調度線程，同一控件只保留最新一幀
+    int kind = hmi->coalesce && desc->cmd == CMD_CONFIG_BASE ? hmi_coalesce_kind((uint8_t)desc->sub_cmd) : 0;
+    if (kind) {
+        uint8_t frame[HMI_FRAME_MAX];
+        encode_fields(frame, desc, ap);
+        va_end(ap);
+        return hmi_coalesce_put(hmi, kind, frame, length);
+    }
+
+    // 批量模式中的控件更新先編碼，再嘗試與前一個更新合併
+    if (desc->sub_cmd == CMD_UPDATE_CONTROL && hmi->tx_corked) {
+        uint8_t frame[HMI_FRAME_MAX];
+        encode_fields(frame, desc, ap);
+        va_end(ap);
+        return hmi_tx_update(hmi, frame, length);
+    }
+
+    // 批量模式直接編碼到發送緩衝區，省去一次複製
+    uint8_t *dst = hmi_tx_reserve(hmi, length);
+    if (dst) {
+        encode_fields(dst, desc, ap);
+        va_end(ap);
+        return hmi_tx_commit(hmi, length);
+    }
+
+    uint8_t frame[HMI_FRAME_MAX];
+    encode_fields(frame, desc, ap);
+    va_end(ap);
+    return hmi_send_command(hmi, frame, length);
+}
@@ -0,0 +1,256 @@
+#include "dc_hmi_internal.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// ============================================================================
+// 幀緩衝
+// ============================================================================
+//
+// 主機端保存區域在串口屏上的內容（大端 RGB565）。新的一幀轉換到另一個緩衝區後
+// 按 FB_TILE x FB_TILE 分塊比較，變化的塊按行合併為矩形，再裁去矩形邊上沒有變化的
+// 行和列，只把這些矩形以區域圖片幀發出。發送後交換兩個緩衝區，不複製像素。
+// 比較逐行進行：整行相同（最常見）時一次掃過，不同時才逐塊比較這一行。
+
+#define FB_TILE 16
+
+typedef struct {
+    uint16_t x0, y0, x1, y1;     // 左上角和右下角（不含），先以塊為單位，裁剪後為像素
+} fb_rect_t;
+
+struct hmi_fb {
+    uint16_t x, y;               // 區域在屏幕上的位置
+    uint16_t width, height;
+    uint16_t tiles_x, tiles_y;
+    uint32_t pitch;              // 每行字節數
+    uint8_t *shown;              // 串口屏上的內容
+    uint8_t *next;               // 本次 present 的內容
+    fb_rect_t *rects;            // 最多每塊一個
+    int32_t *open;               // 按起始列記錄上一行延續下來的矩形
+    uint8_t *dirty;              // 當前一行塊中每塊是否變化
+    int valid;                   // shown 與串口屏一致
+};
+
+hmi_fb_t *hmi_fb_create(uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    if (width == 0 || height == 0) {
+        return NULL;
+    }
+    hmi_fb_t *fb = calloc(1, sizeof(hmi_fb_t));
+    if (!fb) {
+        return NULL;
+    }
+    fb->x = x;
+    fb->y = y;
+    fb->width = width;
+    fb->height = height;
+    fb->tiles_x = (width + FB_TILE - 1) / FB_TILE;
+    fb->tiles_y = (height + FB_TILE - 1) / FB_TILE;
+    fb->pitch = (uint32_t)width * 2;
+    fb->shown = malloc((size_t)fb->pitch * height);
+    fb->next = malloc((size_t)fb->pitch * height);
+    fb->rects = malloc(sizeof(fb_rect_t) * fb->tiles_x * fb->tiles_y);
+    fb->open = malloc(sizeof(int32_t) * fb->tiles_x);
+    fb->dirty = malloc(fb->tiles_x);
+    if (!fb->shown || !fb->next || !fb->rects || !fb->open || !fb->dirty) {
+        hmi_fb_destroy(fb);
+        return NULL;
+    }
+    return fb;
+}
+
+void hmi_fb_destroy(hmi_fb_t *fb) {
+    if (!fb) {
+        return;
+    }
+    free(fb->shown);
+    free(fb->next);
+    free(fb->rects);
+    free(fb->open);
+    free(fb->dirty);
+    free(fb);
+}
+
+void hmi_fb_invalidate(hmi_fb_t *fb) {
+    if (fb) {
+        fb->valid = 0;
+    }
+}
+
+// ============================================================================
+// 比較
+// ============================================================================
+
+// 兩段字節是否不同；16 字節以上時把差異 OR 到一個向量中最後判斷一次，
+// 不足 16 字節的尾部與前面重疊再讀一次
+static int span_differs(const uint8_t *a, const uint8_t *b, uint32_t n) {
+#if defined(__SSE2__)
+    if (n >= 16) {
+        __m128i diff = _mm_setzero_si128();
+        for (uint32_t i = 0; i + 16 <= n; i += 16) {
+            diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a + i)),
+                                                    _mm_loadu_si128((const __m128i*)(b + i))));
+        }
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a + n - 16)),
+                                                _mm_loadu_si128((const __m128i*)(b + n - 16))));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF;
+    }
+#elif defined(__aarch64__)
+    if (n >= 16) {
+        uint8x16_t diff = vdupq_n_u8(0);
+        for (uint32_t i = 0; i + 16 <= n; i += 16) {
+            diff = vorrq_u8(diff, veorq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+        }
+        diff = vorrq_u8(diff, veorq_u8(vld1q_u8(a + n - 16), vld1q_u8(b + n - 16)));
+        return vmaxvq_u8(diff) != 0;
+    }
+#endif
+    return memcmp(a, b, n) != 0;
+}
+
+// 像素區域 [x0, x1) x [y0, y1) 內是否有變化
+static int area_differs(const hmi_fb_t *fb, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+    size_t offset = (size_t)y0 * fb->pitch + (size_t)x0 * 2;
+    for (uint16_t y = y0; y < y1; y++, offset += fb->pitch) {
+        if (span_differs(fb->shown + offset, fb->next + offset, (uint32_t)(x1 - x0) * 2)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 標記一行塊中變化的塊，返回變化的塊數
+static uint16_t mark_tiles(hmi_fb_t *fb, uint16_t ty) {
+    uint16_t y0 = ty * FB_TILE;
+    uint16_t y1 = y0 + FB_TILE < fb->height ? y0 + FB_TILE : fb->height;
+    uint16_t marked = 0;
+    memset(fb->dirty, 0, fb->tiles_x);
+
+    for (uint16_t y = y0; y < y1 && marked < fb->tiles_x; y++) {
+        size_t offset = (size_t)y * fb->pitch;
+        if (!span_differs(fb->shown + offset, fb->next + offset, fb->pitch)) {
+            continue;
+        }
+        for (uint16_t tx = 0; tx < fb->tiles_x; tx++) {
+            uint32_t x0 = (uint32_t)tx * FB_TILE * 2;
+            uint32_t n = x0 + FB_TILE * 2 < fb->pitch ? FB_TILE * 2 : fb->pitch - x0;
+            if (!fb->dirty[tx] && span_differs(fb->shown + offset + x0, fb->next + offset + x0, n)) {
+                fb->dirty[tx] = 1;
+                marked++;
+            }
+        }
+    }
+    return marked;
+}
+
+// 變化的塊按行找出連續段，與上一行起止列相同的矩形向下延伸，返回矩形數
+static uint32_t collect_tiles(hmi_fb_t *fb) {
+    uint32_t count = 0;
+    for (uint16_t tx = 0; tx < fb->tiles_x; tx++) {
+        fb->open[tx] = -1;
+    }
+
+    for (uint16_t ty = 0; ty < fb->tiles_y; ty++) {
+        if (mark_tiles(fb, ty) == 0) {
+            continue;
+        }
+        for (uint16_t tx = 0; tx < fb->tiles_x; ) {
+            uint16_t start = tx;
+            while (tx < fb->tiles_x && fb->dirty[tx]) {
+                tx++;
+            }
+            if (tx == start) {
+                tx++;
+                continue;
+            }
+
+            int32_t r = fb->open[start];
+            if (r >= 0 && fb->rects[r].x1 == tx && fb->rects[r].y1 == ty) {
+                fb->rects[r].y1 = ty + 1;
+            } else {
+                fb->rects[count] = (fb_rect_t){ start, ty, tx, ty + 1 };
+                fb->open[start] = (int32_t)count++;
+            }
+        }
+    }
+    return count;
+}
+
+// 塊坐標換算為像素，並裁去四邊沒有變化的行和列
+static void trim_rect(const hmi_fb_t *fb, fb_rect_t *r) {
+    r->x0 *= FB_TILE;
+    r->y0 *= FB_TILE;
+    r->x1 = r->x1 * FB_TILE < fb->width ? r->x1 * FB_TILE : fb->width;
+    r->y1 = r->y1 * FB_TILE < fb->height ? r->y1 * FB_TILE : fb->height;
+
+    while (!area_differs(fb, r->x0, r->y0, r->x1, r->y0 + 1)) {
+        r->y0++;
+    }
+    while (!area_differs(fb, r->x0, r->y1 - 1, r->x1, r->y1)) {
+        r->y1--;
+    }
+    while (!area_differs(fb, r->x0, r->y0, r->x0 + 1, r->y1)) {
+        r->x0++;
+    }
+    while (!area_differs(fb, r->x1 - 1, r->y0, r->x1, r->y1)) {
+        r->x1--;
+    }
+}
+
+// ============================================================================
+// 顯示
+// ============================================================================
+
+int hmi_fb_present(hmi_controller_t *hmi, hmi_fb_t *fb, const uint8_t *pixels, uint32_t stride, int format) {
+    if (!hmi || !fb || !pixels) {
+        return -1;
+    }
+    if (stride == 0) {
+        stride = (uint32_t)fb->width * format;
+    }
+    for (uint16_t y = 0; y < fb->height; y++) {
+        if (hmi_rgb565_convert(fb->next + (size_t)y * fb->pitch, pixels + (size_t)y * stride, fb->width,
+                               format) < 0) {
+            return -1;
+        }
+    }
+
+    uint32_t count;
+    if (fb->valid) {
+        count = collect_tiles(fb);
+        for (uint32_t i = 0; i < count; i++) {
+            trim_rect(fb, &fb->rects[i]);
+        }
+    } else {
+        fb->rects[0] = (fb_rect_t){ 0, 0, fb->width, fb->height };
+        count = 1;
+    }
+
+    // 同步模式下所有矩形合併為一次寫入
+    int cork = count > 1 && !hmi->tx_corked && !hmi->async;
+    if (cork) {
+        hmi_begin_batch(hmi);
+    }
+
+    int ret = 0;
+    uint32_t sent = 0;
+    for (uint32_t i = 0; i < count && ret == 0; i++) {
+        const fb_rect_t *r = &fb->rects[i];
+        ret = hmi_draw_image(hmi, fb->x + r->x0, fb->y + r->y0, r->x1 - r->x0, r->y1 - r->y0,
+                             fb->next + (size_t)r->y0 * fb->pitch + (size_t)r->x0 * 2, fb->pitch,
+                             HMI_PIXEL_RGB565);
+        sent += (uint32_t)(r->x1 - r->x0) * (r->y1 - r->y0);
+    }
+
+    if (cork && hmi_flush(hmi) < 0) {
+        ret = -1;
+    }
+
+    // 發送失敗時串口屏上的內容未知，下次整個區域重發
+    uint8_t *swap = fb->shown;
+    fb->shown = fb->next;
+    fb->next = swap;
+    fb->valid = ret == 0;
+    return ret < 0 ? -1 : (int)sent;
+}
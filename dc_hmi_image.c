@@ -0,0 +1,302 @@
+#include "dc_hmi_internal.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define IMAGE_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// ============================================================================
+// 圖片
+// ============================================================================
+//
+// 全屏圖片: EE 31 image_id(2) FF FC FF FF
+// 區域圖片: EE 32 x(2) y(2) width(2) height(2) 像素... FF FC FF FF
+//           像素為大端 RGB565，逐行排列；每幀自帶坐標，大圖按幀長上限切成小塊
+// 剪切圖片: EE 33 x(2) y(2) image_id(2) left(2) top(2) width(2) height(2) FF FC FF FF
+//
+// 主機端的 RGB888/RGBA8888 緩衝區逐塊轉換後直接寫入發送緩衝區，不需要整幅圖的中間緩衝。
+
+#define IMAGE_FRAME_OVERHEAD   14
+#define IMAGE_FRAME_PIXELS     ((HMI_FRAME_MAX - IMAGE_FRAME_OVERHEAD) / 2)
+
+int hmi_show_image(hmi_controller_t *hmi, uint16_t image_id) {
+    return hmi_send_frame(hmi, HMI_FRAME_FULL_IMAGE, image_id);
+}
+
+int hmi_cut_image(hmi_controller_t *hmi, uint16_t x, uint16_t y, uint16_t image_id, uint16_t left, uint16_t top,
+                  uint16_t width, uint16_t height) {
+    return hmi_send_frame(hmi, HMI_FRAME_CUT_IMAGE, x, y, image_id, left, top, width, height);
+}
+
+// ============================================================================
+// RGB565 轉換
+// ============================================================================
+//
+// 每個像素輸出高字節 R[7:3] G[7:5]、低字節 G[4:2] B[7:3]（大端）。
+// 向量版本把一個像素放在 32 位通道中（R 在最低字節），一次算出兩個字節：
+//   (v & 0xF8) | (v >> 13 & 0x07) | (v << 3 & 0xE000) | (v >> 11 & 0x1F00)
+// RGBA 的 A 不參與運算；RGB888 先以 pshufb 把每 3 個字節擴展到一個通道。
+// 結果不超過 0xFFFF，但 SSE2 只有有符號的 32→16 位飽和打包，先符號擴展再打包。
+
+typedef void (*convert_fn_t)(uint8_t *dst, const uint8_t *src, uint32_t pixels);
+
+// 尾部處理強制內聯到呼叫者中：AVX2 函數呼叫非 VEX 編碼的 SSE 代碼會付出狀態切換的代價，
+// 逐行轉換時每次呼叫都要付一次，比轉換本身還慢
+#define CONVERT_TAIL static inline __attribute__((always_inline))
+
+CONVERT_TAIL void convert_scalar(uint8_t *dst, const uint8_t *src, uint32_t pixels, uint32_t bpp) {
+    for (uint32_t i = 0; i < pixels; i++, src += bpp) {
+        dst[2 * i] = (src[0] & 0xF8) | (src[1] >> 5);
+        dst[2 * i + 1] = ((src[1] << 3) & 0xE0) | (src[2] >> 3);
+    }
+}
+
+static void rgb_scalar(uint8_t *dst, const uint8_t *src, uint32_t pixels) {
+    convert_scalar(dst, src, pixels, 3);
+}
+
+static void rgba_scalar(uint8_t *dst, const uint8_t *src, uint32_t pixels) {
+    convert_scalar(dst, src, pixels, 4);
+}
+
+// 已是大端 RGB565，直接複製
+static void rgb565_copy(uint8_t *dst, const uint8_t *src, uint32_t pixels) {
+    memcpy(dst, src, (size_t)pixels * 2);
+}
+
+#ifdef IMAGE_X86
+
+CONVERT_TAIL __m128i pack565_sse2(__m128i v) {
+    __m128i q = _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(v, _mm_set1_epi32(0xF8)),
+                     _mm_and_si128(_mm_srli_epi32(v, 13), _mm_set1_epi32(0x07))),
+        _mm_or_si128(_mm_and_si128(_mm_slli_epi32(v, 3), _mm_set1_epi32(0xE000)),
+                     _mm_and_si128(_mm_srli_epi32(v, 11), _mm_set1_epi32(0x1F00))));
+    return _mm_srai_epi32(_mm_slli_epi32(q, 16), 16);
+}
+
+CONVERT_TAIL void rgba_sse2(uint8_t *dst, const uint8_t *src, uint32_t pixels) {
+    uint32_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        __m128i a = pack565_sse2(_mm_loadu_si128((const __m128i*)(src + 4 * i)));
+        __m128i b = pack565_sse2(_mm_loadu_si128((const __m128i*)(src + 4 * i + 16)));
+        _mm_storeu_si128((__m128i*)(dst + 2 * i), _mm_packs_epi32(a, b));
+    }
+    convert_scalar(dst + 2 * i, src + 4 * i, pixels - i, 4);
+}
+
+__attribute__((target("ssse3")))
+CONVERT_TAIL void rgb_ssse3(uint8_t *dst, const uint8_t *src, uint32_t pixels) {
+    const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    uint32_t i = 0;
+    // 每次讀 16 字節只用 12 字節，最後一次讀取不能越過輸入末尾
+    for (; i + 10 <= pixels; i += 8) {
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 3 * i)), expand);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 3 * i + 12)), expand);
+        _mm_storeu_si128((__m128i*)(dst + 2 * i), _mm_packs_epi32(pack565_sse2(a), pack565_sse2(b)));
+    }
+    convert_scalar(dst + 2 * i, src + 3 * i, pixels - i, 3);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i pack565_avx2(__m256i v) {
+    __m256i q = _mm256_or_si256(
+        _mm256_or_si256(_mm256_and_si256(v, _mm256_set1_epi32(0xF8)),
+                        _mm256_and_si256(_mm256_srli_epi32(v, 13), _mm256_set1_epi32(0x07))),
+        _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(v, 3), _mm256_set1_epi32(0xE000)),
+                        _mm256_and_si256(_mm256_srli_epi32(v, 11), _mm256_set1_epi32(0x1F00))));
+    return _mm256_srai_epi32(_mm256_slli_epi32(q, 16), 16);
+}
+
+// 打包在每個 128 位半邊內進行，結果的 64 位塊順序為 0 2 1 3，需重排
+__attribute__((target("avx2")))
+static inline void store565_avx2(uint8_t *dst, __m256i a, __m256i b) {
+    __m256i packed = _mm256_packs_epi32(pack565_avx2(a), pack565_avx2(b));
+    _mm256_storeu_si256((__m256i*)dst, _mm256_permute4x64_epi64(packed, 0xD8));
+}
+
+__attribute__((target("avx2")))
+static void rgba_avx2(uint8_t *dst, const uint8_t *src, uint32_t pixels) {
+    uint32_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        store565_avx2(dst + 2 * i, _mm256_loadu_si256((const __m256i*)(src + 4 * i)),
+                      _mm256_loadu_si256((const __m256i*)(src + 4 * i + 32)));
+    }
+    rgba_sse2(dst + 2 * i, src + 4 * i, pixels - i);
+}
+
+__attribute__((target("avx2")))
+static void rgb_avx2(uint8_t *dst, const uint8_t *src, uint32_t pixels) {
+    const __m256i expand = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    uint32_t i = 0;
+    // pshufb 不跨 128 位半邊，每個半邊各讀 4 個像素
+    for (; i + 18 <= pixels; i += 16) {
+        const uint8_t *p = src + 3 * i;
+        __m256i a = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)),
+                                            _mm_loadu_si128((const __m128i*)(p + 12)), 1);
+        __m256i b = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(p + 24))),
+                                            _mm_loadu_si128((const __m128i*)(p + 36)), 1);
+        store565_avx2(dst + 2 * i, _mm256_shuffle_epi8(a, expand), _mm256_shuffle_epi8(b, expand));
+    }
+    rgb_ssse3(dst + 2 * i, src + 3 * i, pixels - i);
+}
+
+#elif defined(__aarch64__)
+
+// NEON 可直接按通道解交錯，高低字節分別計算後交錯存儲
+static inline void store565_neon(uint8_t *dst, uint8x16_t r, uint8x16_t g, uint8x16_t b) {
+    uint8x16x2_t out;
+    out.val[0] = vorrq_u8(vandq_u8(r, vdupq_n_u8(0xF8)), vshrq_n_u8(g, 5));
+    out.val[1] = vorrq_u8(vandq_u8(vshlq_n_u8(g, 3), vdupq_n_u8(0xE0)), vshrq_n_u8(b, 3));
+    vst2q_u8(dst, out);
+}
+
+static void rgb_neon(uint8_t *dst, const uint8_t *src, uint32_t pixels) {
+    uint32_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        uint8x16x3_t v = vld3q_u8(src + 3 * i);
+        store565_neon(dst + 2 * i, v.val[0], v.val[1], v.val[2]);
+    }
+    convert_scalar(dst + 2 * i, src + 3 * i, pixels - i, 3);
+}
+
+static void rgba_neon(uint8_t *dst, const uint8_t *src, uint32_t pixels) {
+    uint32_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        uint8x16x4_t v = vld4q_u8(src + 4 * i);
+        store565_neon(dst + 2 * i, v.val[0], v.val[1], v.val[2]);
+    }
+    convert_scalar(dst + 2 * i, src + 4 * i, pixels - i, 4);
+}
+
+#endif
+
+static convert_fn_t convert_rgb = rgb_scalar;
+static convert_fn_t convert_rgba = rgba_scalar;
+static const char *convert_kernel = "scalar";
+static pthread_once_t convert_once = PTHREAD_ONCE_INIT;
+
+// 按 CPU 支持的指令集選擇一次
+static void convert_init(void) {
+#ifdef IMAGE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        convert_rgb = rgb_avx2;
+        convert_rgba = rgba_avx2;
+        convert_kernel = "avx2";
+    } else if (__builtin_cpu_supports("ssse3")) {
+        convert_rgb = rgb_ssse3;
+        convert_rgba = rgba_sse2;
+        convert_kernel = "ssse3";
+    } else if (__builtin_cpu_supports("sse2")) {
+        convert_rgba = rgba_sse2;
+        convert_kernel = "sse2";
+    }
+#elif defined(__aarch64__)
+    convert_rgb = rgb_neon;
+    convert_rgba = rgba_neon;
+    convert_kernel = "neon";
+#endif
+}
+
+const char *hmi_rgb565_kernel(void) {
+    pthread_once(&convert_once, convert_init);
+    return convert_kernel;
+}
+
+static convert_fn_t convert_select(int format) {
+    pthread_once(&convert_once, convert_init);
+    switch (format) {
+        case HMI_PIXEL_RGB565:
+            return rgb565_copy;
+        case HMI_PIXEL_RGB888:
+            return convert_rgb;
+        case HMI_PIXEL_RGBA8888:
+            return convert_rgba;
+        default:
+            return NULL;
+    }
+}
+
+int hmi_rgb565_convert(uint8_t *dst, const uint8_t *src, uint32_t pixels, int format) {
+    convert_fn_t convert = convert_select(format);
+    if (!dst || (!src && pixels > 0) || !convert) {
+        return -1;
+    }
+    convert(dst, src, pixels);
+    return 0;
+}
+
+// ============================================================================
+// 區域上傳
+// ============================================================================
+
+// 寫入一塊的幀頭、像素和幀尾，dst 至少 IMAGE_FRAME_OVERHEAD + 2*w*h 字節
+static uint16_t encode_tile(uint8_t *dst, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *src,
+                            uint32_t stride, convert_fn_t convert) {
+    static const uint8_t tail[] = FRAME_TAIL;
+    uint8_t *p = dst;
+    *p++ = FRAME_HEADER;
+    *p++ = CMD_AREA_IMAGE;
+    *p++ = x >> 8;
+    *p++ = x & 0xFF;
+    *p++ = y >> 8;
+    *p++ = y & 0xFF;
+    *p++ = w >> 8;
+    *p++ = w & 0xFF;
+    *p++ = h >> 8;
+    *p++ = h & 0xFF;
+    for (uint16_t row = 0; row < h; row++) {
+        convert(p, src + (size_t)row * stride, w);
+        p += 2 * w;
+    }
+    memcpy(p, tail, FRAME_TAIL_SIZE);
+    return (uint16_t)(p + FRAME_TAIL_SIZE - dst);
+}
+
+int hmi_draw_image(hmi_controller_t *hmi, uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                   const uint8_t *pixels, uint32_t stride, int format) {
+    convert_fn_t convert = convert_select(format);
+    if (!hmi || !hmi->is_connected || !pixels || !convert) {
+        return -1;
+    }
+    if (stride == 0) {
+        stride = (uint32_t)width * format;
+    }
+
+    // 同步模式下整幅圖經發送緩衝區按 HMI_TX_BUF_SIZE 分批寫出，轉換結果直接寫入緩衝區
+    int cork = !hmi->tx_corked && !hmi->async;
+    if (cork) {
+        hmi_begin_batch(hmi);
+    }
+
+    // 寬度超過一幀時按列切塊，每塊盡量多帶幾行
+    uint16_t tile_w = width < IMAGE_FRAME_PIXELS ? width : IMAGE_FRAME_PIXELS;
+    int ret = 0;
+    for (uint16_t tx = 0; tx < width && ret == 0; tx += tile_w) {
+        uint16_t w = width - tx < tile_w ? width - tx : tile_w;
+        uint16_t rows = IMAGE_FRAME_PIXELS / w;
+        for (uint16_t ty = 0; ty < height && ret == 0; ty += rows) {
+            uint16_t h = height - ty < rows ? height - ty : rows;
+            const uint8_t *src = pixels + (size_t)ty * stride + (size_t)tx * format;
+            uint16_t length = IMAGE_FRAME_OVERHEAD + 2 * w * h;
+
+            uint8_t *dst = hmi_tx_reserve(hmi, length);
+            if (dst) {
+                encode_tile(dst, x + tx, y + ty, w, h, src, stride, convert);
+                ret = hmi_tx_commit(hmi, length);
+            } else {
+                uint8_t frame[HMI_FRAME_MAX];
+                encode_tile(frame, x + tx, y + ty, w, h, src, stride, convert);
+                ret = hmi_send_command(hmi, frame, length);
+            }
+        }
+    }
+
+    if (cork && hmi_flush(hmi) < 0) {
+        ret = -1;
+    }
+    return ret;
+}
@@ -0,0 +1,267 @@
+#ifndef DC_HMI_INTERNAL_H
+#define DC_HMI_INTERNAL_H
+
+// 庫內部共用的函數，不對外安裝
+
+#include "dc_hmi_controller.h"
+
+// 運行統計（dc_hmi_stats.c），hmi->stats 為 NULL 時不統計
+int hmi_stats_init(hmi_controller_t *hmi);
+void hmi_stats_free(hmi_controller_t *hmi);
+void hmi_stats_rx(hmi_controller_t *hmi, const hmi_response_t *frame);
+
+// 收發抓包（dc_hmi_capture.c），TX 的 data 為完整幀，RX 為 cmd 加解析出的數據
+void hmi_capture_frame(hmi_controller_t *hmi, uint8_t type, uint8_t cmd, const uint8_t *data, uint16_t length);
+void hmi_capture_free(hmi_controller_t *hmi);
+
+// 控件哈希表（dc_hmi_table.c），條目以 hmi_slot_t 開頭，stride 為條目大小；
+// find 的 created 置 1 時槽頭已寫入鍵，其餘字段由呼叫者初始化
+#define HMI_SLOT_FREE       0
+#define HMI_SLOT_USED       1
+#define HMI_SLOT_DELETED    2    // 已刪除，探測時跳過
+#define HMI_TABLE_LOOKUP    0    // 只查找
+#define HMI_TABLE_CREATE    1    // 找不到時佔用空槽，探測範圍已滿返回 NULL
+#define HMI_TABLE_REPLACE   2    // 探測範圍已滿時覆蓋首選槽
+typedef struct {
+    uint32_t key;                // screen_id << 16 | control_id
+    uint8_t state;               // HMI_SLOT_*
+    uint8_t tag;                 // 同一控件的不同記錄，不區分時為 0
+} hmi_slot_t;
+typedef struct {
+    uint8_t *entries;
+    uint32_t mask;               // 槽數減一，槽數為 2 的冪
+    uint32_t stride;
+    uint32_t probe;              // 最多探測的槽數
+} hmi_table_t;
+int hmi_table_init(hmi_table_t *t, uint32_t entries, uint32_t stride, uint32_t probe);
+void hmi_table_free(hmi_table_t *t);
+void *hmi_table_find(hmi_table_t *t, uint32_t key, uint8_t tag, int mode, int *created);
+void hmi_table_remove(hmi_table_t *t, void *entry);
+static inline void *hmi_table_at(const hmi_table_t *t, uint32_t index) {
+    return t->entries + (size_t)(index & t->mask) * t->stride;
+}
+static inline uint32_t hmi_table_index(const hmi_table_t *t, const void *entry) {
+    return (uint32_t)(((const uint8_t*)entry - t->entries) / t->stride);
+}
+
+// 控件影子緩存（dc_hmi_shadow.c），check 返回 1 表示與上次寫入相同可以丟棄，
+// 0 表示已記錄新值需要發送；發送失敗時以 hmi_shadow_invalidate 清除
+#define SHADOW_TEXT     1        // value 為文本哈希
+#define SHADOW_NUMBER   2        // value 為按鈕狀態或進度條、滑動條、儀表數值
+#define SHADOW_FORMAT   3        // value 為格式化文本的類型、小數位和數值
+#define SHADOW_FG       0        // 顏色：前景
+#define SHADOW_BG       1        // 顏色：背景
+int hmi_shadow_check(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t kind, uint64_t value);
+int hmi_shadow_check_color(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, int which, uint16_t color);
+uint64_t hmi_shadow_hash(const void *data, uint32_t length);
+void hmi_shadow_rx(hmi_controller_t *hmi, const hmi_response_t *frame);
+void hmi_shadow_free(hmi_controller_t *hmi);
+
+// 合併發送（dc_hmi_coalesce.c），kind 返回 0 表示該子指令不合併；
+// put 的 frame 為完整的 0xB1 幀，表已滿時直接提交到異步佇列
+int hmi_coalesce_kind(uint8_t sub_cmd);
+int hmi_coalesce_put(hmi_controller_t *hmi, int kind, const uint8_t *frame, uint16_t length);
+
+// 控件狀態鏡像（dc_hmi_mirror.c），hmi->mirror 為 NULL 時均不做任何事；
+// value 與讀控件回應中控件類型之後的數據相同，type 為 -1 時沿用已知的控件類型
+void hmi_mirror_store(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, int type,
+                      const void *value, uint16_t length);
+void hmi_mirror_invalidate(hmi_controller_t *hmi, int screen_id, int control_id);
+int hmi_mirror_get(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t *value,
+                   uint16_t size, uint16_t *length);
+void hmi_mirror_rx(hmi_controller_t *hmi, const hmi_response_t *frame);
+void hmi_mirror_free(hmi_controller_t *hmi);
+
+// 已發送到串口屏的顏色（hmi->colors_synced 的位），未發送過時不能省略顏色設置
+#define HMI_COLOR_FG    0x01
+#define HMI_COLOR_BG    0x02
+
+// 繪圖錄製（dc_hmi_drawlist.c），hmi->drawlist 不為 NULL 時基本繪圖和清屏以 add 記入列表，
+// 帶上當前的 hmi->fg_color/bg_color；text 只用於 DRAW_OP_TEXT
+enum {
+    DRAW_OP_CLEAN,
+    DRAW_OP_POINT,
+    DRAW_OP_LINE,
+    DRAW_OP_RECT,
+    DRAW_OP_RECT_FILL,
+    DRAW_OP_CIRCLE,
+    DRAW_OP_CIRCLE_FILL,
+    DRAW_OP_TEXT
+};
+int hmi_drawlist_add(hmi_controller_t *hmi, int type, uint16_t a0, uint16_t a1, uint16_t a2, uint16_t a3,
+                     uint8_t background, uint8_t font, const char *text);
+void hmi_drawlist_free(hmi_controller_t *hmi);
+
+#define HMI_STAT_ADD(hmi, field, n) do { \
+        if ((hmi)->stats) __atomic_fetch_add(&(hmi)->stats->field, (n), __ATOMIC_RELAXED); \
+    } while (0)
+
+static inline uint32_t hmi_hist_bucket(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    uint32_t bucket = us ? 64 - __builtin_clzll(us) : 0;
+    return bucket < HMI_HIST_BUCKETS ? bucket : HMI_HIST_BUCKETS - 1;
+}
+
+// 只有一個線程累加的計數器不需要 lock 前綴，其他線程仍可原子讀取
+static inline void hmi_stat_bump(uint64_t *counter, uint64_t n) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+// 寫入串口的線程或持有分發鎖的線程呼叫
+static inline void hmi_stats_time(uint64_t *hist, uint64_t ns) {
+    hmi_stat_bump(&hist[hmi_hist_bucket(ns)], 1);
+}
+
+// 0xB1 組態幀只計入 tx_config，tx[0xB1] 在讀取統計時匯總
+// 同步模式只有一個發送線程；異步模式下多個生產者同時提交，需要原子加法
+static inline void hmi_stats_tx(hmi_controller_t *hmi, const uint8_t *frame, uint16_t length) {
+    hmi_stats_t *st = hmi->stats;
+    if (!st || length < 2) {
+        return;
+    }
+    hmi_cmd_stats_t *c = frame[1] == CMD_CONFIG_BASE && length > 2 ? &st->tx_config[frame[2]] : &st->tx[frame[1]];
+    if (hmi->async) {
+        __atomic_fetch_add(&c->frames, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&c->bytes, length, __ATOMIC_RELAXED);
+    } else {
+        hmi_stat_bump(&c->frames, 1);
+        hmi_stat_bump(&c->bytes, length);
+    }
+}
+
+// 表驅動的幀編碼（dc_hmi_encode.c）
+// 每種幀由描述表給出指令、子指令和字段佈局，字段一律大端序。
+// 可變參數依次對應字段：U8/U16/U32 各一個整數，BYTES 為 (const void *data, unsigned length)
+enum {
+    ENC_END = 0,
+    ENC_U8,
+    ENC_U16,
+    ENC_U32,
+    ENC_BYTES
+};
+
+#define HMI_ENC_FIELDS  8
+
+typedef struct {
+    uint8_t cmd;
+    int16_t sub_cmd;                 // 0xB1 組態幀的子指令，-1 表示沒有
+    uint8_t fields[HMI_ENC_FIELDS];  // 以 ENC_END 結束
+} hmi_frame_desc_t;
+
+typedef enum {
+    HMI_FRAME_SWITCH_SCREEN,
+    HMI_FRAME_ANIM_SWITCH,
+    HMI_FRAME_READ_SCREEN,
+    HMI_FRAME_CONTROL_BYTES,         // 文本等變長數值
+    HMI_FRAME_CONTROL_U8,            // 按鈕狀態
+    HMI_FRAME_CONTROL_U32,           // 進度條、滑動條、儀表
+    HMI_FRAME_READ_CONTROL,
+    HMI_FRAME_SET_BLINK,
+    HMI_FRAME_SET_SCROLL,
+    HMI_FRAME_SET_BK_COLOR,
+    HMI_FRAME_SET_FG_COLOR,
+    HMI_FRAME_FORMAT_TEXT,
+    HMI_FRAME_ANIM_FRAME,            // 圖標、動畫幀
+    HMI_FRAME_ICON_POS,
+    HMI_FRAME_ANIM_START,
+    HMI_FRAME_ANIM_STOP,
+    HMI_FRAME_ANIM_PAUSE,
+    HMI_FRAME_CURVE_ADD_CH,
+    HMI_FRAME_CURVE_DEL_CH,
+    HMI_FRAME_CURVE_DATA,            // 通道之後為點數和數據
+    HMI_FRAME_CURVE_CLEAR_CH,
+    HMI_FRAME_CURVE_SCALE,
+    HMI_FRAME_CURVE_INSERT,
+    HMI_FRAME_RECORD_ADD,
+    HMI_FRAME_RECORD_CLEAR,
+    HMI_FRAME_RECORD_OFFSET,
+    HMI_FRAME_RECORD_COUNT,
+    HMI_FRAME_RECORD_READ,
+    HMI_FRAME_RECORD_MODIFY,         // 索引之後為整行數據
+    HMI_FRAME_RECORD_DELETE,
+    HMI_FRAME_RECORD_INSERT,
+    HMI_FRAME_RECORD_SELECT,
+    HMI_FRAME_RECORD_EXPORT,         // 起始索引和行數
+    HMI_FRAME_TOUCH_CONFIG,
+    HMI_FRAME_TOUCH_CALIBRATE,
+    HMI_FRAME_TOUCH_TEST,
+    HMI_FRAME_DRAW_POINT,
+    HMI_FRAME_DRAW_LINE,
+    HMI_FRAME_DRAW_RECT,
+    HMI_FRAME_DRAW_RECT_FILL,
+    HMI_FRAME_DRAW_CIRCLE,
+    HMI_FRAME_DRAW_CIRCLE_FILL,
+    HMI_FRAME_TEXT_DISPLAY,
+    HMI_FRAME_FULL_IMAGE,
+    HMI_FRAME_CUT_IMAGE,
+    HMI_FRAME_COUNT
+} hmi_frame_id_t;
+
+extern const hmi_frame_desc_t hmi_frame_table[HMI_FRAME_COUNT];
+
+// 編碼到 dst（至少 HMI_FRAME_MAX 字節），返回幀長，超過 HMI_FRAME_MAX 返回 0
+uint16_t hmi_encode_frame(uint8_t *dst, hmi_frame_id_t id, ...);
+// 編碼並發送，批量模式下直接寫入 tx_buf
+int hmi_send_frame(hmi_controller_t *hmi, hmi_frame_id_t id, ...);
+
+// 批量模式下返回 tx_buf 中可直接寫入 length 字節的位置，否則返回 NULL；
+// 寫好後以 hmi_tx_commit 計入緩衝區
+uint8_t *hmi_tx_reserve(hmi_controller_t *hmi, uint16_t length);
+int hmi_tx_commit(hmi_controller_t *hmi, uint16_t length);
+// 批量模式中的控件更新幀（0xB1 0x10），與前一個同畫面的更新合併為 0xB1 0x12
+int hmi_tx_update(hmi_controller_t *hmi, const uint8_t *frame, uint16_t length);
+
+// 以 termios2 設置串口速率（dc_hmi_serial.c）
+int hmi_serial_set_speed(int fd, uint32_t bps);
+
+// 串口寫入（處理非阻塞描述符的部分寫入），返回 write 呼叫次數
+int hmi_write_all(int fd, const uint8_t *data, uint32_t length);
+
+// 送出批量緩衝區中的幀（不結束批量模式）
+int hmi_tx_push(hmi_controller_t *hmi);
+
+// 異步發送
+int hmi_async_submit(hmi_controller_t *hmi, const uint8_t *frame, uint32_t length);
+
+// 由管理器工作線程代替發送線程：生產者通知 wake_fd，工作線程呼叫 service
+// service 返回 0 表示佇列已空，1 表示串口暫時不可寫（需等待 EPOLLOUT），-1 表示出錯
+int hmi_async_attach(hmi_controller_t *hmi, uint32_t queue_size, int wake_fd);
+void hmi_async_detach(hmi_controller_t *hmi);
+int hmi_async_service(hmi_controller_t *hmi);
+// 串口已不可用：之後的提交和 hmi_async_fence 立即返回 -1
+void hmi_async_fail(hmi_controller_t *hmi);
+
+// 幀匹配條件，-1 表示任意值（sub_cmd/screen_id/control_id 對應 data[0]、data[1..2]、data[3..4]）
+typedef struct {
+    int16_t cmd;
+    int16_t sub_cmd;
+    int32_t screen_id;
+    int32_t control_id;
+} hmi_match_t;
+
+// 接收分發
+int hmi_match_frame(const hmi_match_t *match, const hmi_response_t *frame);
+void hmi_dispatch_frame(hmi_controller_t *hmi, const hmi_response_t *frame);
+void hmi_dispatch_free(hmi_controller_t *hmi);
+int hmi_rx_threaded(hmi_controller_t *hmi);
+int hmi_rx_ready(hmi_controller_t *hmi);       // 解析器或串口中有未處理的數據（一次不等待的 poll）
+int hmi_rx_pump(hmi_controller_t *hmi);
+int hmi_rx_on_reader(void);                    // 當前線程正在接收線程或管理器工作線程中分發
+int hmi_rx_attach(hmi_controller_t *hmi);    // 由外部線程呼叫 hmi_rx_pump 接收
+void hmi_rx_detach(hmi_controller_t *hmi);
+
+// 等待回應：先 hmi_expect 登記再發送請求，然後等待或輪詢
+int hmi_expect(hmi_controller_t *hmi, const hmi_match_t *match);
+void hmi_expect_cancel(hmi_controller_t *hmi, int slot);
+uint32_t hmi_expect_generation(hmi_controller_t *hmi);
+int hmi_expect_poll(hmi_controller_t *hmi, int slot, hmi_response_t *response, uint8_t *buffer, uint16_t size);
+int hmi_expect_wait_any(hmi_controller_t *hmi, uint32_t generation, uint64_t deadline_ns);
+int hmi_expect_wait(hmi_controller_t *hmi, int slot, hmi_response_t *response, uint8_t *buffer, uint16_t size,
+                    int timeout_ms);
+int hmi_expect_view(hmi_controller_t *hmi, const hmi_match_t *match, hmi_response_t *response, int timeout_ms);
+
+// 發送請求並等待匹配的回應，數據複製到 buffer
+int hmi_transact(hmi_controller_t *hmi, const uint8_t *frame, uint16_t length, const hmi_match_t *match,
+                 hmi_response_t *response, uint8_t *buffer, uint16_t size, int timeout_ms);
+
+#endif // DC_HMI_INTERNAL_H
@@ -0,0 +1,256 @@
+#include "dc_hmi_internal.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+// ============================================================================
+// 多屏管理器
+// ============================================================================
+//
+// 一個進程驅動多個串口屏時，不再為每個串口屏各開接收和發送線程。
+// 串口屏按編號分配給工作線程（panel % workers），每個工作線程以一個
+// epoll 等待所負責串口的可讀/可寫事件和一個 eventfd：
+//   - 可讀：hmi_rx_pump 讀取並分發事件和回應
+//   - eventfd：有線程提交了新幀（生產者只在工作線程空閒時通知）
+//   - 可寫：之前因輸出緩衝區滿而暫停的串口繼續發送
+// 寫入全部為非阻塞，一個串口的線路速度不會拖慢同線程的其他串口。
+
+typedef struct hmi_worker hmi_worker_t;
+
+typedef struct {
+    hmi_controller_t *hmi;
+    hmi_worker_t *worker;
+    uint32_t events;             // 當前登記的 epoll 事件
+    uint8_t failed;              // 串口出錯後不再處理
+} hmi_panel_t;
+
+struct hmi_worker {
+    pthread_t thread;
+    int epoll_fd;
+    int wake_fd;
+    int running;
+    int count;
+    hmi_panel_t *panels[HMI_MAX_PANELS];
+};
+
+struct hmi_manager {
+    int workers;
+    int count;
+    int started;
+    hmi_worker_t worker[HMI_MAX_WORKERS];
+    hmi_panel_t panel[HMI_MAX_PANELS];
+};
+
+static void panel_set_events(hmi_panel_t *panel, uint32_t events) {
+    if (panel->events == events) {
+        return;
+    }
+    struct epoll_event ev = { .events = events, .data.ptr = panel };
+    epoll_ctl(panel->worker->epoll_fd, EPOLL_CTL_MOD, panel->hmi->fd, &ev);
+    panel->events = events;
+}
+
+static void panel_fail(hmi_panel_t *panel, const char *reason) {
+    epoll_ctl(panel->worker->epoll_fd, EPOLL_CTL_DEL, panel->hmi->fd, NULL);
+    panel->failed = 1;
+    hmi_async_fail(panel->hmi);
+    printf("串口屏 %s: %s，停止處理\n", panel->hmi->device, reason);
+}
+
+// 送出佇列中的數據，串口不可寫時改為等待 EPOLLOUT
+static void panel_service(hmi_panel_t *panel) {
+    int ret = hmi_async_service(panel->hmi);
+    if (ret < 0) {
+        panel_fail(panel, "發送失敗");
+        return;
+    }
+    panel_set_events(panel, ret > 0 ? EPOLLIN | EPOLLOUT : EPOLLIN);
+}
+
+static void *worker_thread(void *arg) {
+    hmi_worker_t *w = (hmi_worker_t*)arg;
+    struct epoll_event events[HMI_MAX_PANELS + 1];
+
+    // 啟動前提交的幀
+    for (int i = 0; i < w->count; i++) {
+        panel_service(w->panels[i]);
+    }
+
+    while (__atomic_load_n(&w->running, __ATOMIC_ACQUIRE)) {
+        int n = epoll_wait(w->epoll_fd, events, HMI_MAX_PANELS + 1, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            printf("工作線程: epoll 失敗: %s\n", strerror(errno));
+            break;
+        }
+
+        int woken = 0;
+        for (int i = 0; i < n; i++) {
+            hmi_panel_t *panel = events[i].data.ptr;
+            if (!panel) {
+                uint64_t value;
+                if (read(w->wake_fd, &value, sizeof(value)) < 0) {
+                    // 計數已被讀走
+                }
+                woken = 1;
+                continue;
+            }
+            if (panel->failed) {
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                if (hmi_rx_pump(panel->hmi) < 0) {
+                    panel_fail(panel, "接收失敗");
+                    continue;
+                }
+            } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                panel_fail(panel, "串口錯誤");
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                panel_service(panel);
+            }
+        }
+
+        // 不知道是哪個串口屏有新幀，逐個檢查（只是讀取各佇列的首單元）
+        if (woken) {
+            for (int i = 0; i < w->count; i++) {
+                hmi_panel_t *panel = w->panels[i];
+                if (!panel->failed && !(panel->events & EPOLLOUT)) {
+                    panel_service(panel);
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+hmi_manager_t *hmi_manager_create(int workers) {
+    if (workers < 1) {
+        workers = 1;
+    }
+    if (workers > HMI_MAX_WORKERS) {
+        workers = HMI_MAX_WORKERS;
+    }
+
+    hmi_manager_t *mgr = calloc(1, sizeof(hmi_manager_t));
+    if (!mgr) {
+        return NULL;
+    }
+    for (int i = 0; i < workers; i++) {
+        hmi_worker_t *w = &mgr->worker[i];
+        w->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        w->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+        if (w->epoll_fd < 0 || w->wake_fd < 0 || epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->wake_fd, &ev) < 0) {
+            mgr->workers = i + 1;
+            hmi_manager_destroy(mgr);
+            return NULL;
+        }
+    }
+    mgr->workers = workers;
+    return mgr;
+}
+
+int hmi_manager_add(hmi_manager_t *mgr, hmi_controller_t *hmi) {
+    if (!mgr || !hmi || !hmi->is_connected || mgr->started || mgr->count >= HMI_MAX_PANELS) {
+        return -1;
+    }
+    if (hmi->async || hmi_rx_threaded(hmi)) {
+        return -1; // 先停止該串口屏自己的發送/接收線程
+    }
+
+    int index = mgr->count;
+    hmi_panel_t *panel = &mgr->panel[index];
+    hmi_worker_t *w = &mgr->worker[index % mgr->workers];
+
+    hmi_flush(hmi);
+    if (hmi_async_attach(hmi, 0, w->wake_fd) < 0) {
+        return -1;
+    }
+    if (hmi_rx_attach(hmi) < 0) {
+        hmi_async_detach(hmi);
+        return -1;
+    }
+
+    panel->hmi = hmi;
+    panel->worker = w;
+    panel->events = EPOLLIN;
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = panel };
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, hmi->fd, &ev) < 0) {
+        hmi_rx_detach(hmi);
+        hmi_async_detach(hmi);
+        return -1;
+    }
+
+    w->panels[w->count++] = panel;
+    mgr->count++;
+    return index;
+}
+
+int hmi_manager_start(hmi_manager_t *mgr) {
+    if (!mgr || mgr->started) {
+        return -1;
+    }
+    for (int i = 0; i < mgr->workers; i++) {
+        hmi_worker_t *w = &mgr->worker[i];
+        if (w->count == 0) {
+            continue;
+        }
+        w->running = 1;
+        if (pthread_create(&w->thread, NULL, worker_thread, w) != 0) {
+            w->running = 0;
+            return -1;
+        }
+    }
+    mgr->started = 1;
+    return 0;
+}
+
+void hmi_manager_destroy(hmi_manager_t *mgr) {
+    if (!mgr) {
+        return;
+    }
+
+    // 停止工作線程
+    for (int i = 0; i < mgr->workers; i++) {
+        hmi_worker_t *w = &mgr->worker[i];
+        if (w->running) {
+            uint64_t one = 1;
+            __atomic_store_n(&w->running, 0, __ATOMIC_RELEASE);
+            if (write(w->wake_fd, &one, sizeof(one)) == sizeof(one)) {
+                pthread_join(w->thread, NULL);
+            }
+        }
+    }
+
+    // 送完剩餘數據，串口屏回到獨立使用的同步模式
+    for (int i = 0; i < mgr->count; i++) {
+        hmi_controller_t *hmi = mgr->panel[i].hmi;
+        hmi_rx_detach(hmi);
+        hmi_async_detach(hmi);
+    }
+
+    for (int i = 0; i < mgr->workers; i++) {
+        hmi_worker_t *w = &mgr->worker[i];
+        if (w->epoll_fd >= 0) {
+            close(w->epoll_fd);
+        }
+        if (w->wake_fd >= 0) {
+            close(w->wake_fd);
+        }
+    }
+    free(mgr);
+}
+
+int hmi_manager_count(hmi_manager_t *mgr) {
+    return mgr ? mgr->count : 0;
+}
+
+uint32_t hmi_manager_queue_depth(hmi_manager_t *mgr, int panel) {
+    if (!mgr || panel < 0 || panel >= mgr->count) {
+        return 0;
+    }
+    return hmi_async_pending(mgr->panel[panel].hmi);
+}
@@ -0,0 +1,159 @@
+#include "dc_hmi_internal.h"
+
+// ============================================================================
+// 控件狀態鏡像
+// ============================================================================
+//
+// 以 (screen_id, control_id) 為鍵保存每個控件的當前數值：本機寫入時記下寫入的數據，
+// 串口屏上報控件變化或回應讀取（0xB1 0x11）時以上報的數據覆蓋。
+// HMI_READ_MIRROR 模式下 hmi_read_* 查表即返回，不再等待一次串口往返。
+// 與影子緩存不同，這裡保存完整的數值而不是哈希，表同樣由一把互斥鎖保護。
+
+#define MIRROR_DEFAULT_ENTRIES 1024
+#define MIRROR_PROBE           8
+
+typedef struct {
+    hmi_slot_t slot;             // 鍵為 screen_id << 16 | control_id
+    uint8_t valid;               // 0 表示數值未知，讀取時需詢問串口屏
+    uint8_t type;                // 串口屏上報的控件類型，本機寫入時沿用
+    uint16_t length;
+    uint16_t capacity;
+    uint8_t *value;
+} mirror_entry_t;
+
+struct hmi_mirror {
+    pthread_mutex_t lock;
+    hmi_table_t table;
+};
+
+// 查找或創建控件的記錄，持鎖呼叫；附近的槽已滿時覆蓋首選槽，被覆蓋的控件下次讀取時詢問串口屏
+static mirror_entry_t *mirror_find(hmi_mirror_t *mr, uint32_t key, int create) {
+    int created;
+    mirror_entry_t *e = hmi_table_find(&mr->table, key, 0, create ? HMI_TABLE_REPLACE : HMI_TABLE_LOOKUP, &created);
+    if (created) {
+        e->valid = 0;
+        e->type = 0;
+    }
+    return e;
+}
+
+static int mirror_create(hmi_controller_t *hmi, uint32_t entries) {
+    hmi_mirror_t *mr = calloc(1, sizeof(hmi_mirror_t));
+    if (!mr) {
+        return -1;
+    }
+    if (hmi_table_init(&mr->table, entries, sizeof(mirror_entry_t), MIRROR_PROBE) < 0) {
+        free(mr);
+        return -1;
+    }
+    pthread_mutex_init(&mr->lock, NULL);
+    hmi->mirror = mr;
+    return 0;
+}
+
+int hmi_set_read_mode(hmi_controller_t *hmi, int mode) {
+    if (!hmi || (mode != HMI_READ_DEVICE && mode != HMI_READ_MIRROR)) {
+        return -1;
+    }
+    if (mode == HMI_READ_MIRROR && !hmi->mirror && mirror_create(hmi, MIRROR_DEFAULT_ENTRIES) < 0) {
+        return -1;
+    }
+    hmi->read_mode = (uint8_t)mode;
+    return 0;
+}
+
+void hmi_mirror_free(hmi_controller_t *hmi) {
+    hmi_mirror_t *mr = hmi->mirror;
+    if (!mr) {
+        return;
+    }
+    hmi->mirror = NULL;
+    hmi->read_mode = HMI_READ_DEVICE;
+    for (uint32_t i = 0; i <= mr->table.mask; i++) {
+        free(((mirror_entry_t*)hmi_table_at(&mr->table, i))->value);
+    }
+    pthread_mutex_destroy(&mr->lock);
+    hmi_table_free(&mr->table);
+    free(mr);
+}
+
+void hmi_mirror_store(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, int type,
+                      const void *value, uint16_t length) {
+    hmi_mirror_t *mr = hmi->mirror;
+    if (!mr) {
+        return;
+    }
+
+    pthread_mutex_lock(&mr->lock);
+    mirror_entry_t *e = mirror_find(mr, ((uint32_t)screen_id << 16) | control_id, 1);
+    if (length > e->capacity) {
+        uint8_t *grown = realloc(e->value, length);
+        if (!grown) {
+            e->valid = 0;
+            pthread_mutex_unlock(&mr->lock);
+            return;
+        }
+        e->value = grown;
+        e->capacity = length;
+    }
+    if (length > 0) {
+        memcpy(e->value, value, length);
+    }
+    e->length = length;
+    if (type >= 0) {
+        e->type = (uint8_t)type;
+    }
+    e->valid = 1;
+    pthread_mutex_unlock(&mr->lock);
+}
+
+void hmi_mirror_invalidate(hmi_controller_t *hmi, int screen_id, int control_id) {
+    hmi_mirror_t *mr = hmi ? hmi->mirror : NULL;
+    if (!mr) {
+        return;
+    }
+
+    pthread_mutex_lock(&mr->lock);
+    if (screen_id >= 0 && control_id >= 0) {
+        mirror_entry_t *e = mirror_find(mr, ((uint32_t)screen_id << 16) | (uint16_t)control_id, 0);
+        if (e) {
+            e->valid = 0;
+        }
+    } else {
+        for (uint32_t i = 0; i <= mr->table.mask; i++) {
+            mirror_entry_t *e = hmi_table_at(&mr->table, i);
+            if (e->slot.state == HMI_SLOT_USED && (screen_id < 0 || (e->slot.key >> 16) == (uint32_t)screen_id) &&
+                (control_id < 0 || (e->slot.key & 0xFFFF) == (uint32_t)control_id)) {
+                e->valid = 0;
+            }
+        }
+    }
+    pthread_mutex_unlock(&mr->lock);
+}
+
+int hmi_mirror_get(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t *value,
+                   uint16_t size, uint16_t *length) {
+    hmi_mirror_t *mr = hmi->mirror;
+    if (!mr) {
+        return -1;
+    }
+
+    int ret = -1;
+    pthread_mutex_lock(&mr->lock);
+    mirror_entry_t *e = mirror_find(mr, ((uint32_t)screen_id << 16) | control_id, 0);
+    if (e && e->valid && e->length <= size) {
+        memcpy(value, e->value, e->length);
+        *length = e->length;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&mr->lock);
+    return ret;
+}
+
+// 上報格式: 11 screen_id(2) control_id(2) control_type(1) 數據...
+void hmi_mirror_rx(hmi_controller_t *hmi, const hmi_response_t *frame) {
+    if (frame->cmd == CMD_CONFIG_BASE && frame->length >= 6 && frame->data[0] == CMD_READ_CONTROL) {
+        hmi_mirror_store(hmi, (frame->data[1] << 8) | frame->data[2], (frame->data[3] << 8) | frame->data[4],
+                         frame->data[5], frame->data + 6, frame->length - 6);
+    }
+}
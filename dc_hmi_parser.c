@@ -0,0 +1,106 @@
+#include "dc_hmi_controller.h"
+
+// ============================================================================
+// 流式幀解析
+// ============================================================================
+//
+// 緩衝區中 [head, tail) 為尚未解析的數據。每次讀取後可連續取出多個完整幀，
+// 不完整的幀留在緩衝區內，等待下一次讀取補齊。
+// 幀頭之前的雜散字節會被跳過（重新同步）。
+
+#define FRAME_MIN_SIZE  6   // EE cmd FF FC FF FF
+
+void hmi_parser_reset(hmi_parser_t *parser) {
+    parser->head = 0;
+    parser->tail = 0;
+    parser->scan = 0;
+}
+
+uint8_t *hmi_parser_space(hmi_parser_t *parser, uint16_t *space) {
+    if (parser->head == parser->tail) {
+        hmi_parser_reset(parser);
+    } else if (parser->tail == HMI_RX_RING_SIZE) {
+        if (parser->head == 0) {
+            // 緩衝區已滿仍無完整幀，全部丟棄
+            parser->dropped += parser->tail;
+            parser->resyncs++;
+            hmi_parser_reset(parser);
+        } else {
+            // 把未處理數據移到緩衝區開頭
+            uint16_t pending = parser->tail - parser->head;
+            memmove(parser->buf, parser->buf + parser->head, pending);
+            parser->scan -= parser->head;
+            parser->head = 0;
+            parser->tail = pending;
+        }
+    }
+
+    *space = HMI_RX_RING_SIZE - parser->tail;
+    return parser->buf + parser->tail;
+}
+
+void hmi_parser_commit(hmi_parser_t *parser, uint16_t length) {
+    parser->tail += length;
+}
+
+uint16_t hmi_parser_feed(hmi_parser_t *parser, const uint8_t *data, uint16_t length) {
+    uint16_t space;
+    uint8_t *dst = hmi_parser_space(parser, &space);
+    uint16_t n = length < space ? length : space;
+
+    memcpy(dst, data, n);
+    hmi_parser_commit(parser, n);
+    return n;
+}
+
+int hmi_parser_next(hmi_parser_t *parser, hmi_response_t *frame) {
+    uint8_t *buf = parser->buf;
+
+    while (parser->head < parser->tail) {
+        // 定位幀頭
+        if (buf[parser->head] != FRAME_HEADER) {
+            uint8_t *p = memchr(buf + parser->head, FRAME_HEADER, parser->tail - parser->head);
+            uint16_t next = p ? (uint16_t)(p - buf) : parser->tail;
+            parser->dropped += next - parser->head;
+            parser->resyncs++;
+            parser->head = next;
+            parser->scan = next;
+            continue;
+        }
+
+        // 搜索幀尾 FF FC FF FF，從上次停下的位置繼續
+        uint16_t from = parser->scan > parser->head + 3 ? parser->scan : parser->head + 3;
+        while (from + 2 < parser->tail) {
+            uint8_t *p = memchr(buf + from, 0xFC, parser->tail - 2 - from);
+            if (!p) {
+                break;
+            }
+            uint16_t i = p - buf;
+            if (buf[i - 1] == 0xFF && buf[i + 1] == 0xFF && buf[i + 2] == 0xFF) {
+                frame->cmd = buf[parser->head + 1];
+                frame->data = buf + parser->head + 2;
+                frame->length = (i - 1) - (parser->head + 2);
+                if (frame->length == 0) {
+                    frame->data = NULL;
+                }
+                parser->head = i + 3;
+                parser->scan = parser->head;
+                return 0;
+            }
+            from = i + 1;
+        }
+        parser->scan = parser->tail - parser->head > 2 ? parser->tail - 2 : parser->head;
+
+        // 超過最大幀長仍無幀尾，視為雜散的幀頭字節
+        if (parser->tail - parser->head > HMI_FRAME_MAX) {
+            parser->dropped++;
+            parser->resyncs++;
+            parser->head++;
+            parser->scan = parser->head;
+            continue;
+        }
+        break;
+    }
+
+    return -1;
+}
@@ -0,0 +1,266 @@
+#include "dc_hmi_internal.h"
+
+// ============================================================================
+// 記錄控件
+// ============================================================================
+//
+// 批量追加: EE B1 5B screen_id(2) control_id(2) 行數(2) 行 00 行 00 ... FF FC FF FF
+// 導出請求: EE B1 5C screen_id(2) control_id(2) start(2) count(2) FF FC FF FF
+// 導出回覆: 每行一幀 B1 5C screen_id(2) control_id(2) index(2) 數據，
+//           最後一幀 index 為 HMI_RECORD_END、沒有數據
+// 其他指令每幀一行，串口屏不回覆；行數和讀取一行為請求/回應。
+
+// 批量幀在行數據之前的長度: EE B1 5B screen(2) control(2) 行數(2)
+#define RECORD_BATCH_HEAD      9
+
+static uint16_t row_length(const char *row) {
+    size_t length = strlen(row);
+    return length < HMI_FRAME_MAX ? (uint16_t)length : HMI_FRAME_MAX;
+}
+
+int hmi_record_add(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, const char *row) {
+    if (!row) {
+        return -1;
+    }
+    return hmi_send_frame(hmi, HMI_FRAME_RECORD_ADD, screen_id, control_id, row, (unsigned)row_length(row));
+}
+
+// 送出一個批量幀，frame 中已寫好幀頭之後的行數據
+static int record_batch_send(hmi_controller_t *hmi, uint8_t *frame, uint16_t length, uint16_t rows) {
+    static const uint8_t tail[] = FRAME_TAIL;
+    frame[7] = rows >> 8;
+    frame[8] = rows & 0xFF;
+    memcpy(frame + length, tail, FRAME_TAIL_SIZE);
+    return hmi_send_command(hmi, frame, length + FRAME_TAIL_SIZE);
+}
+
+int hmi_record_add_rows(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, const char *const *rows,
+                        uint32_t count) {
+    if (!hmi || !hmi->is_connected || (!rows && count > 0)) {
+        return -1;
+    }
+    uint8_t frame[HMI_FRAME_MAX];
+    frame[0] = FRAME_HEADER;
+    frame[1] = CMD_CONFIG_BASE;
+    frame[2] = CMD_RECORD_BATCH;
+    frame[3] = screen_id >> 8;
+    frame[4] = screen_id & 0xFF;
+    frame[5] = control_id >> 8;
+    frame[6] = control_id & 0xFF;
+
+    // 多幀時在同步模式下合併為一次寫入
+    int cork = !hmi->tx_corked && !hmi->async;
+    if (cork) {
+        hmi_begin_batch(hmi);
+    }
+
+    int ret = 0;
+    uint16_t length = RECORD_BATCH_HEAD;
+    uint16_t batched = 0;
+    for (uint32_t i = 0; i < count && ret == 0; i++) {
+        size_t row_len = strlen(rows[i]);
+        if (RECORD_BATCH_HEAD + row_len + 1 + FRAME_TAIL_SIZE > HMI_FRAME_MAX) {
+            ret = -1;   // 一行超過單幀上限
+            break;
+        }
+        if (length + row_len + 1 + FRAME_TAIL_SIZE > HMI_FRAME_MAX) {
+            ret = record_batch_send(hmi, frame, length, batched);
+            length = RECORD_BATCH_HEAD;
+            batched = 0;
+        }
+        memcpy(frame + length, rows[i], row_len);
+        length += row_len;
+        frame[length++] = 0;
+        batched++;
+    }
+    if (ret == 0 && batched > 0) {
+        ret = record_batch_send(hmi, frame, length, batched);
+    }
+
+    if (cork && hmi_flush(hmi) < 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+int hmi_record_insert(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t index,
+                      const char *row) {
+    if (!row) {
+        return -1;
+    }
+    return hmi_send_frame(hmi, HMI_FRAME_RECORD_INSERT, screen_id, control_id, index, row,
+                          (unsigned)row_length(row));
+}
+
+int hmi_record_modify(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t index,
+                      const char *row) {
+    if (!row) {
+        return -1;
+    }
+    return hmi_send_frame(hmi, HMI_FRAME_RECORD_MODIFY, screen_id, control_id, index, row,
+                          (unsigned)row_length(row));
+}
+
+int hmi_record_delete(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t index) {
+    return hmi_send_frame(hmi, HMI_FRAME_RECORD_DELETE, screen_id, control_id, index);
+}
+
+int hmi_record_clear(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id) {
+    return hmi_send_frame(hmi, HMI_FRAME_RECORD_CLEAR, screen_id, control_id);
+}
+
+int hmi_record_select(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t index) {
+    return hmi_send_frame(hmi, HMI_FRAME_RECORD_SELECT, screen_id, control_id, index);
+}
+
+int hmi_record_set_offset(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t offset) {
+    return hmi_send_frame(hmi, HMI_FRAME_RECORD_OFFSET, screen_id, control_id, offset);
+}
+
+// ============================================================================
+// 讀取
+// ============================================================================
+
+int hmi_record_count(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t *count) {
+    uint8_t frame[16];
+    uint16_t frame_len = hmi_encode_frame(frame, HMI_FRAME_RECORD_COUNT, screen_id, control_id);
+
+    // 回應: B1 55 screen_id(2) control_id(2) 行數(2)
+    hmi_match_t match = { CMD_CONFIG_BASE, CMD_RECORD_COUNT, screen_id, control_id };
+    hmi_response_t response;
+    uint8_t buffer[HMI_FRAME_MAX];
+    if (!count || hmi_transact(hmi, frame, frame_len, &match, &response, buffer, sizeof(buffer), 1000) < 0 ||
+        response.length < 7) {
+        return -1;
+    }
+    *count = (response.data[5] << 8) | response.data[6];
+    return 0;
+}
+
+int hmi_record_read(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t index, char *row,
+                    uint16_t size) {
+    uint8_t frame[16];
+    uint16_t frame_len = hmi_encode_frame(frame, HMI_FRAME_RECORD_READ, screen_id, control_id, index);
+
+    // 回應: B1 56 screen_id(2) control_id(2) index(2) 數據，索引超出範圍時沒有數據
+    hmi_match_t match = { CMD_CONFIG_BASE, CMD_RECORD_READ, screen_id, control_id };
+    hmi_response_t response;
+    uint8_t buffer[HMI_FRAME_MAX];
+    if (!row || size == 0 ||
+        hmi_transact(hmi, frame, frame_len, &match, &response, buffer, sizeof(buffer), 1000) < 0 ||
+        response.length < 7) {
+        return -1;
+    }
+
+    uint16_t length = response.length - 7;
+    uint16_t copy_len = length < size - 1 ? length : size - 1;
+    memcpy(row, response.data + 7, copy_len);
+    row[copy_len] = '\0';
+    return 0;
+}
+
+// ============================================================================
+// 流式導出
+// ============================================================================
+//
+// 導出的行以事件訂閱接收：每收到一行就交給呼叫者的回呼，解析器緩衝區中的數據
+// 不另外複製。沒有接收線程時由呼叫者自己讀取並分發，否則等待接收線程通知。
+
+typedef struct {
+    hmi_record_cb_t callback;
+    void *user;
+    uint32_t rows;
+    int done;
+    uint64_t last_ns;            // 最後收到一行的時間，超時從這裡算起
+    pthread_mutex_t lock;
+    pthread_cond_t progress;
+} record_export_t;
+
+static void export_row(hmi_controller_t *hmi, const hmi_response_t *frame, void *user) {
+    record_export_t *ex = (record_export_t*)user;
+    (void)hmi;
+    if (frame->length < 7 || ex->done) {
+        return;
+    }
+
+    uint16_t index = (frame->data[5] << 8) | frame->data[6];
+    if (index != HMI_RECORD_END) {
+        ex->callback(index, (const char*)frame->data + 7, frame->length - 7, ex->user);
+    }
+
+    pthread_mutex_lock(&ex->lock);
+    if (index == HMI_RECORD_END) {
+        ex->done = 1;
+    } else {
+        ex->rows++;
+    }
+    ex->last_ns = hmi_time_ns();
+    pthread_cond_broadcast(&ex->progress);
+    pthread_mutex_unlock(&ex->lock);
+}
+
+int hmi_record_export(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint16_t start,
+                      uint16_t count, hmi_record_cb_t callback, void *user, int timeout_ms) {
+    if (!hmi || !hmi->is_connected || !callback) {
+        return -1;
+    }
+    // 在接收線程的回呼中導出：導出的行要由這個線程自己接收，只能等到超時
+    if (hmi_rx_threaded(hmi) && hmi_rx_on_reader()) {
+        return -1;
+    }
+
+    record_export_t ex = { .callback = callback, .user = user, .last_ns = hmi_time_ns() };
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&ex.progress, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&ex.lock, NULL);
+
+    // 先訂閱再發送請求，第一行不會在訂閱之前到達
+    int handle = hmi_subscribe(hmi, CMD_CONFIG_BASE, CMD_RECORD_EXPORT, screen_id, control_id, export_row, &ex);
+    int ret = handle < 0 ? -1 : hmi_send_frame(hmi, HMI_FRAME_RECORD_EXPORT, screen_id, control_id, start, count);
+    if (ret == 0 && hmi->tx_len > 0) {
+        ret = hmi_tx_push(hmi);
+    }
+
+    uint64_t idle_ns = (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000000ULL;
+    while (ret == 0) {
+        pthread_mutex_lock(&ex.lock);
+        int done = ex.done;
+        uint64_t deadline = ex.last_ns + idle_ns;
+        pthread_mutex_unlock(&ex.lock);
+
+        uint64_t now = hmi_time_ns();
+        if (done) {
+            break;
+        }
+        if (now >= deadline) {
+            HMI_STAT_ADD(hmi, timeouts, 1);
+            ret = -1;
+            break;
+        }
+
+        if (hmi_rx_threaded(hmi)) {
+            struct timespec ts = {
+                .tv_sec = deadline / 1000000000ULL,
+                .tv_nsec = deadline % 1000000000ULL
+            };
+            pthread_mutex_lock(&ex.lock);
+            if (!ex.done && ex.last_ns + idle_ns == deadline) {
+                pthread_cond_timedwait(&ex.progress, &ex.lock, &ts);
+            }
+            pthread_mutex_unlock(&ex.lock);
+        } else if (hmi_poll_events(hmi, (int)((deadline - now + 999999ULL) / 1000000ULL)) < 0) {
+            ret = -1;
+        }
+    }
+
+    // 退訂會等待接收線程中正在執行的 export_row 結束，之後才能銷毀 ex
+    if (handle >= 0) {
+        hmi_unsubscribe(hmi, handle);
+    }
+    pthread_mutex_destroy(&ex.lock);
+    pthread_cond_destroy(&ex.progress);
+    return ret < 0 ? -1 : (int)ex.rows;
+}
@@ -0,0 +1,33 @@
+// 串口速率設置（Linux termios2）
+//
+// struct termios2 與 <termios.h> 的定義衝突，所以本文件不包含
+// dc_hmi_controller.h，只提供一個以 bps 為參數的函數。
+// 使用 BOTHER 直接指定速率，1M/2M 以及非標準速率都可以設置。
+
+#include <asm/termbits.h>
+#include <asm/ioctls.h>
+#include <sys/ioctl.h>
+#include <stdint.h>
+
+int hmi_serial_set_speed(int fd, uint32_t bps) {
+    struct termios2 tio;
+
+    if (bps == 0 || ioctl(fd, TCGETS2, &tio) < 0) {
+        return -1;
+    }
+
+    tio.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+    tio.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    tio.c_ispeed = bps;
+    tio.c_ospeed = bps;
+    if (ioctl(fd, TCSETS2, &tio) < 0) {
+        return -1;
+    }
+
+    // 驅動可能取最接近的速率，相差超過 3% 視為不支持
+    if (ioctl(fd, TCGETS2, &tio) < 0) {
+        return -1;
+    }
+    uint32_t diff = tio.c_ospeed > bps ? tio.c_ospeed - bps : bps - tio.c_ospeed;
+    return diff * 100 > bps * 3 ? -1 : 0;
+}
@@ -0,0 +1,163 @@
+#include "dc_hmi_internal.h"
+
+// ============================================================================
+// 控件影子緩存
+// ============================================================================
+//
+// 以 (screen_id, control_id) 為鍵的開放定址哈希表，記錄每個控件最後寫入的內容。
+// 控制迴圈每個週期重複寫入相同數值時，在編碼之前丟棄，不佔用串口。
+// 異步模式下多個線程可同時更新控件，表由一把互斥鎖保護（查表遠快於編碼和寫入）。
+
+#define SHADOW_DEFAULT_ENTRIES 1024
+#define SHADOW_PROBE           8         // 最多探測的槽數，找不到空槽時覆蓋首選槽
+
+#define SHADOW_HAS_VALUE       0x01
+#define SHADOW_HAS_FG          0x02
+#define SHADOW_HAS_BG          0x04
+
+typedef struct {
+    hmi_slot_t slot;             // 鍵為 screen_id << 16 | control_id
+    uint8_t flags;               // SHADOW_HAS_*
+    uint8_t kind;                // value 的含義，SHADOW_TEXT / SHADOW_NUMBER / SHADOW_FORMAT
+    uint16_t color[2];           // SHADOW_FG / SHADOW_BG
+    uint64_t value;
+} shadow_entry_t;
+
+struct hmi_shadow {
+    pthread_mutex_t lock;
+    hmi_table_t table;
+};
+
+// 查找或創建控件的記錄，持鎖呼叫；附近的槽已滿時覆蓋首選槽，被覆蓋的控件下次寫入時照常發送
+static shadow_entry_t *shadow_find(hmi_shadow_t *sh, uint32_t key, int create) {
+    int created;
+    shadow_entry_t *e = hmi_table_find(&sh->table, key, 0, create ? HMI_TABLE_REPLACE : HMI_TABLE_LOOKUP, &created);
+    if (created) {
+        e->flags = 0;
+    }
+    return e;
+}
+
+int hmi_shadow_enable(hmi_controller_t *hmi, uint32_t entries) {
+    if (!hmi || hmi->shadow) {
+        return -1;
+    }
+    if (entries == 0) {
+        entries = SHADOW_DEFAULT_ENTRIES;
+    }
+
+
+    hmi_shadow_t *sh = calloc(1, sizeof(hmi_shadow_t));
+    if (!sh) {
+        return -1;
+    }
+    if (hmi_table_init(&sh->table, entries, sizeof(shadow_entry_t), SHADOW_PROBE) < 0) {
+        free(sh);
+        return -1;
+    }
+    pthread_mutex_init(&sh->lock, NULL);
+    hmi->shadow = sh;
+    return 0;
+}
+
+void hmi_shadow_free(hmi_controller_t *hmi) {
+    hmi_shadow_t *sh = hmi->shadow;
+    if (!sh) {
+        return;
+    }
+    hmi->shadow = NULL;
+    pthread_mutex_destroy(&sh->lock);
+    hmi_table_free(&sh->table);
+    free(sh);
+}
+
+void hmi_shadow_invalidate(hmi_controller_t *hmi, int screen_id, int control_id) {
+    hmi_shadow_t *sh = hmi ? hmi->shadow : NULL;
+    if (!sh) {
+        return;
+    }
+
+    pthread_mutex_lock(&sh->lock);
+    if (screen_id >= 0 && control_id >= 0) {
+        shadow_entry_t *e = shadow_find(sh, ((uint32_t)screen_id << 16) | (uint16_t)control_id, 0);
+        if (e) {
+            e->flags = 0;
+        }
+    } else {
+        // 保留鍵只清除內容，探測鏈不會斷開
+        for (uint32_t i = 0; i <= sh->table.mask; i++) {
+            shadow_entry_t *e = hmi_table_at(&sh->table, i);
+            if (e->slot.state == HMI_SLOT_USED && (screen_id < 0 || (e->slot.key >> 16) == (uint32_t)screen_id) &&
+                (control_id < 0 || (e->slot.key & 0xFFFF) == (uint32_t)control_id)) {
+                e->flags = 0;
+            }
+        }
+    }
+    pthread_mutex_unlock(&sh->lock);
+}
+
+int hmi_shadow_check(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, uint8_t kind, uint64_t value) {
+    hmi_shadow_t *sh = hmi->shadow;
+    if (!sh) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&sh->lock);
+    shadow_entry_t *e = shadow_find(sh, ((uint32_t)screen_id << 16) | control_id, 1);
+    int same = (e->flags & SHADOW_HAS_VALUE) && e->kind == kind && e->value == value;
+    if (!same) {
+        e->flags |= SHADOW_HAS_VALUE;
+        e->kind = kind;
+        e->value = value;
+    }
+    pthread_mutex_unlock(&sh->lock);
+
+    if (same) {
+        HMI_STAT_ADD(hmi, shadow_suppressed, 1);
+    } else {
+        HMI_STAT_ADD(hmi, shadow_sent, 1);
+    }
+    return same;
+}
+
+int hmi_shadow_check_color(hmi_controller_t *hmi, uint16_t screen_id, uint16_t control_id, int which, uint16_t color) {
+    hmi_shadow_t *sh = hmi->shadow;
+    if (!sh) {
+        return 0;
+    }
+    uint8_t flag = which == SHADOW_FG ? SHADOW_HAS_FG : SHADOW_HAS_BG;
+
+    pthread_mutex_lock(&sh->lock);
+    shadow_entry_t *e = shadow_find(sh, ((uint32_t)screen_id << 16) | control_id, 1);
+    int same = (e->flags & flag) && e->color[which] == color;
+    if (!same) {
+        e->flags |= flag;
+        e->color[which] = color;
+    }
+    pthread_mutex_unlock(&sh->lock);
+
+    if (same) {
+        HMI_STAT_ADD(hmi, shadow_suppressed, 1);
+    } else {
+        HMI_STAT_ADD(hmi, shadow_sent, 1);
+    }
+    return same;
+}
+
+// FNV-1a，64 位使誤判為相同文本的機率可以忽略
+uint64_t hmi_shadow_hash(const void *data, uint32_t length) {
+    const uint8_t *p = (const uint8_t*)data;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint32_t i = 0; i < length; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash ^ length;
+}
+
+// 串口屏上報的控件變化（觸摸輸入等）使緩存過期；讀控件的回應格式相同，一併清除
+void hmi_shadow_rx(hmi_controller_t *hmi, const hmi_response_t *frame) {
+    if (frame->cmd == CMD_CONFIG_BASE && frame->length >= 5 && frame->data[0] == CMD_READ_CONTROL) {
+        hmi_shadow_invalidate(hmi, (frame->data[1] << 8) | frame->data[2], (frame->data[3] << 8) | frame->data[4]);
+    }
+}
@@ -0,0 +1,155 @@
+#include "dc_hmi_internal.h"
+#include <stddef.h>
+#include <sys/mman.h>
+
+// ============================================================================
+// 運行統計
+// ============================================================================
+//
+// 發送、接收和分發路徑上以 relaxed 原子操作累加計數器，不加鎖；只有一個線程
+// 寫入的計數器（接收、寫入耗時、同步模式的發送）不使用帶 lock 前綴的加法。
+// 讀取時逐個計數器原子讀取，不同計數器之間不保證是同一時刻的值。
+// 導出到共享內存後，外部程式（hmi_stat）可以只讀映射，不需要停止本進程。
+
+// tx 之後全部是 uint64_t 計數器
+#define STATS_COUNTERS ((sizeof(hmi_stats_t) - offsetof(hmi_stats_t, tx)) / sizeof(uint64_t))
+
+int hmi_stats_init(hmi_controller_t *hmi) {
+    hmi_stats_t *st = calloc(1, sizeof(hmi_stats_t));
+    if (!st) {
+        return -1;
+    }
+    st->magic = HMI_STATS_MAGIC;
+    st->version = HMI_STATS_VERSION;
+    st->start_ns = hmi_time_ns();
+    hmi->stats = st;
+    return 0;
+}
+
+void hmi_stats_free(hmi_controller_t *hmi) {
+    hmi_stats_t *st = hmi->stats;
+    if (!st) {
+        return;
+    }
+    hmi->stats = NULL;
+
+    if (st->name[0]) {
+        shm_unlink(st->name);
+        munmap(st, sizeof(hmi_stats_t));
+    } else {
+        free(st);
+    }
+}
+
+void hmi_stats_rx(hmi_controller_t *hmi, const hmi_response_t *frame) {
+    hmi_stats_t *st = hmi->stats;
+    if (!st) {
+        return;
+    }
+    // 同一時刻只有一個線程讀取串口
+    hmi_stat_bump(&st->rx[frame->cmd].frames, 1);
+    hmi_stat_bump(&st->rx[frame->cmd].bytes, frame->length + 6);
+
+    // 解析器只由接收方使用，這裡把它的計數同步到統計
+    __atomic_store_n(&st->resyncs, hmi->rx.resyncs, __ATOMIC_RELAXED);
+    __atomic_store_n(&st->dropped_bytes, hmi->rx.dropped, __ATOMIC_RELAXED);
+}
+
+void hmi_stats_copy(hmi_stats_t *dst, const hmi_stats_t *src) {
+    dst->magic = src->magic;
+    dst->version = src->version;
+    dst->start_ns = src->start_ns;
+    memcpy(dst->name, src->name, sizeof(dst->name));
+    dst->name[sizeof(dst->name) - 1] = '\0';
+
+    const uint64_t *from = (const uint64_t*)&src->tx;
+    uint64_t *to = (uint64_t*)&dst->tx;
+    for (size_t i = 0; i < STATS_COUNTERS; i++) {
+        to[i] = __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+    }
+
+    // 組態幀的總數
+    hmi_cmd_stats_t *config = &dst->tx[CMD_CONFIG_BASE];
+    for (int i = 0; i < 256; i++) {
+        config->frames += dst->tx_config[i].frames;
+        config->bytes += dst->tx_config[i].bytes;
+    }
+}
+
+int hmi_get_stats(hmi_controller_t *hmi, hmi_stats_t *stats) {
+    if (!hmi || !hmi->stats || !stats) {
+        return -1;
+    }
+    hmi_stats_copy(stats, hmi->stats);
+    return 0;
+}
+
+void hmi_stats_reset(hmi_controller_t *hmi) {
+    if (!hmi || !hmi->stats) {
+        return;
+    }
+    hmi_stats_t *st = hmi->stats;
+    uint64_t *counters = (uint64_t*)&st->tx;
+    for (size_t i = 0; i < STATS_COUNTERS; i++) {
+        __atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&st->start_ns, hmi_time_ns(), __ATOMIC_RELAXED);
+}
+
+int hmi_stats_export(hmi_controller_t *hmi, const char *name) {
+    if (!hmi || !hmi->stats || !name || name[0] != '/' || strlen(name) >= sizeof(hmi->stats->name)) {
+        return -1;
+    }
+    if (hmi->async || hmi_rx_threaded(hmi) || hmi->stats->name[0]) {
+        return -1; // 其他線程可能正在累加，不能更換統計位置
+    }
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        printf("無法創建共享內存 %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    if (ftruncate(fd, sizeof(hmi_stats_t)) < 0) {
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    hmi_stats_t *st = mmap(NULL, sizeof(hmi_stats_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (st == MAP_FAILED) {
+        shm_unlink(name);
+        return -1;
+    }
+
+    // magic 最後寫入，讀取方看到它時其他字段已就緒
+    hmi_stats_t *old = hmi->stats;
+    memcpy((uint8_t*)st + sizeof(st->magic), (uint8_t*)old + sizeof(old->magic),
+           sizeof(hmi_stats_t) - sizeof(old->magic));
+    snprintf(st->name, sizeof(st->name), "%s", name);
+    __atomic_store_n(&st->magic, HMI_STATS_MAGIC, __ATOMIC_RELEASE);
+
+    hmi->stats = st;
+    free(old);
+    return 0;
+}
+
+uint32_t hmi_hist_percentile_us(const uint64_t *hist, int per_mille) {
+    uint64_t total = 0;
+    for (int i = 0; i < HMI_HIST_BUCKETS; i++) {
+        total += hist[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    // 第 rank 個樣本所在的格
+    uint64_t rank = (total * per_mille + 999) / 1000;
+    uint64_t seen = 0;
+    for (int i = 0; i < HMI_HIST_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen >= rank) {
+            return i == 0 ? 1 : (uint32_t)1 << i;
+        }
+    }
+    return (uint32_t)1 << (HMI_HIST_BUCKETS - 1);
+}
@@ -0,0 +1,98 @@
+#include "dc_hmi_internal.h"
+
+// ============================================================================
+// 控件哈希表
+// ============================================================================
+//
+// 影子緩存、鏡像和合併發送共用的開放定址表：以 (screen_id, control_id) 和 tag 為鍵，
+// 槽數為 2 的冪，從首選槽起線性探測最多 probe 個槽。條目內容由呼叫者定義，
+// 只要求以 hmi_slot_t 開頭；本文件只讀寫槽頭，條目中的緩衝區在槽位重用時保留。
+
+#define TABLE_MAX_SLOTS (1u << 24)
+
+static uint32_t table_home(const hmi_table_t *t, uint32_t key, uint8_t tag) {
+    return (((key ^ ((uint32_t)tag << 28)) * 2654435761u) >> 8) & t->mask;  // 乘法哈希，分散連續的控件ID
+}
+
+int hmi_table_init(hmi_table_t *t, uint32_t entries, uint32_t stride, uint32_t probe) {
+    // 槽數取 2 的冪，負載不超過一半
+    uint32_t slots = 16;
+    while (slots < entries * 2 && slots < TABLE_MAX_SLOTS) {
+        slots <<= 1;
+    }
+
+    t->entries = calloc(slots, stride);
+    if (!t->entries) {
+        return -1;
+    }
+    t->mask = slots - 1;
+    t->stride = stride;
+    t->probe = probe < slots ? probe : slots;
+    return 0;
+}
+
+void hmi_table_free(hmi_table_t *t) {
+    free(t->entries);
+    t->entries = NULL;
+}
+
+void *hmi_table_find(hmi_table_t *t, uint32_t key, uint8_t tag, int mode, int *created) {
+    uint32_t home = table_home(t, key, tag);
+    hmi_slot_t *spare = NULL;
+    if (created) {
+        *created = 0;
+    }
+
+    for (uint32_t i = 0; i < t->probe; i++) {
+        hmi_slot_t *s = hmi_table_at(t, home + i);
+        if (s->state == HMI_SLOT_USED && s->key == key && s->tag == tag) {
+            return s;
+        }
+        if (s->state == HMI_SLOT_FREE) {
+            if (!spare) {
+                spare = s;
+            }
+            break; // 空槽之後不會再有這個鍵
+        }
+        if (s->state == HMI_SLOT_DELETED && !spare) {
+            spare = s;
+        }
+    }
+    if (mode == HMI_TABLE_LOOKUP) {
+        return NULL;
+    }
+    if (!spare) {
+        if (mode != HMI_TABLE_REPLACE) {
+            return NULL;
+        }
+        spare = hmi_table_at(t, home); // 探測範圍已滿，覆蓋首選槽
+    }
+
+    spare->state = HMI_SLOT_USED;
+    spare->key = key;
+    spare->tag = tag;
+    if (created) {
+        *created = 1;
+    }
+    return spare;
+}
+
+void hmi_table_remove(hmi_table_t *t, void *entry) {
+    hmi_slot_t *s = entry;
+    uint32_t index = hmi_table_index(t, entry);
+
+    // 下一槽為空時沒有探測鏈經過這裡，連同前面相連的已刪除槽一起還原為空槽，
+    // 否則留下刪除標記，查找時跳過
+    if (((hmi_slot_t*)hmi_table_at(t, index + 1))->state != HMI_SLOT_FREE) {
+        s->state = HMI_SLOT_DELETED;
+        return;
+    }
+    s->state = HMI_SLOT_FREE;
+    for (uint32_t i = 1; i <= t->mask; i++) {
+        hmi_slot_t *prev = hmi_table_at(t, index - i);
+        if (prev->state != HMI_SLOT_DELETED) {
+            break;
+        }
+        prev->state = HMI_SLOT_FREE;
+    }
+}
@@ -0,0 +1,1899 @@
+#include "dc_hmi_controller.h"
+#include "hmi_sim.h"
+#include <pthread.h>
+#include <sys/resource.h>
+
+// 串口屏性能測試程式
+// 以模擬器（hmi_sim.c）代替串口屏，不需要實際硬件
+
+static int bench_iterations = 1000;
+
+// ============================================================================
+// 結果記錄（-o 輸出 CSV 或 JSON，用於比較不同版本）
+// ============================================================================
+
+typedef struct {
+    char suite[16];
+    char name[40];
+    char metric[24];
+    char unit[8];
+    double value;
+} bench_result_t;
+
+static bench_result_t *bench_results;
+static int bench_result_count;
+static int bench_result_capacity;
+
+// 名稱只用 ASCII 標識符，輸出時不需要轉義
+static void bench_record(const char *suite, const char *name, const char *metric, double value, const char *unit) {
+    if (bench_result_count == bench_result_capacity) {
+        int capacity = bench_result_capacity ? bench_result_capacity * 2 : 256;
+        bench_result_t *results = realloc(bench_results, sizeof(bench_result_t) * capacity);
+        if (!results) {
+            return;
+        }
+        bench_results = results;
+        bench_result_capacity = capacity;
+    }
+    bench_result_t *r = &bench_results[bench_result_count++];
+    snprintf(r->suite, sizeof(r->suite), "%s", suite);
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    snprintf(r->metric, sizeof(r->metric), "%s", metric);
+    snprintf(r->unit, sizeof(r->unit), "%s", unit);
+    r->value = value;
+}
+
+// 副檔名為 .json 時輸出 JSON，否則輸出 CSV
+static int bench_write_results(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        printf("無法寫入結果文件 %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    size_t len = strlen(path);
+    if (len >= 5 && strcmp(path + len - 5, ".json") == 0) {
+        fprintf(fp, "{\n  \"iterations\": %d,\n  \"timestamp\": %lld,\n  \"results\": [\n",
+                bench_iterations, (long long)time(NULL));
+        for (int i = 0; i < bench_result_count; i++) {
+            bench_result_t *r = &bench_results[i];
+            fprintf(fp, "    {\"suite\": \"%s\", \"name\": \"%s\", \"metric\": \"%s\", \"value\": %.6g, \"unit\": \"%s\"}%s\n",
+                    r->suite, r->name, r->metric, r->value, r->unit, i + 1 < bench_result_count ? "," : "");
+        }
+        fprintf(fp, "  ]\n}\n");
+    } else {
+        fprintf(fp, "suite,name,metric,value,unit\n");
+        for (int i = 0; i < bench_result_count; i++) {
+            bench_result_t *r = &bench_results[i];
+            fprintf(fp, "%s,%s,%s,%.6g,%s\n", r->suite, r->name, r->metric, r->value, r->unit);
+        }
+    }
+
+    fclose(fp);
+    printf("\n%d項結果已寫入 %s\n", bench_result_count, path);
+    return 0;
+}
+
+// ============================================================================
+// 模擬串口屏
+// ============================================================================
+
+// 不限速的模擬器，測量的是主機端開銷
+static hmi_sim_t *bench_sim_open(void) {
+    hmi_sim_t *sim = hmi_sim_create(0);
+    if (sim && hmi_sim_start(sim) < 0) {
+        hmi_sim_destroy(sim);
+        return NULL;
+    }
+    return sim;
+}
+
+// 暫時關閉標準輸出（hmi_init/hmi_close 的提示信息）
+static int quiet_begin(void) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+    return saved;
+}
+
+static void quiet_end(int saved) {
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+// ============================================================================
+// 舊版接收循環（read + usleep(1000) + time(NULL)），作為對照組
+// ============================================================================
+
+static int legacy_receive_response(hmi_controller_t *hmi, hmi_response_t *response, int timeout_ms) {
+    uint8_t buffer[1024];
+    int bytes_read = 0;
+    time_t start_time = time(NULL);
+
+    while ((time(NULL) - start_time) * 1000 < timeout_ms) {
+        int n = read(hmi->fd, buffer + bytes_read, sizeof(buffer) - bytes_read);
+        if (n > 0) {
+            bytes_read += n;
+            if (bytes_read >= 6 && buffer[0] == FRAME_HEADER &&
+                buffer[bytes_read-4] == 0xFF && buffer[bytes_read-3] == 0xFC &&
+                buffer[bytes_read-2] == 0xFF && buffer[bytes_read-1] == 0xFF) {
+                response->cmd = buffer[1];
+                response->length = bytes_read - 6;
+                response->data = NULL;
+                return 0;
+            }
+        }
+        usleep(1000);
+    }
+    return -1;
+}
+
+static int legacy_handshake(hmi_controller_t *hmi) {
+    uint8_t frame[] = {FRAME_HEADER, CMD_HANDSHAKE, 0xFF, 0xFC, 0xFF, 0xFF};
+    if (hmi_send_command(hmi, frame, sizeof(frame)) < 0) {
+        return -1;
+    }
+    hmi_response_t response;
+    if (legacy_receive_response(hmi, &response, 1000) == 0 && response.cmd == 0x55) {
+        return 0;
+    }
+    return -1;
+}
+
+// ============================================================================
+// 往返延遲測試
+// ============================================================================
+
+static uint64_t thread_cpu_ns(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL +
+           (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// samples 需已排序，per_mille 為千分位（500、990、999）
+static uint64_t percentile(const uint64_t *samples, int n, int per_mille) {
+    int index = (int)((int64_t)n * per_mille / 1000);
+    return samples[index < n ? index : n - 1];
+}
+
+// 排序並記錄 p50/p99/p99.9（納秒）
+static void record_latency(const char *suite, const char *name, uint64_t *samples, int n) {
+    qsort(samples, n, sizeof(uint64_t), cmp_u64);
+    bench_record(suite, name, "p50", percentile(samples, n, 500), "ns");
+    bench_record(suite, name, "p99", percentile(samples, n, 990), "ns");
+    bench_record(suite, name, "p99.9", percentile(samples, n, 999), "ns");
+    bench_record(suite, name, "max", samples[n - 1], "ns");
+}
+
+static void run_rtt(const char *name, const char *key, hmi_controller_t *hmi, int (*handshake)(hmi_controller_t*)) {
+    uint64_t *samples = malloc(sizeof(uint64_t) * bench_iterations);
+    int failures = 0;
+
+    uint64_t cpu_start = thread_cpu_ns();
+    uint64_t wall_start = hmi_time_ns();
+    for (int i = 0; i < bench_iterations; i++) {
+        uint64_t t0 = hmi_time_ns();
+        if (handshake(hmi) < 0) {
+            failures++;
+        }
+        samples[i] = hmi_time_ns() - t0;
+    }
+    uint64_t wall = hmi_time_ns() - wall_start;
+    uint64_t cpu = thread_cpu_ns() - cpu_start;
+
+    record_latency("rx", key, samples, bench_iterations);
+    bench_record("rx", key, "cpu", (double)cpu / bench_iterations, "ns");
+    bench_record("rx", key, "failures", failures, "count");
+    printf("%-10s 次數=%d 失敗=%d 平均=%.1fus p50=%.1fus p99=%.1fus CPU=%.1fus/次 (%.1f%%)\n",
+           name, bench_iterations, failures,
+           wall / 1000.0 / bench_iterations,
+           percentile(samples, bench_iterations, 500) / 1000.0,
+           percentile(samples, bench_iterations, 990) / 1000.0,
+           cpu / 1000.0 / bench_iterations,
+           wall ? 100.0 * cpu / wall : 0.0);
+    free(samples);
+}
+
+static int bench_rx(void) {
+    printf("\n=== 接收引擎往返延遲（握手） ===\n");
+
+    hmi_sim_t *sim = bench_sim_open();
+    if (!sim) {
+        return -1;
+    }
+
+    hmi_controller_t hmi;
+    if (hmi_init(&hmi, hmi_sim_path(sim), BAUD_115200) < 0) {
+        hmi_sim_destroy(sim);
+        return -1;
+    }
+
+    run_rtt("poll引擎", "handshake", &hmi, hmi_handshake);
+    run_rtt("舊版循環", "legacy_handshake", &hmi, legacy_handshake);
+
+    hmi_close(&hmi);
+    hmi_sim_destroy(sim);
+    return 0;
+}
+
+// ============================================================================
+// 幀解析吞吐量
+// ============================================================================
+
+// 生成混合數據流：控件上傳、回應、觸摸事件，夾雜少量雜散字節
+static uint32_t build_parse_stream(uint8_t *stream, uint32_t size, uint32_t *frames) {
+    uint32_t len = 0;
+    uint32_t count = 0;
+    uint32_t seed = 12345;
+
+    while (len + 64 < size) {
+        seed = seed * 1103515245 + 12345;
+        uint8_t kind = (seed >> 16) % 4;
+
+        if (kind == 3) {
+            stream[len++] = 0x00; // 雜散字節
+            stream[len++] = 0x5A;
+        }
+        stream[len++] = FRAME_HEADER;
+        if (kind == 0) {
+            stream[len++] = 0x01; // 觸摸按下
+            for (int i = 0; i < 4; i++) stream[len++] = (seed >> (i * 4)) & 0xFF;
+        } else {
+            uint8_t text_len = (seed >> 8) % 32;
+            stream[len++] = CMD_CONFIG_BASE;
+            stream[len++] = CMD_READ_CONTROL;
+            for (int i = 0; i < 5 + text_len; i++) stream[len++] = 0x30 + (i % 10);
+        }
+        stream[len++] = 0xFF; stream[len++] = 0xFC;
+        stream[len++] = 0xFF; stream[len++] = 0xFF;
+        count++;
+    }
+    *frames = count;
+    return len;
+}
+
+static int bench_parse(void) {
+    printf("\n=== 幀解析吞吐量 ===\n");
+
+    const uint32_t stream_size = 1 << 20;
+    uint8_t *stream = malloc(stream_size);
+    uint32_t expected;
+    uint32_t len = build_parse_stream(stream, stream_size, &expected);
+
+    static hmi_parser_t parser;
+    const uint16_t chunks[] = {1, 16, 64, 512};
+
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        uint16_t chunk = chunks[c];
+        int rounds = chunk == 1 ? 2 : 20;
+        uint64_t frames = 0;
+
+        memset(&parser, 0, sizeof(parser));
+        uint64_t t0 = hmi_time_ns();
+        for (int r = 0; r < rounds; r++) {
+            uint32_t pos = 0;
+            while (pos < len) {
+                uint16_t n = len - pos < chunk ? len - pos : chunk;
+                pos += hmi_parser_feed(&parser, stream + pos, n);
+
+                hmi_response_t frame;
+                while (hmi_parser_next(&parser, &frame) == 0) {
+                    frames++;
+                }
+            }
+        }
+        uint64_t elapsed = hmi_time_ns() - t0;
+
+        double mbps = (double)len * rounds / (elapsed / 1e9) / 1e6;
+        char key[16];
+        snprintf(key, sizeof(key), "chunk_%u", chunk);
+        bench_record("parse", key, "throughput", mbps, "MB/s");
+        printf("每次讀取%4d字節: %8.1f MB/s, 幀數=%llu/%llu, 重新同步=%u, 為2Mbaud的%.0f倍\n",
+               chunk, mbps, (unsigned long long)frames, (unsigned long long)expected * rounds,
+               parser.resyncs, mbps * 1e6 / 200000.0);
+    }
+
+    free(stream);
+    return 0;
+}
+
+// ============================================================================
+// 批量發送：100個控件更新的系統呼叫次數和耗時
+// ============================================================================
+
+static void run_updates(const char *name, const char *key, hmi_controller_t *hmi, int batched) {
+    const int updates = 100;
+    uint32_t syscalls = hmi->tx_syscalls;
+    uint64_t t0 = hmi_time_ns();
+
+    for (int r = 0; r < bench_iterations / 10; r++) {
+        if (batched) {
+            hmi_begin_batch(hmi);
+        }
+        for (int i = 0; i < updates; i++) {
+            hmi_update_progress(hmi, 1, i, r + i);
+        }
+        if (batched) {
+            hmi_flush(hmi);
+        }
+    }
+
+    int rounds = bench_iterations / 10;
+    uint64_t elapsed = hmi_time_ns() - t0;
+    bench_record("cork", key, "syscalls", (double)(hmi->tx_syscalls - syscalls) / rounds, "count");
+    bench_record("cork", key, "time", (double)elapsed / rounds, "ns");
+    printf("%-8s 每次刷新(%d個更新): 系統呼叫=%.1f 耗時=%.1fus\n", name, updates,
+           (double)(hmi->tx_syscalls - syscalls) / rounds, elapsed / 1000.0 / rounds);
+}
+
+static int bench_cork(void) {
+    printf("\n=== 批量發送 ===\n");
+
+    hmi_sim_t *sim = bench_sim_open();
+    if (!sim) {
+        return -1;
+    }
+
+    hmi_controller_t hmi;
+    if (hmi_init(&hmi, hmi_sim_path(sim), BAUD_115200) < 0) {
+        hmi_sim_destroy(sim);
+        return -1;
+    }
+
+    run_updates("逐幀發送", "per_frame", &hmi, 0);
+    run_updates("批量發送", "batched", &hmi, 1);
+
+    hmi_close(&hmi);
+    hmi_sim_destroy(sim);
+    return 0;
+}
+
+// ============================================================================
+// 編碼開銷：每個控件/繪圖函數生成一幀的耗時（不含系統呼叫）
+// ============================================================================
+
+typedef struct {
+    const char *name;
+    void (*call)(hmi_controller_t *hmi, uint32_t i);
+} encode_case_t;
+
+static void enc_switch_screen(hmi_controller_t *hmi, uint32_t i) { hmi_switch_screen(hmi, i & 7); }
+static void enc_switch_screen_with_effect(hmi_controller_t *hmi, uint32_t i) {
+    hmi_switch_screen_with_effect(hmi, i & 7, 1, 1, 0, 799, 0, 479);
+}
+static void enc_config_touch(hmi_controller_t *hmi, uint32_t i) {
+    touch_config_t config = { .enable = 1, .beep = i & 1 };
+    hmi_config_touch(hmi, &config);
+}
+static void enc_calibrate_touch(hmi_controller_t *hmi, uint32_t i) { (void)i; hmi_calibrate_touch(hmi); }
+static void enc_test_touch(hmi_controller_t *hmi, uint32_t i) { hmi_test_touch(hmi, i & 1); }
+static void enc_update_text(hmi_controller_t *hmi, uint32_t i) { hmi_update_text(hmi, 1, i & 63, "Temperature 25.3C"); }
+static void enc_clear_text(hmi_controller_t *hmi, uint32_t i) { hmi_clear_text(hmi, 1, i & 63); }
+static void enc_set_text_blink(hmi_controller_t *hmi, uint32_t i) { hmi_set_text_blink(hmi, 1, i & 63, 50); }
+static void enc_set_text_scroll(hmi_controller_t *hmi, uint32_t i) { hmi_set_text_scroll(hmi, 1, i & 63, 10); }
+static void enc_set_text_color(hmi_controller_t *hmi, uint32_t i) {
+    hmi_set_text_color(hmi, 1, i & 63, COLOR_WHITE, COLOR_BLACK);
+}
+static void enc_format_text(hmi_controller_t *hmi, uint32_t i) { hmi_format_text(hmi, 1, i & 63, DATA_UINT, 1, i); }
+static void enc_set_button_state(hmi_controller_t *hmi, uint32_t i) { hmi_set_button_state(hmi, 1, i & 63, i & 1); }
+static void enc_update_progress(hmi_controller_t *hmi, uint32_t i) { hmi_update_progress(hmi, 1, i & 63, i); }
+static void enc_update_slider(hmi_controller_t *hmi, uint32_t i) { hmi_update_slider(hmi, 1, i & 63, i); }
+static void enc_update_meter(hmi_controller_t *hmi, uint32_t i) { hmi_update_meter(hmi, 1, i & 63, i); }
+static void enc_show_icon(hmi_controller_t *hmi, uint32_t i) { hmi_show_icon(hmi, 1, i & 63, i & 3); }
+static void enc_set_icon_position(hmi_controller_t *hmi, uint32_t i) { hmi_set_icon_position(hmi, 1, i & 63, i & 511, 100); }
+static void enc_start_animation(hmi_controller_t *hmi, uint32_t i) { hmi_start_animation(hmi, 1, i & 63); }
+static void enc_stop_animation(hmi_controller_t *hmi, uint32_t i) { hmi_stop_animation(hmi, 1, i & 63); }
+static void enc_pause_animation(hmi_controller_t *hmi, uint32_t i) { hmi_pause_animation(hmi, 1, i & 63); }
+static void enc_set_animation_frame(hmi_controller_t *hmi, uint32_t i) { hmi_set_animation_frame(hmi, 1, i & 63, i & 7); }
+static void enc_draw_point(hmi_controller_t *hmi, uint32_t i) { hmi_draw_point(hmi, i & 511, 100); }
+static void enc_draw_line(hmi_controller_t *hmi, uint32_t i) { hmi_draw_line(hmi, 0, 0, i & 511, 200); }
+static void enc_draw_rectangle(hmi_controller_t *hmi, uint32_t i) { hmi_draw_rectangle(hmi, 10, 10, i & 511, 200, i & 1); }
+static void enc_draw_circle(hmi_controller_t *hmi, uint32_t i) { hmi_draw_circle(hmi, 400, 240, i & 127, i & 1); }
+static void enc_display_text(hmi_controller_t *hmi, uint32_t i) {
+    hmi_display_text(hmi, i & 511, 100, 0, FONT_ASCII_12X24, "Hello HMI");
+}
+
+static const encode_case_t encode_cases[] = {
+    { "hmi_switch_screen", enc_switch_screen },
+    { "hmi_switch_screen_with_effect", enc_switch_screen_with_effect },
+    { "hmi_config_touch", enc_config_touch },
+    { "hmi_calibrate_touch", enc_calibrate_touch },
+    { "hmi_test_touch", enc_test_touch },
+    { "hmi_update_text", enc_update_text },
+    { "hmi_clear_text", enc_clear_text },
+    { "hmi_set_text_blink", enc_set_text_blink },
+    { "hmi_set_text_scroll", enc_set_text_scroll },
+    { "hmi_set_text_color", enc_set_text_color },
+    { "hmi_format_text", enc_format_text },
+    { "hmi_set_button_state", enc_set_button_state },
+    { "hmi_update_progress", enc_update_progress },
+    { "hmi_update_slider", enc_update_slider },
+    { "hmi_update_meter", enc_update_meter },
+    { "hmi_show_icon", enc_show_icon },
+    { "hmi_set_icon_position", enc_set_icon_position },
+    { "hmi_start_animation", enc_start_animation },
+    { "hmi_stop_animation", enc_stop_animation },
+    { "hmi_pause_animation", enc_pause_animation },
+    { "hmi_set_animation_frame", enc_set_animation_frame },
+    { "hmi_draw_point", enc_draw_point },
+    { "hmi_draw_line", enc_draw_line },
+    { "hmi_draw_rectangle", enc_draw_rectangle },
+    { "hmi_draw_circle", enc_draw_circle },
+    { "hmi_display_text", enc_display_text },
+};
+
+static int bench_encode(void) {
+    printf("\n=== 編碼開銷（每幀） ===\n");
+
+    hmi_sim_t *sim = bench_sim_open();
+    if (!sim) {
+        return -1;
+    }
+
+    hmi_controller_t hmi;
+    int saved = quiet_begin();
+    int ret = hmi_init(&hmi, hmi_sim_path(sim), BAUD_115200);
+    quiet_end(saved);
+    if (ret < 0) {
+        hmi_sim_destroy(sim);
+        return -1;
+    }
+
+    // 在批量模式下編碼，每幀之後丟棄發送緩衝區，不產生任何寫入
+    uint32_t count = bench_iterations * 100;
+    hmi_begin_batch(&hmi);
+    for (size_t c = 0; c < sizeof(encode_cases) / sizeof(encode_cases[0]); c++) {
+        const encode_case_t *ec = &encode_cases[c];
+
+        hmi.tx_len = 0;
+        ec->call(&hmi, 0);
+        uint16_t frame_bytes = hmi.tx_len;
+
+        // 取三次中最快的一次，減少調度和頻率變化的影響
+        uint64_t best = UINT64_MAX;
+        for (int round = 0; round < 3; round++) {
+            uint64_t t0 = hmi_time_ns();
+            for (uint32_t i = 0; i < count; i++) {
+                hmi.tx_len = 0;
+                ec->call(&hmi, i);
+            }
+            uint64_t elapsed = hmi_time_ns() - t0;
+            if (elapsed < best) {
+                best = elapsed;
+            }
+        }
+        double ns = (double)best / count;
+
+        bench_record("encode", ec->name, "time", ns, "ns");
+        bench_record("encode", ec->name, "frame_bytes", frame_bytes, "byte");
+        printf("%-30s %7.1f ns/幀 %4u字節\n", ec->name, ns, frame_bytes);
+    }
+    hmi.tx_len = 0;
+    hmi_flush(&hmi);
+
+    saved = quiet_begin();
+    hmi_close(&hmi);
+    quiet_end(saved);
+    hmi_sim_destroy(sim);
+    return 0;
+}
+
+// ============================================================================
+// 發送吞吐量：模擬器端實際收到的幀數和字節數
+// ============================================================================
+
+// 等待模擬器收完 updates 個控件更新（批量模式會合併為 0xB1 0x12 幀），返回收完的時間
+static uint64_t wait_sim_updates(hmi_sim_t *sim, uint64_t updates, int timeout_ms) {
+    uint64_t deadline = hmi_time_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    hmi_sim_stats_t stats;
+
+    for (;;) {
+        hmi_sim_get_stats(sim, &stats);
+        uint64_t now = hmi_time_ns();
+        if (stats.updates >= updates || now > deadline) {
+            return now;
+        }
+        usleep(100);
+    }
+}
+
+// mode: 0 逐幀同步發送，1 每100幀批量發送，2 異步佇列
+static void run_throughput(uint32_t bps, int mode) {
+    static const char *mode_names[] = { "sync", "batch", "async" };
+    hmi_sim_t *sim = hmi_sim_create(bps);
+    if (!sim || hmi_sim_start(sim) < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+
+    hmi_controller_t hmi;
+    int saved = quiet_begin();
+    int ret = hmi_init(&hmi, hmi_sim_path(sim), BAUD_115200);
+    quiet_end(saved);
+    if (ret < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+    if (mode == 2) {
+        hmi_async_start(&hmi, 0);
+    }
+
+    // 限速時發送約半秒的數據量（每幀15字節）
+    uint32_t count = bps ? bps / 10 / 15 / 2 : (uint32_t)bench_iterations * 20;
+    hmi_sim_stats_t before, after;
+    hmi_sim_get_stats(sim, &before);
+    uint32_t syscalls = hmi.tx_syscalls;
+
+    uint64_t t0 = hmi_time_ns();
+    for (uint32_t i = 0; i < count; i++) {
+        if (mode == 1 && i % 100 == 0) {
+            hmi_begin_batch(&hmi);
+        }
+        hmi_update_progress(&hmi, 1, i & 63, i);
+        if (mode == 1 && (i % 100 == 99 || i + 1 == count)) {
+            hmi_flush(&hmi);
+        }
+    }
+    uint64_t submit = hmi_time_ns() - t0;
+    uint64_t elapsed = wait_sim_updates(sim, before.updates + count, 10000) - t0;
+    hmi_sim_get_stats(sim, &after);
+    if (mode == 2) {
+        hmi_async_stop(&hmi);
+    }
+
+    uint64_t frames = after.frames_rx - before.frames_rx;
+    uint64_t updates = after.updates - before.updates;
+    uint64_t bytes = after.bytes_rx - before.bytes_rx;
+    double seconds = elapsed / 1e9;
+    double syscalls_per_update = (double)(hmi.tx_syscalls - syscalls) / count;
+    char label[40];
+    snprintf(label, sizeof(label), "%s_%u", mode_names[mode], bps);
+    bench_record("io", label, "frames_per_s", frames / seconds, "frame/s");
+    bench_record("io", label, "updates_per_s", updates / seconds, "update/s");
+    bench_record("io", label, "bytes_per_s", bytes / seconds, "byte/s");
+    bench_record("io", label, "syscalls_per_update", syscalls_per_update, "count");
+    bench_record("io", label, "submit", (double)submit / count, "ns");
+    if (bps) {
+        bench_record("io", label, "line_utilization", 100.0 * bytes * 10 / bps / seconds, "%");
+    }
+
+    printf("%8u %-6s 更新=%6llu/%-6u 幀=%6llu %9.0f 更新/s %10.0f 字節/s 系統呼叫=%.2f/次",
+           bps, mode_names[mode], (unsigned long long)updates, count, (unsigned long long)frames,
+           updates / seconds, bytes / seconds, syscalls_per_update);
+    if (bps) {
+        printf(" 線路利用率=%.0f%%", 100.0 * bytes * 10 / bps / seconds);
+    }
+    printf("\n");
+
+    saved = quiet_begin();
+    hmi_close(&hmi);
+    quiet_end(saved);
+    hmi_sim_destroy(sim);
+}
+
+static int bench_io(void) {
+    printf("\n=== 發送吞吐量（模擬器端統計，速率0為不限速） ===\n");
+
+    const uint32_t rates[] = {0, 115200, 2000000};
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        for (int mode = 0; mode < 3; mode++) {
+            run_throughput(rates[r], mode);
+        }
+    }
+    return 0;
+}
+
+// ============================================================================
+// 讀取往返延遲：hmi_read_* 的 p50/p99/p99.9
+// ============================================================================
+
+typedef struct {
+    const char *name;
+    int (*call)(hmi_controller_t *hmi, uint32_t i);
+} read_case_t;
+
+static int rd_screen(hmi_controller_t *hmi, uint32_t i) {
+    uint16_t screen_id;
+    (void)i;
+    return hmi_read_screen(hmi, &screen_id);
+}
+static int rd_text(hmi_controller_t *hmi, uint32_t i) {
+    char text[64];
+    return hmi_read_text(hmi, 1, 1 + (i & 7), text, sizeof(text));
+}
+static int rd_button_state(hmi_controller_t *hmi, uint32_t i) {
+    uint8_t state;
+    return hmi_read_button_state(hmi, 1, 11 + (i & 7), &state);
+}
+static int rd_progress(hmi_controller_t *hmi, uint32_t i) {
+    uint32_t value;
+    return hmi_read_progress(hmi, 1, 21 + (i & 7), &value);
+}
+static int rd_slider(hmi_controller_t *hmi, uint32_t i) {
+    uint32_t value;
+    return hmi_read_slider(hmi, 1, 21 + (i & 7), &value);
+}
+static int rd_meter(hmi_controller_t *hmi, uint32_t i) {
+    uint32_t value;
+    return hmi_read_meter(hmi, 1, 21 + (i & 7), &value);
+}
+static int rd_icon(hmi_controller_t *hmi, uint32_t i) {
+    uint8_t frame_id;
+    return hmi_read_icon(hmi, 1, 31 + (i & 7), &frame_id);
+}
+
+static const read_case_t read_cases[] = {
+    { "hmi_read_screen", rd_screen },
+    { "hmi_read_text", rd_text },
+    { "hmi_read_button_state", rd_button_state },
+    { "hmi_read_progress", rd_progress },
+    { "hmi_read_slider", rd_slider },
+    { "hmi_read_meter", rd_meter },
+    { "hmi_read_icon", rd_icon },
+};
+
+// 文本 1~8、按鈕 11~18、數值 21~28、圖標 31~38
+static void preload_controls(hmi_sim_t *sim) {
+    const uint8_t text[] = "Temperature 25.3C";
+    const uint8_t state = 1;
+    const uint8_t number[4] = {0, 0, 0x30, 0x39};
+    const uint8_t frame_id = 2;
+
+    for (uint16_t i = 0; i < 8; i++) {
+        hmi_sim_set_control(sim, 1, 1 + i, 0x11, text, sizeof(text) - 1);
+        hmi_sim_set_control(sim, 1, 11 + i, 0x10, &state, 1);
+        hmi_sim_set_control(sim, 1, 21 + i, 0x12, number, sizeof(number));
+        hmi_sim_set_control(sim, 1, 31 + i, 0x1A, &frame_id, 1);
+    }
+}
+
+static void run_read(const read_case_t *rc, hmi_controller_t *hmi, uint32_t bps, int iterations) {
+    uint64_t *samples = malloc(sizeof(uint64_t) * iterations);
+    int failures = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        uint64_t t0 = hmi_time_ns();
+        if (rc->call(hmi, i) < 0) {
+            failures++;
+        }
+        samples[i] = hmi_time_ns() - t0;
+    }
+
+    char label[48];
+    snprintf(label, sizeof(label), "%s_%u", rc->name, bps);
+    record_latency("latency", label, samples, iterations);
+    bench_record("latency", label, "failures", failures, "count");
+    printf("%-24s %8u 失敗=%d p50=%8.1fus p99=%8.1fus p99.9=%8.1fus\n", rc->name, bps, failures,
+           percentile(samples, iterations, 500) / 1000.0, percentile(samples, iterations, 990) / 1000.0,
+           percentile(samples, iterations, 999) / 1000.0);
+    free(samples);
+}
+
+// 流水線批量讀取：每次16個請求，統計每個請求的往返時間
+static void run_read_controls(hmi_controller_t *hmi, uint32_t bps, int iterations) {
+    const int batch = HMI_READ_WINDOW;
+    int rounds = (iterations + batch - 1) / batch;
+    int n = 0;
+    int failures = 0;
+    uint64_t *samples = malloc(sizeof(uint64_t) * rounds * batch);
+    hmi_read_req_t reqs[HMI_READ_WINDOW];
+
+    uint64_t t0 = hmi_time_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < batch; i++) {
+            reqs[i] = (hmi_read_req_t){ .screen_id = 1, .control_id = 21 + (i & 7) };
+        }
+        hmi_read_controls(hmi, reqs, batch, 1000, NULL, NULL);
+        for (int i = 0; i < batch; i++) {
+            if (reqs[i].status == HMI_READ_DONE) {
+                samples[n++] = (uint64_t)reqs[i].rtt_us * 1000;
+            } else {
+                failures++;
+            }
+        }
+    }
+    uint64_t elapsed = hmi_time_ns() - t0;
+
+    char label[48];
+    snprintf(label, sizeof(label), "hmi_read_controls_%u", bps);
+    bench_record("latency", label, "failures", failures, "count");
+    bench_record("latency", label, "reads_per_s", rounds * batch / (elapsed / 1e9), "read/s");
+    if (n > 0) {
+        record_latency("latency", label, samples, n);
+        printf("%-24s %8u 失敗=%d p50=%8.1fus p99=%8.1fus p99.9=%8.1fus (%.0f 次/s)\n", "hmi_read_controls", bps,
+               failures, percentile(samples, n, 500) / 1000.0, percentile(samples, n, 990) / 1000.0,
+               percentile(samples, n, 999) / 1000.0, rounds * batch / (elapsed / 1e9));
+    }
+    free(samples);
+}
+
+// 串口屏每次處理延遲 5ms 時，逐個讀取與流水線讀取 40 個控件的總耗時
+#define PIPELINE_READS      40
+#define PIPELINE_LATENCY_US 5000
+
+static void run_read_pipeline(void) {
+    hmi_sim_t *sim = hmi_sim_create(0);
+    if (!sim || hmi_sim_start(sim) < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+    preload_controls(sim);
+    hmi_controller_t hmi;
+    int saved = quiet_begin();
+    int ret = hmi_init(&hmi, hmi_sim_path(sim), BAUD_115200);
+    quiet_end(saved);
+    if (ret < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+    hmi_sim_set_latency(sim, PIPELINE_LATENCY_US);
+
+    int failures = 0;
+    uint64_t t0 = hmi_time_ns();
+    for (int i = 0; i < PIPELINE_READS; i++) {
+        if (rd_slider(&hmi, i) < 0) {
+            failures++;
+        }
+    }
+    double serial_ms = (hmi_time_ns() - t0) / 1e6;
+
+    hmi_read_req_t reqs[PIPELINE_READS];
+    for (int i = 0; i < PIPELINE_READS; i++) {
+        reqs[i] = (hmi_read_req_t){ .screen_id = 1, .control_id = 21 + (i & 7) };
+    }
+    uint64_t t1 = hmi_time_ns();
+    hmi_read_controls(&hmi, reqs, PIPELINE_READS, 1000, NULL, NULL);
+    double pipelined_ms = (hmi_time_ns() - t1) / 1e6;
+    for (int i = 0; i < PIPELINE_READS; i++) {
+        failures += reqs[i].status != HMI_READ_DONE;
+    }
+
+    bench_record("latency", "pipeline_serial", "total", serial_ms, "ms");
+    bench_record("latency", "pipeline_read_controls", "total", pipelined_ms, "ms");
+    bench_record("latency", "pipeline", "failures", failures, "count");
+    printf("%d 次讀取（處理延遲 %dms）: 逐個 %.1fms，hmi_read_controls %.1fms，失敗=%d\n", PIPELINE_READS,
+           PIPELINE_LATENCY_US / 1000, serial_ms, pipelined_ms, failures);
+
+    saved = quiet_begin();
+    hmi_close(&hmi);
+    quiet_end(saved);
+    hmi_sim_destroy(sim);
+}
+
+static int bench_latency(void) {
+    printf("\n=== 讀取往返延遲（速率0為不限速） ===\n");
+
+    // 不限速時測量全部讀取函數；限速時只測一個數值讀取，延遲主要由線路決定
+    const uint32_t rates[] = {0, 115200, 2000000};
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        hmi_sim_t *sim = hmi_sim_create(rates[r]);
+        if (!sim || hmi_sim_start(sim) < 0) {
+            hmi_sim_destroy(sim);
+            return -1;
+        }
+        preload_controls(sim);
+
+        hmi_controller_t hmi;
+        int saved = quiet_begin();
+        int ret = hmi_init(&hmi, hmi_sim_path(sim), BAUD_115200);
+        quiet_end(saved);
+        if (ret < 0) {
+            hmi_sim_destroy(sim);
+            return -1;
+        }
+
+        if (rates[r] == 0) {
+            for (size_t c = 0; c < sizeof(read_cases) / sizeof(read_cases[0]); c++) {
+                run_read(&read_cases[c], &hmi, rates[r], bench_iterations);
+            }
+        } else {
+            run_read(&read_cases[3], &hmi, rates[r], bench_iterations);
+        }
+        run_read_controls(&hmi, rates[r], bench_iterations);
+
+        // 鏡像模式：首次讀取詢問串口屏，之後查表返回
+        static const read_case_t mirror_case = { "hmi_read_slider_mirror", rd_slider };
+        hmi_set_read_mode(&hmi, HMI_READ_MIRROR);
+        run_read(&mirror_case, &hmi, rates[r], bench_iterations);
+
+        saved = quiet_begin();
+        hmi_close(&hmi);
+        quiet_end(saved);
+        hmi_sim_destroy(sim);
+    }
+    run_read_pipeline();
+    return 0;
+}
+
+// ============================================================================
+// 多線程提交：1~16個生產者同時更新控件
+// ============================================================================
+
+#define MAX_PRODUCERS 16
+
+typedef struct {
+    hmi_controller_t *hmi;
+    pthread_mutex_t *lock;       // 非 NULL 時每次呼叫加全局鎖（對照組）
+    int id;
+    int count;
+    uint64_t *samples;
+    pthread_barrier_t *start;
+} producer_t;
+
+static void *producer_thread(void *arg) {
+    producer_t *p = (producer_t*)arg;
+
+    pthread_barrier_wait(p->start);
+    for (int i = 0; i < p->count; i++) {
+        uint64_t t0 = hmi_time_ns();
+        if (p->lock) {
+            pthread_mutex_lock(p->lock);
+        }
+        hmi_update_progress(p->hmi, 1, p->id, i);
+        if (p->lock) {
+            pthread_mutex_unlock(p->lock);
+        }
+        p->samples[i] = hmi_time_ns() - t0;
+    }
+    return NULL;
+}
+
+static void run_producers(const char *name, const char *key, hmi_controller_t *hmi, int threads, int count,
+                          pthread_mutex_t *lock) {
+    producer_t producers[MAX_PRODUCERS];
+    pthread_t tids[MAX_PRODUCERS];
+    pthread_barrier_t start;
+    uint64_t *samples = malloc(sizeof(uint64_t) * threads * count);
+
+    pthread_barrier_init(&start, NULL, threads + 1);
+    for (int t = 0; t < threads; t++) {
+        producers[t] = (producer_t){ hmi, lock, t, count, samples + t * count, &start };
+        pthread_create(&tids[t], NULL, producer_thread, &producers[t]);
+    }
+
+    pthread_barrier_wait(&start);
+    uint64_t t0 = hmi_time_ns();
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    uint64_t submit = hmi_time_ns() - t0;
+    hmi_async_fence(hmi, 10000);
+    uint64_t total = hmi_time_ns() - t0;
+    pthread_barrier_destroy(&start);
+
+    int n = threads * count;
+    char label[40];
+    snprintf(label, sizeof(label), "%s_%d", key, threads);
+    record_latency("mpsc", label, samples, n);
+    bench_record("mpsc", label, "frames_per_s", n / (total / 1e9), "frame/s");
+    printf("%-8s 線程=%2d 每次提交 p50=%6.0fns p99=%8.0fns 提交=%.1fms 送完=%.1fms (%.2f M幀/s)\n",
+           name, threads, (double)samples[n / 2], (double)samples[n * 99 / 100],
+           submit / 1e6, total / 1e6, n / (total / 1e3));
+    free(samples);
+}
+
+static int bench_mpsc(void) {
+    printf("\n=== 多線程提交 ===\n");
+
+    hmi_sim_t *sim = bench_sim_open();
+    if (!sim) {
+        return -1;
+    }
+
+    hmi_controller_t hmi;
+    if (hmi_init(&hmi, hmi_sim_path(sim), BAUD_115200) < 0) {
+        hmi_sim_destroy(sim);
+        return -1;
+    }
+
+    const int producers[] = {1, 2, 4, 8, 16};
+    int count = bench_iterations * 10;
+
+    // 對照組：全局鎖保護的同步呼叫
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    for (size_t i = 0; i < sizeof(producers) / sizeof(producers[0]); i++) {
+        run_producers("全局鎖", "global_lock", &hmi, producers[i], count / 10, &lock);
+    }
+
+    hmi_async_start(&hmi, 1 << 20);
+    for (size_t i = 0; i < sizeof(producers) / sizeof(producers[0]); i++) {
+        run_producers("無鎖佇列", "lockfree", &hmi, producers[i], count, NULL);
+    }
+    hmi_async_stop(&hmi);
+
+    hmi_close(&hmi);
+    hmi_sim_destroy(sim);
+    return 0;
+}
+
+// ============================================================================
+// 多屏管理器：1~12個串口屏，每屏一個提交線程
+// ============================================================================
+
+typedef struct {
+    hmi_controller_t *hmi;
+    int count;
+    pthread_barrier_t *start;
+} panel_load_t;
+
+static void *panel_load_thread(void *arg) {
+    panel_load_t *load = (panel_load_t*)arg;
+
+    pthread_barrier_wait(load->start);
+    for (int i = 0; i < load->count; i++) {
+        hmi_update_progress(load->hmi, 1, i % 64, i);
+    }
+    return NULL;
+}
+
+// workers 為 0 時每屏各用一個異步發送線程（對照組）
+static void run_panels(int panels, int workers, int count) {
+    hmi_sim_t *sims[HMI_MAX_PANELS];
+    hmi_controller_t *hmis = calloc(panels, sizeof(hmi_controller_t));
+    panel_load_t loads[HMI_MAX_PANELS];
+    pthread_t tids[HMI_MAX_PANELS];
+    pthread_barrier_t start;
+    hmi_manager_t *mgr = workers > 0 ? hmi_manager_create(workers) : NULL;
+
+    int saved = quiet_begin();
+    for (int i = 0; i < panels; i++) {
+        sims[i] = bench_sim_open();
+        hmi_init(&hmis[i], hmi_sim_path(sims[i]), BAUD_115200);
+        if (mgr) {
+            hmi_manager_add(mgr, &hmis[i]);
+        } else {
+            hmi_async_start(&hmis[i], 0);
+        }
+    }
+    if (mgr) {
+        hmi_manager_start(mgr);
+    }
+    quiet_end(saved);
+
+    pthread_barrier_init(&start, NULL, panels + 1);
+    for (int i = 0; i < panels; i++) {
+        loads[i] = (panel_load_t){ &hmis[i], count, &start };
+        pthread_create(&tids[i], NULL, panel_load_thread, &loads[i]);
+    }
+    pthread_barrier_wait(&start);
+    uint64_t t0 = hmi_time_ns();
+    uint32_t max_depth = 0;
+    for (int i = 0; i < panels; i++) {
+        pthread_join(tids[i], NULL);
+        if (mgr && hmi_manager_queue_depth(mgr, i) > max_depth) {
+            max_depth = hmi_manager_queue_depth(mgr, i);
+        }
+    }
+    for (int i = 0; i < panels; i++) {
+        hmi_async_fence(&hmis[i], 10000);
+    }
+    uint64_t elapsed = hmi_time_ns() - t0;
+    pthread_barrier_destroy(&start);
+
+    char label[40];
+    snprintf(label, sizeof(label), "panels_%d_workers_%d", panels, workers);
+    bench_record("manager", label, "frames_per_s", (double)panels * count / (elapsed / 1e9), "frame/s");
+    bench_record("manager", label, "max_queue", max_depth, "byte");
+    printf("串口屏=%2d %-10s 總計 %.2f M幀/s, 每屏 %.2f M幀/s, 最大佇列=%u字節\n",
+           panels, workers == 0 ? "每屏線程" : workers == 1 ? "1工作線程" : "4工作線程",
+           (double)panels * count / (elapsed / 1e3), (double)count / (elapsed / 1e3), max_depth);
+
+    saved = quiet_begin();
+    hmi_manager_destroy(mgr);
+    for (int i = 0; i < panels; i++) {
+        hmi_close(&hmis[i]);
+        hmi_sim_destroy(sims[i]);
+    }
+    quiet_end(saved);
+    free(hmis);
+}
+
+static int bench_manager(void) {
+    printf("\n=== 多屏管理器 ===\n");
+
+    const int panels[] = {1, 4, 8, 12};
+    int count = bench_iterations * 10;
+
+    const int modes[] = {0, 1, 4};
+    for (size_t i = 0; i < sizeof(panels) / sizeof(panels[0]); i++) {
+        for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+            run_panels(panels[i], modes[m], count);
+        }
+    }
+    return 0;
+}
+
+// ============================================================================
+// 合併發送：1kHz 採樣遠超線路能力時的顯示延遲和佇列深度
+// ============================================================================
+
+#define COALESCE_CONTROLS 16
+
+// 等待模擬器上所有控件顯示 value，返回等待結束的時間
+static uint64_t wait_sim_values(hmi_sim_t *sim, uint32_t value, int timeout_ms) {
+    uint64_t deadline = hmi_time_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    uint8_t expect[4] = { value >> 24, value >> 16, value >> 8, value };
+
+    for (;;) {
+        int done = 1;
+        for (uint16_t c = 0; c < COALESCE_CONTROLS && done; c++) {
+            uint8_t shown[HMI_FRAME_MAX];
+            uint16_t length = 0;
+            done = hmi_sim_get_control(sim, 1, c, shown, &length) == 0 && length == 4 &&
+                   memcmp(shown, expect, 4) == 0;
+        }
+        uint64_t now = hmi_time_ns();
+        if (done || now > deadline) {
+            return now;
+        }
+        usleep(500);
+    }
+}
+
+// 每毫秒一次採樣，每次更新 COALESCE_CONTROLS 個進度條，持續 ms 毫秒
+static void run_coalesce(baud_rate_t baud, int coalesce, int ms) {
+    uint32_t bps = hmi_baud_to_bps(baud);
+    hmi_sim_t *sim = hmi_sim_create(bps);
+    if (!sim || hmi_sim_start(sim) < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+    hmi_controller_t hmi;
+    int saved = quiet_begin();
+    int ret = hmi_init(&hmi, hmi_sim_path(sim), baud);   // 調度按 hmi.baudrate 限速
+    quiet_end(saved);
+    if (ret < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+    hmi_async_start(&hmi, 0);
+    if (coalesce) {
+        hmi_coalesce_start(&hmi, 0, 0);
+    }
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    uint64_t t0 = hmi_time_ns();
+    uint32_t sample;
+    for (sample = 1; sample <= (uint32_t)ms; sample++) {
+        for (uint16_t c = 0; c < COALESCE_CONTROLS; c++) {
+            hmi_update_progress(&hmi, 1, c, sample);
+        }
+        next.tv_nsec += 1000000L;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    uint64_t produced = hmi_time_ns();
+    uint64_t lag = wait_sim_values(sim, sample - 1, 60000) - produced;
+    double seconds = (produced - t0) / 1e9;
+
+    hmi_stats_t st;
+    hmi_get_stats(&hmi, &st);
+    hmi_sim_stats_t ss;
+    hmi_sim_get_stats(sim, &ss);
+
+    char label[40];
+    snprintf(label, sizeof(label), "%s_%u", coalesce ? "coalesce" : "async", bps);
+    bench_record("coalesce", label, "samples_per_s", (sample - 1) / seconds, "sample/s");
+    bench_record("coalesce", label, "display_lag", lag / 1e6, "ms");
+    bench_record("coalesce", label, "queue_peak", st.queue_peak, "byte");
+    bench_record("coalesce", label, "sent_updates", ss.updates, "count");
+    bench_record("coalesce", label, "coalesced", st.coalesced, "count");
+    printf("%8u %-8s 採樣=%5.0f/s 顯示延遲=%8.1fms 佇列峰值=%7llu字節 發出=%7llu 合併=%8llu\n",
+           bps, coalesce ? "合併" : "異步", (sample - 1) / seconds, lag / 1e6,
+           (unsigned long long)st.queue_peak, (unsigned long long)ss.updates, (unsigned long long)st.coalesced);
+
+    saved = quiet_begin();
+    hmi_close(&hmi);
+    quiet_end(saved);
+    hmi_sim_destroy(sim);
+}
+
+static int bench_coalesce(void) {
+    printf("\n=== 合併發送（每毫秒採樣 %d 個控件） ===\n", COALESCE_CONTROLS);
+
+    const baud_rate_t rates[] = {BAUD_115200, BAUD_1M};
+    int ms = bench_iterations < 1000 ? 1000 : bench_iterations;
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        run_coalesce(rates[r], 0, ms);
+        run_coalesce(rates[r], 1, ms);
+    }
+    return 0;
+}
+
+// ============================================================================
+// 發送優先級：繪圖佔滿線路時告警文本的端到端延遲
+// ============================================================================
+
+#define PRIO_ALARMS 20
+
+typedef struct {
+    hmi_controller_t *hmi;
+    int prio;
+    volatile int stop;
+} flood_t;
+
+static void *flood_thread(void *arg) {
+    flood_t *f = (flood_t*)arg;
+    hmi_set_priority(f->prio, 0);
+    for (uint32_t i = 0; !f->stop; i++) {
+        hmi_draw_line(f->hmi, 0, i & 255, 799, 479 - (i & 255));
+    }
+    return NULL;
+}
+
+// mode: 0 全部同一優先級（先到先發），1 按優先級，2 按優先級並限制在途 10ms
+static void run_prio(int mode, int alarms) {
+    static const char *mode_names[] = { "fifo", "prio", "prio_inflight" };
+    hmi_sim_t *sim = hmi_sim_create(115200);
+    if (!sim || hmi_sim_start(sim) < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+    hmi_controller_t hmi;
+    int saved = quiet_begin();
+    int ret = hmi_init(&hmi, hmi_sim_path(sim), BAUD_115200);
+    quiet_end(saved);
+    if (ret < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+    hmi_async_start(&hmi, 0);
+    if (mode == 2) {
+        hmi_async_schedule(&hmi, 0, 10);
+    }
+
+    flood_t flood = { &hmi, mode == 0 ? HMI_PRIO_NORMAL : HMI_PRIO_BACKGROUND, 0 };
+    pthread_t tid;
+    pthread_create(&tid, NULL, flood_thread, &flood);
+    usleep(200000);  // 讓佇列和驅動緩衝區先積滿
+
+    uint64_t *samples = malloc(sizeof(uint64_t) * alarms);
+    int n = 0;
+    hmi_set_priority(mode == 0 ? HMI_PRIO_NORMAL : HMI_PRIO_URGENT, 0);
+    for (int i = 0; i < alarms; i++) {
+        char text[16], shown[HMI_FRAME_MAX];
+        uint16_t length;
+        snprintf(text, sizeof(text), "ALARM %d", i);
+
+        uint64_t t0 = hmi_time_ns();
+        hmi_update_text(&hmi, 1, 99, text);
+        uint64_t deadline = t0 + 5000000000ULL;
+        while (hmi_time_ns() < deadline) {
+            if (hmi_sim_get_control(sim, 1, 99, (uint8_t*)shown, &length) == 0 && length == strlen(text) &&
+                memcmp(shown, text, length) == 0) {
+                samples[n++] = hmi_time_ns() - t0;
+                break;
+            }
+            usleep(200);
+        }
+        usleep(20000);
+    }
+    hmi_set_priority(HMI_PRIO_AUTO, 0);
+    flood.stop = 1;
+    pthread_join(tid, NULL);
+
+    hmi_stats_t st;
+    hmi_get_stats(&hmi, &st);
+    char label[40];
+    snprintf(label, sizeof(label), "alarm_%s", mode_names[mode]);
+    if (n > 0) {
+        record_latency("prio", label, samples, n);
+    }
+    bench_record("prio", label, "lost", alarms - n, "count");
+    bench_record("prio", label, "background_share", 100.0 * st.prio_frames[HMI_PRIO_BACKGROUND] /
+                 (st.prio_frames[0] + st.prio_frames[1] + st.prio_frames[2] + 1), "%");
+    // 告警全部走 NORMAL 時緊急佇列沒有樣本
+    uint64_t urgent = 0;
+    for (int i = 0; i < HMI_HIST_BUCKETS; i++) {
+        urgent += st.queue_hist[HMI_PRIO_URGENT][i];
+    }
+    char queued[24] = "n/a";
+    if (urgent > 0) {
+        snprintf(queued, sizeof(queued), "<%uus", hmi_hist_percentile_us(st.queue_hist[HMI_PRIO_URGENT], 990));
+    }
+    printf("%-14s 告警=%d/%d p50=%8.1fms p99=%8.1fms 最大=%8.1fms 緊急排隊p99=%s\n", mode_names[mode], n, alarms,
+           n ? percentile(samples, n, 500) / 1e6 : 0, n ? percentile(samples, n, 990) / 1e6 : 0,
+           n ? samples[n - 1] / 1e6 : 0, queued);
+    free(samples);
+
+    saved = quiet_begin();
+    hmi_close(&hmi);
+    quiet_end(saved);
+    hmi_sim_destroy(sim);
+}
+
+static int bench_prio(void) {
+    printf("\n=== 發送優先級（115200，繪圖佔滿線路時更新告警文本） ===\n");
+    // 先到先發時每個告警要排隊數秒，告警數固定，不隨 -n 增加
+    for (int mode = 0; mode < 3; mode++) {
+        run_prio(mode, PRIO_ALARMS);
+    }
+    return 0;
+}
+
+// ============================================================================
+// 曲線：逐段畫線與曲線控件批量數據的線路開銷，以及抽取的吞吐量
+// ============================================================================
+
+#define CURVE_WIDTH   400        // 曲線區域寬度（像素）
+#define CURVE_SAMPLES 10000      // 每次重畫的採樣數（10kHz 採樣一秒）
+#define CURVE_REDRAWS 5
+
+// 帶噪聲的三角波（48～239），每 997 個採樣有一個 255 的單點尖峰，返回尖峰數
+static uint32_t curve_signal(uint8_t *samples, uint32_t count, uint32_t seed) {
+    uint32_t spikes = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t phase = (i + seed) % 2000;
+        uint32_t noise = (i * 2654435761u + seed) >> 27;
+        samples[i] = (uint8_t)(48 + (phase < 1000 ? phase : 2000 - phase) * 160 / 1000 + noise);
+        if ((i + seed) % 997 == 0) {
+            samples[i] = 255;
+            spikes++;
+        }
+    }
+    return spikes;
+}
+
+// 逐字節比較的抽取，作為對照組
+static void decimate_scalar(const uint8_t *samples, uint32_t count, uint32_t buckets, uint8_t *points) {
+    for (uint32_t b = 0; b < buckets; b++) {
+        uint32_t start = (uint32_t)((uint64_t)b * count / buckets);
+        uint32_t end = (uint32_t)((uint64_t)(b + 1) * count / buckets);
+        uint8_t lo = 255, hi = 0;
+        for (uint32_t i = start; i < end; i++) {
+            lo = samples[i] < lo ? samples[i] : lo;
+            hi = samples[i] > hi ? samples[i] : hi;
+        }
+        points[2 * b] = lo;
+        points[2 * b + 1] = hi;
+    }
+}
+
+static void run_decimate(uint32_t count, uint32_t buckets) {
+    uint8_t *samples = malloc(count);
+    uint8_t *points = malloc(buckets * 2);
+    curve_signal(samples, count, 0);
+
+    uint32_t rounds = bench_iterations / 10 < 10 ? 10 : bench_iterations / 10;
+    uint64_t best[2] = { UINT64_MAX, UINT64_MAX };
+    for (int impl = 0; impl < 2; impl++) {
+        for (int round = 0; round < 3; round++) {
+            uint64_t t0 = hmi_time_ns();
+            for (uint32_t r = 0; r < rounds; r++) {
+                if (impl == 0) {
+                    decimate_scalar(samples, count, buckets, points);
+                } else {
+                    hmi_curve_decimate(samples, count, buckets, points);
+                }
+                __asm__ volatile("" : : "r"(points) : "memory");
+            }
+            uint64_t elapsed = hmi_time_ns() - t0;
+            best[impl] = elapsed < best[impl] ? elapsed : best[impl];
+        }
+    }
+
+    double scalar = (double)count * rounds / best[0] * 1e3;   // 百萬採樣/秒
+    double vector = (double)count * rounds / best[1] * 1e3;
+    char label[40];
+    snprintf(label, sizeof(label), "decimate_%u", count / buckets);
+    bench_record("curve", label, "scalar", scalar, "Msample/s");
+    bench_record("curve", label, "library", vector, "Msample/s");
+    printf("抽取 每桶%5u採樣 逐字節=%8.0f M採樣/s 庫=%8.0f M採樣/s (%.1fx)\n", count / buckets, scalar, vector,
+           vector / scalar);
+    free(samples);
+    free(points);
+}
+
+// 等待模擬器收完 frames 個幀，返回等待結束的時間
+static uint64_t wait_sim_frames(hmi_sim_t *sim, uint64_t frames, int timeout_ms) {
+    uint64_t deadline = hmi_time_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    hmi_sim_stats_t stats;
+
+    for (;;) {
+        hmi_sim_get_stats(sim, &stats);
+        uint64_t now = hmi_time_ns();
+        if (stats.frames_rx >= frames || now > deadline) {
+            return now;
+        }
+        usleep(200);
+    }
+}
+
+// mode: 0 每個像素列取一個採樣逐段畫線，1 曲線控件（最小值/最大值抽取）
+static void run_curve(int mode) {
+    static const char *mode_names[] = { "draw_line", "curve_stream" };
+    hmi_sim_t *sim = hmi_sim_create(115200);
+    if (!sim || hmi_sim_start(sim) < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+    hmi_controller_t hmi;
+    int saved = quiet_begin();
+    int ret = hmi_init(&hmi, hmi_sim_path(sim), BAUD_115200);
+    quiet_end(saved);
+    if (ret < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+
+    uint8_t *samples = malloc(CURVE_SAMPLES);
+    uint64_t *samples_ns = malloc(sizeof(uint64_t) * CURVE_REDRAWS);
+    hmi_sim_stats_t before, after, now;
+    hmi_sim_get_stats(sim, &before);
+    uint32_t spikes = 0, shown = 0;
+
+    for (int r = 0; r < CURVE_REDRAWS; r++) {
+        spikes += curve_signal(samples, CURVE_SAMPLES, r * 131);
+        hmi_sim_get_stats(sim, &now);
+        uint64_t t0 = hmi_time_ns();
+        if (mode == 0) {
+            uint32_t step = CURVE_SAMPLES / CURVE_WIDTH;
+            hmi_begin_batch(&hmi);
+            hmi_draw_rectangle(&hmi, 0, 0, CURVE_WIDTH - 1, 255, 1);
+            for (uint32_t x = 1; x < CURVE_WIDTH; x++) {
+                hmi_draw_line(&hmi, x - 1, 255 - samples[(x - 1) * step], x, 255 - samples[x * step]);
+            }
+            for (uint32_t x = 0; x < CURVE_WIDTH; x++) {
+                shown += samples[x * step] == 255;
+            }
+            hmi_flush(&hmi);
+            samples_ns[r] = wait_sim_frames(sim, now.frames_rx + CURVE_WIDTH, 10000) - t0;
+        } else {
+            uint8_t points[CURVE_WIDTH];
+            uint32_t n = hmi_curve_decimate(samples, CURVE_SAMPLES, CURVE_WIDTH / 2, points);
+            for (uint32_t i = 0; i < n; i++) {
+                shown += points[i] == 255;
+            }
+            hmi_curve_clear(&hmi, 1, 1, 0);
+            hmi_curve_stream(&hmi, 1, 1, 0, samples, CURVE_SAMPLES, CURVE_WIDTH);
+            samples_ns[r] = wait_sim_frames(sim, now.frames_rx + 2, 10000) - t0;
+        }
+    }
+    hmi_sim_get_stats(sim, &after);
+
+    uint64_t bytes = (after.bytes_rx - before.bytes_rx) / CURVE_REDRAWS;
+    qsort(samples_ns, CURVE_REDRAWS, sizeof(uint64_t), cmp_u64);
+    double ms = samples_ns[CURVE_REDRAWS / 2] / 1e6;
+    bench_record("curve", mode_names[mode], "bytes_per_redraw", bytes, "byte");
+    bench_record("curve", mode_names[mode], "redraw", ms, "ms");
+    bench_record("curve", mode_names[mode], "spikes_kept", 100.0 * shown / spikes, "%");
+    printf("%-13s 每次重畫 %6llu字節 %7.1fms（115200） 尖峰保留 %u/%u\n", mode_names[mode],
+           (unsigned long long)bytes, ms, shown, spikes);
+    free(samples);
+    free(samples_ns);
+
+    saved = quiet_begin();
+    hmi_close(&hmi);
+    quiet_end(saved);
+    hmi_sim_destroy(sim);
+}
+
+static int bench_curve(void) {
+    printf("\n=== 曲線（%d 採樣畫到 %d 像素寬） ===\n", CURVE_SAMPLES, CURVE_WIDTH);
+    run_decimate(1000000, 400);
+    run_decimate(1000000, 50000);
+    run_curve(0);
+    run_curve(1);
+    return 0;
+}
+
+// ============================================================================
+// 記錄控件：逐行追加與批量追加 500 行告警，以及流式導出
+// ============================================================================
+
+#define RECORD_ROWS 500
+
+static void record_row(uint16_t index, const char *row, uint16_t length, void *user) {
+    (void)index;
+    (void)row;
+    *(uint64_t*)user += length;
+}
+
+// 等待模擬器的記錄控件達到 rows 行，返回等待結束的時間
+static uint64_t wait_sim_records(hmi_sim_t *sim, uint16_t control_id, int rows, int timeout_ms) {
+    uint64_t deadline = hmi_time_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    for (;;) {
+        uint64_t now = hmi_time_ns();
+        if (hmi_sim_record_count(sim, 1, control_id) >= rows || now > deadline) {
+            return now;
+        }
+        usleep(500);
+    }
+}
+
+static int bench_records(void) {
+    printf("\n=== 記錄控件（115200，%d 行告警） ===\n", RECORD_ROWS);
+
+    hmi_sim_t *sim = hmi_sim_create(115200);
+    if (!sim || hmi_sim_start(sim) < 0) {
+        hmi_sim_destroy(sim);
+        return -1;
+    }
+    hmi_controller_t hmi;
+    int saved = quiet_begin();
+    int ret = hmi_init(&hmi, hmi_sim_path(sim), BAUD_115200);
+    quiet_end(saved);
+    if (ret < 0) {
+        hmi_sim_destroy(sim);
+        return -1;
+    }
+
+    static char text[RECORD_ROWS][48];
+    const char *rows[RECORD_ROWS];
+    for (int i = 0; i < RECORD_ROWS; i++) {
+        snprintf(text[i], sizeof(text[i]), "2024-05-01 08:%02d:%02d;ALARM-%03d;TEMP HIGH", i / 60 % 60, i % 60, i);
+        rows[i] = text[i];
+    }
+
+    for (int batched = 0; batched < 2; batched++) {
+        const char *name = batched ? "add_rows" : "add";
+        uint16_t control_id = 10 + batched;
+        hmi_sim_stats_t before, after;
+        hmi_sim_get_stats(sim, &before);
+        uint64_t t0 = hmi_time_ns();
+        if (batched) {
+            hmi_record_add_rows(&hmi, 1, control_id, rows, RECORD_ROWS);
+        } else {
+            for (int i = 0; i < RECORD_ROWS; i++) {
+                hmi_record_add(&hmi, 1, control_id, rows[i]);
+            }
+        }
+        uint64_t elapsed = wait_sim_records(sim, control_id, RECORD_ROWS, 30000) - t0;
+        hmi_sim_get_stats(sim, &after);
+
+        uint64_t frames = after.frames_rx - before.frames_rx;
+        uint64_t bytes = after.bytes_rx - before.bytes_rx;
+        bench_record("record", name, "time", elapsed / 1e6, "ms");
+        bench_record("record", name, "frames", frames, "frame");
+        bench_record("record", name, "bytes", bytes, "byte");
+        printf("%-9s %4d行 %8.1fms 幀=%4llu 字節=%6llu\n", name, hmi_sim_record_count(sim, 1, control_id),
+               elapsed / 1e6, (unsigned long long)frames, (unsigned long long)bytes);
+    }
+
+    uint64_t row_bytes = 0;
+    uint64_t t0 = hmi_time_ns();
+    int exported = hmi_record_export(&hmi, 1, 11, 0, RECORD_ROWS, record_row, &row_bytes, 1000);
+    double ms = (hmi_time_ns() - t0) / 1e6;
+    bench_record("record", "export", "time", ms, "ms");
+    bench_record("record", "export", "rows", exported, "count");
+    printf("%-9s %4d行 %8.1fms 數據=%6llu字節\n", "export", exported, ms, (unsigned long long)row_bytes);
+
+    saved = quiet_begin();
+    hmi_close(&hmi);
+    quiet_end(saved);
+    hmi_sim_destroy(sim);
+    return 0;
+}
+
+// ============================================================================
+// 圖片：RGB888/RGBA8888 → RGB565 轉換速度，以及區域上傳
+// ============================================================================
+
+#define IMAGE_WIDTH  320
+#define IMAGE_HEIGHT 240
+#define UPLOAD_WIDTH  160
+#define UPLOAD_HEIGHT 120
+
+// 逐像素以 hmi_rgb 轉換，作為對照組
+static void rgb565_scalar(uint8_t *dst, const uint8_t *src, uint32_t pixels, int bpp) {
+    for (uint32_t i = 0; i < pixels; i++, src += bpp) {
+        uint16_t color = hmi_rgb(src[0], src[1], src[2]);
+        dst[2 * i] = color >> 8;
+        dst[2 * i + 1] = color & 0xFF;
+    }
+}
+
+static void run_convert(int format) {
+    uint32_t pixels = IMAGE_WIDTH * IMAGE_HEIGHT;
+    uint8_t *src = malloc((size_t)pixels * format);
+    uint8_t *dst = malloc((size_t)pixels * 2);
+    for (uint32_t i = 0; i < pixels * format; i++) {
+        src[i] = (uint8_t)(i * 2654435761u >> 24);
+    }
+
+    uint32_t rounds = bench_iterations / 100 < 10 ? 10 : bench_iterations / 100;
+    uint64_t best[2] = { UINT64_MAX, UINT64_MAX };
+    for (int impl = 0; impl < 2; impl++) {
+        for (int round = 0; round < 3; round++) {
+            uint64_t t0 = hmi_time_ns();
+            for (uint32_t r = 0; r < rounds; r++) {
+                if (impl == 0) {
+                    rgb565_scalar(dst, src, pixels, format);
+                } else {
+                    hmi_rgb565_convert(dst, src, pixels, format);
+                }
+                __asm__ volatile("" : : "r"(dst) : "memory");
+            }
+            uint64_t elapsed = hmi_time_ns() - t0;
+            best[impl] = elapsed < best[impl] ? elapsed : best[impl];
+        }
+    }
+
+    const char *name = format == HMI_PIXEL_RGB888 ? "rgb888" : "rgba8888";
+    double scalar = (double)pixels * rounds / best[0] * 1e3;   // 百萬像素/秒
+    double vector = (double)pixels * rounds / best[1] * 1e3;
+    bench_record("image", name, "scalar", scalar, "Mpixel/s");
+    bench_record("image", name, "library", vector, "Mpixel/s");
+    printf("轉換 %-8s 逐像素=%8.0f M像素/s 庫(%s)=%8.0f M像素/s (%.1fx)\n", name, scalar, hmi_rgb565_kernel(),
+           vector, vector / scalar);
+    free(src);
+    free(dst);
+}
+
+static void run_upload(void) {
+    hmi_sim_t *sim = hmi_sim_create(hmi_baud_to_bps(BAUD_1M));
+    if (!sim || hmi_sim_start(sim) < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+    hmi_controller_t hmi;
+    int saved = quiet_begin();
+    int ret = hmi_init(&hmi, hmi_sim_path(sim), BAUD_1M);
+    quiet_end(saved);
+    if (ret < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+
+    uint32_t pixels = UPLOAD_WIDTH * UPLOAD_HEIGHT;
+    uint8_t *src = malloc((size_t)pixels * HMI_PIXEL_RGB888);
+    for (uint32_t i = 0; i < pixels * HMI_PIXEL_RGB888; i++) {
+        src[i] = (uint8_t)(i * 2654435761u >> 24);
+    }
+
+    hmi_sim_stats_t before, after;
+    hmi_sim_get_stats(sim, &before);
+    uint64_t t0 = hmi_time_ns();
+    hmi_draw_image(&hmi, 0, 0, UPLOAD_WIDTH, UPLOAD_HEIGHT, src, 0, HMI_PIXEL_RGB888);
+    uint64_t deadline = t0 + 10000000000ULL;
+    do {
+        usleep(500);
+        hmi_sim_get_stats(sim, &after);
+    } while (after.image_pixels - before.image_pixels < pixels && hmi_time_ns() < deadline);
+    double ms = (hmi_time_ns() - t0) / 1e6;
+
+    uint64_t frames = after.frames_rx - before.frames_rx;
+    uint64_t bytes = after.bytes_rx - before.bytes_rx;
+    double wire_ms = bytes * 10.0 / hmi_baud_to_bps(BAUD_1M) * 1e3;
+    bench_record("image", "upload", "time", ms, "ms");
+    bench_record("image", "upload", "frames", frames, "frame");
+    bench_record("image", "upload", "link_usage", 100.0 * wire_ms / ms, "%");
+    printf("上傳 %dx%d 像素=%llu %8.1fms 幀=%llu 字節=%llu 線路佔用 %.0f%%\n", UPLOAD_WIDTH, UPLOAD_HEIGHT,
+           (unsigned long long)(after.image_pixels - before.image_pixels), ms, (unsigned long long)frames,
+           (unsigned long long)bytes, 100.0 * wire_ms / ms);
+    free(src);
+
+    saved = quiet_begin();
+    hmi_close(&hmi);
+    quiet_end(saved);
+    hmi_sim_destroy(sim);
+}
+
+static int bench_image(void) {
+    printf("\n=== 圖片（%dx%d 轉換，%dx%d 上傳，1M） ===\n", IMAGE_WIDTH, IMAGE_HEIGHT, UPLOAD_WIDTH,
+           UPLOAD_HEIGHT);
+    run_convert(HMI_PIXEL_RGB888);
+    run_convert(HMI_PIXEL_RGBA8888);
+    run_upload();
+    return 0;
+}
+
+// ============================================================================
+// 幀緩衝：儀表畫面每幀只有指針和讀數變化，整幅重發與差分上傳對比
+// ============================================================================
+
+#define FB_WIDTH   320
+#define FB_HEIGHT  240
+#define FB_FRAMES  10
+
+// 漸變背景上畫一個隨幀移動的 8x48 指針和一個 48x16 的讀數框
+static void fb_render(uint8_t *rgb, int frame) {
+    for (int y = 0; y < FB_HEIGHT; y++) {
+        for (int x = 0; x < FB_WIDTH; x++) {
+            uint8_t *p = rgb + (y * FB_WIDTH + x) * 3;
+            p[0] = (uint8_t)x;
+            p[1] = (uint8_t)y;
+            p[2] = 96;
+        }
+    }
+    int nx = 40 + frame * 24;
+    for (int y = 96; y < 144; y++) {
+        memset(rgb + (y * FB_WIDTH + nx) * 3, 255, 8 * 3);
+    }
+    for (int y = 200; y < 216; y++) {
+        for (int x = 136; x < 184; x++) {
+            uint8_t *p = rgb + (y * FB_WIDTH + x) * 3;
+            p[0] = p[1] = p[2] = (uint8_t)((x + frame * 7) * 37);
+        }
+    }
+}
+
+// mode: 0 每幀整幅 hmi_draw_image，1 hmi_fb_present
+static void run_fb(int mode) {
+    static const char *mode_names[] = { "full", "diff" };
+    hmi_sim_t *sim = hmi_sim_create(hmi_baud_to_bps(BAUD_1M));
+    if (!sim || hmi_sim_start(sim) < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+    hmi_controller_t hmi;
+    int saved = quiet_begin();
+    int ret = hmi_init(&hmi, hmi_sim_path(sim), BAUD_1M);
+    quiet_end(saved);
+    if (ret < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+
+    uint8_t *rgb = malloc(FB_WIDTH * FB_HEIGHT * 3);
+    hmi_fb_t *fb = hmi_fb_create(0, 0, FB_WIDTH, FB_HEIGHT);
+    fb_render(rgb, 0);
+    hmi_fb_present(&hmi, fb, rgb, 0, HMI_PIXEL_RGB888);   // 第一幀整幅發送，不計入
+
+    hmi_sim_stats_t before, after;
+    hmi_sim_get_stats(sim, &before);
+    uint64_t expected = before.image_pixels;
+    uint64_t t0 = hmi_time_ns();
+    for (int f = 1; f <= FB_FRAMES; f++) {
+        fb_render(rgb, f);
+        if (mode == 0) {
+            hmi_draw_image(&hmi, 0, 0, FB_WIDTH, FB_HEIGHT, rgb, 0, HMI_PIXEL_RGB888);
+            expected += FB_WIDTH * FB_HEIGHT;
+        } else {
+            expected += hmi_fb_present(&hmi, fb, rgb, 0, HMI_PIXEL_RGB888);
+        }
+    }
+    uint64_t deadline = hmi_time_ns() + 30000000000ULL;
+    do {
+        usleep(500);
+        hmi_sim_get_stats(sim, &after);
+    } while (after.image_pixels < expected && hmi_time_ns() < deadline);
+    double ms = (hmi_time_ns() - t0) / 1e6 / FB_FRAMES;
+    uint64_t bytes = (after.bytes_rx - before.bytes_rx) / FB_FRAMES;
+
+    bench_record("fb", mode_names[mode], "bytes_per_frame", bytes, "byte");
+    bench_record("fb", mode_names[mode], "frame", ms, "ms");
+    printf("%-5s 每幀 %7llu字節 %8.1fms（1M）\n", mode_names[mode], (unsigned long long)bytes, ms);
+
+    // 沒有變化時 present 只做轉換和比較，量度主機端開銷
+    if (mode == 1) {
+        uint32_t rounds = bench_iterations / 100 < 10 ? 10 : bench_iterations / 100;
+        uint64_t t1 = hmi_time_ns();
+        for (uint32_t r = 0; r < rounds; r++) {
+            hmi_fb_present(&hmi, fb, rgb, 0, HMI_PIXEL_RGB888);
+        }
+        double us = (hmi_time_ns() - t1) / 1e3 / rounds;
+        bench_record("fb", "compare", "present", us, "us");
+        printf("%-5s 無變化時每次 present %.1fus（%dx%d 轉換和比較）\n", "idle", us, FB_WIDTH, FB_HEIGHT);
+    }
+    hmi_fb_destroy(fb);
+    free(rgb);
+
+    saved = quiet_begin();
+    hmi_close(&hmi);
+    quiet_end(saved);
+    hmi_sim_destroy(sim);
+}
+
+static int bench_fb(void) {
+    printf("\n=== 幀緩衝（%dx%d 儀表，%d 幀） ===\n", FB_WIDTH, FB_HEIGHT, FB_FRAMES);
+    run_fb(0);
+    run_fb(1);
+    return 0;
+}
+
+// ============================================================================
+// 繪圖錄製
+// ============================================================================
+
+#define DRAW_ROUNDS  5
+
+// 典型的圖表頁面：佔位標記被面板背景蓋住、網格逐格畫線、刻度逐點畫、
+// 兩條曲線交替設置顏色逐段畫出、每個元素各自設置顏色
+static void draw_chart(hmi_controller_t *hmi, int round) {
+    hmi_set_colors(hmi, COLOR_WHITE, COLOR_BLACK);
+    hmi_clean_screen(hmi);
+    for (int i = 0; i < 8; i++) {
+        hmi_set_fg_color(hmi, COLOR_MAGENTA);
+        hmi_draw_rectangle(hmi, 30 + i * 50, 60, 60 + i * 50, 90, 0);
+    }
+    hmi_set_fg_color(hmi, COLOR_BLUE);
+    hmi_draw_rectangle(hmi, 20, 20, 460, 260, 1);
+
+    for (int y = 40; y <= 240; y += 20) {
+        for (int x = 40; x < 440; x += 20) {
+            hmi_set_fg_color(hmi, COLOR_CYAN);
+            hmi_draw_line(hmi, x, y, x + 20, y);
+        }
+    }
+    for (int x = 40; x <= 440; x += 40) {
+        for (int y = 40; y < 240; y += 20) {
+            hmi_set_fg_color(hmi, COLOR_CYAN);
+            hmi_draw_line(hmi, x, y, x, y + 20);
+        }
+    }
+    hmi_set_fg_color(hmi, COLOR_WHITE);
+    for (int x = 40; x <= 440; x++) {
+        hmi_draw_point(hmi, x, 250);
+        if (x % 10 == 0) {
+            hmi_draw_point(hmi, x, 251);
+            hmi_draw_point(hmi, x, 252);
+        }
+    }
+
+    // 上半部溫度、下半部壓力，兩條曲線互不重疊
+    int ta = 80, pa = 200;
+    for (int x = 40; x < 440; x += 8) {
+        int tb = 80 + ((x * 7 + round * 13) % 60) - 30;
+        int pb = 200 + ((x * 11 + round * 5) % 60) - 30;
+        hmi_set_fg_color(hmi, COLOR_RED);
+        hmi_draw_line(hmi, x, ta, x + 8, tb);
+        hmi_set_fg_color(hmi, COLOR_GREEN);
+        hmi_draw_line(hmi, x, pa, x + 8, pb);
+        ta = tb;
+        pa = pb;
+    }
+    hmi_set_fg_color(hmi, COLOR_YELLOW);
+    hmi_display_text(hmi, 30, 24, 0, FONT_ASCII_8X16, "Temperature / Pressure");
+}
+
+static uint64_t tx_frames(hmi_controller_t *hmi) {
+    hmi_stats_t stats;
+    uint64_t frames = 0;
+    if (hmi_get_stats(hmi, &stats) == 0) {
+        for (int i = 0; i < 256; i++) {
+            frames += stats.tx[i].frames + stats.tx_config[i].frames;
+        }
+    }
+    return frames;
+}
+
+// mode: 0 逐條發送，1 錄製後優化發送
+static void run_draw(int mode) {
+    static const char *mode_names[] = { "direct", "list" };
+    hmi_sim_t *sim = hmi_sim_create(hmi_baud_to_bps(BAUD_115200));
+    if (!sim || hmi_sim_start(sim) < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+    hmi_controller_t hmi;
+    int saved = quiet_begin();
+    int ret = hmi_init(&hmi, hmi_sim_path(sim), BAUD_115200);
+    quiet_end(saved);
+    if (ret < 0) {
+        hmi_sim_destroy(sim);
+        return;
+    }
+
+    hmi_sim_stats_t before, after;
+    hmi_sim_get_stats(sim, &before);
+    uint64_t sent = tx_frames(&hmi);
+    uint64_t host_ns = 0;
+    uint64_t t0 = hmi_time_ns();
+    for (int r = 0; r < DRAW_ROUNDS; r++) {
+        if (mode == 0) {
+            draw_chart(&hmi, r);
+        } else {
+            uint64_t t1 = hmi_time_ns();
+            hmi_begin_drawing(&hmi);
+            draw_chart(&hmi, r);
+            host_ns += hmi_time_ns() - t1;
+            hmi_end_drawing(&hmi);
+        }
+    }
+    uint64_t expected = before.frames_rx + tx_frames(&hmi) - sent;
+    uint64_t deadline = hmi_time_ns() + 30000000000ULL;
+    do {
+        usleep(500);
+        hmi_sim_get_stats(sim, &after);
+    } while (after.frames_rx < expected && hmi_time_ns() < deadline);
+    double ms = (hmi_time_ns() - t0) / 1e6 / DRAW_ROUNDS;
+    uint64_t bytes = (after.bytes_rx - before.bytes_rx) / DRAW_ROUNDS;
+    uint64_t frames = (after.frames_rx - before.frames_rx) / DRAW_ROUNDS;
+
+    bench_record("draw", mode_names[mode], "bytes_per_scene", bytes, "byte");
+    bench_record("draw", mode_names[mode], "frames_per_scene", frames, "frame");
+    bench_record("draw", mode_names[mode], "scene", ms, "ms");
+    printf("%-6s 每頁 %6llu字節 %5llu幀 %7.1fms（115200）", mode_names[mode], (unsigned long long)bytes,
+           (unsigned long long)frames, ms);
+    if (mode == 1) {
+        double us = host_ns / 1e3 / DRAW_ROUNDS;
+        bench_record("draw", mode_names[mode], "record", us, "us");
+        printf("，錄製 %.1fus", us);
+    }
+    printf("\n");
+
+    saved = quiet_begin();
+    hmi_close(&hmi);
+    quiet_end(saved);
+    hmi_sim_destroy(sim);
+}
+
+static int bench_draw(void) {
+    printf("\n=== 繪圖錄製（圖表頁面，%d 頁） ===\n", DRAW_ROUNDS);
+    run_draw(0);
+    run_draw(1);
+    return 0;
+}
+
+// ============================================================================
+// 主函數
+// ============================================================================
+
+static const struct {
+    const char *name;
+    int (*run)(void);
+} bench_suites[] = {
+    { "rx", bench_rx },
+    { "parse", bench_parse },
+    { "cork", bench_cork },
+    { "encode", bench_encode },
+    { "io", bench_io },
+    { "latency", bench_latency },
+    { "mpsc", bench_mpsc },
+    { "manager", bench_manager },
+    { "coalesce", bench_coalesce },
+    { "prio", bench_prio },
+    { "curve", bench_curve },
+    { "record", bench_records },
+    { "image", bench_image },
+    { "fb", bench_fb },
+    { "draw", bench_draw },
+};
+
+#define BENCH_SUITE_COUNT (int)(sizeof(bench_suites) / sizeof(bench_suites[0]))
+
+// 用法: hmi_bench [-n 次數] [-o 結果.csv|結果.json] [測試項...]，不指定測試項時全部運行
+int main(int argc, char *argv[]) {
+    const char *output = NULL;
+    int selected[BENCH_SUITE_COUNT] = {0};
+    int any = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            bench_iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "all") != 0) {
+            int found = 0;
+            for (int s = 0; s < BENCH_SUITE_COUNT; s++) {
+                if (strcmp(argv[i], bench_suites[s].name) == 0) {
+                    selected[s] = found = any = 1;
+                }
+            }
+            if (!found) {
+                printf("未知的測試項: %s\n", argv[i]);
+                return 1;
+            }
+        }
+    }
+    if (bench_iterations <= 0) {
+        bench_iterations = 1000;
+    }
+
+    for (int s = 0; s < BENCH_SUITE_COUNT; s++) {
+        if (!any || selected[s]) {
+            bench_suites[s].run();
+        }
+    }
+
+    if (output && bench_write_results(output) < 0) {
+        free(bench_results);
+        return 1;
+    }
+    free(bench_results);
+    return 0;
+}
@@ -1,5 +1,4 @@
 #include "dc_hmi_controller.h"
-#include <pthread.h>
 #include <signal.h>
 
 // 全局變量
@@ -12,41 +11,30 @@ void signal_handler(int sig) {
     running = 0;
 }
 
-// 觸摸事件處理線程
-void* touch_handler_thread(void *arg) {
-    hmi_controller_t *hmi_dev = (hmi_controller_t*)arg;
-    uint8_t buffer[256];
-    
-    printf("觸摸事件處理線程已啟動\n");
-    
-    while (running) {
-        int n = read(hmi_dev->fd, buffer, sizeof(buffer));
-        if (n > 0) {
-            // 檢查是否是觸摸事件
-            if (n >= 6 && buffer[0] == FRAME_HEADER) {
-                if (buffer[1] == 0x01) { // 觸摸按下
-                    uint16_t x = (buffer[2] << 8) | buffer[3];
-                    uint16_t y = (buffer[4] << 8) | buffer[5];
-                    printf("觸摸按下: (%d, %d)\n", x, y);
-                } else if (buffer[1] == 0x03) { // 觸摸釋放
-                    uint16_t x = (buffer[2] << 8) | buffer[3];
-                    uint16_t y = (buffer[4] << 8) | buffer[5];
-                    printf("觸摸釋放: (%d, %d)\n", x, y);
-                } else if (buffer[1] == CMD_CONFIG_BASE && buffer[2] == 0x11) {
-                    // 控件事件上傳
-                    uint16_t screen_id = (buffer[3] << 8) | buffer[4];
-                    uint16_t control_id = (buffer[5] << 8) | buffer[6];
-                    uint8_t control_type = buffer[7];
-                    printf("控件事件: 畫面=%d, 控件=%d, 類型=0x%02X\n", 
-                           screen_id, control_id, control_type);
-                }
-            }
-        }
-        usleep(10000); // 10ms延遲
+// 觸摸事件回調（在接收線程中執行）
+static void on_touch(hmi_controller_t *hmi_dev, const hmi_response_t *event, void *user) {
+    (void)hmi_dev;
+    (void)user;
+    if (event->length < 4) {
+        return;
     }
-    
-    printf("觸摸事件處理線程已退出\n");
-    return NULL;
+    uint16_t x = (event->data[0] << 8) | event->data[1];
+    uint16_t y = (event->data[2] << 8) | event->data[3];
+    printf("%s: (%d, %d)\n", event->cmd == 0x01 ? "觸摸按下" : "觸摸釋放", x, y);
+}
+
+// 控件事件回調
+static void on_control_event(hmi_controller_t *hmi_dev, const hmi_response_t *event, void *user) {
+    (void)hmi_dev;
+    (void)user;
+    if (event->length < 6) {
+        return;
+    }
+    uint16_t screen_id = (event->data[1] << 8) | event->data[2];
+    uint16_t control_id = (event->data[3] << 8) | event->data[4];
+    uint8_t control_type = event->data[5];
+    printf("控件事件: 畫面=%d, 控件=%d, 類型=0x%02X\n",
+           screen_id, control_id, control_type);
 }
 
 // 演示基本功能
@@ -72,47 +60,75 @@ void demo_basic_functions() {
     hmi_delay_ms(500);
 }
 
-// 演示繪圖功能
-void demo_drawing() {
-    printf("\n=== 繪圖功能演示 ===\n");
-    
+// 已發送的字節數（所有指令）
+static uint64_t tx_bytes(void) {
+    hmi_stats_t stats;
+    uint64_t bytes = 0;
+    if (hmi_get_stats(&hmi, &stats) == 0) {
+        for (int i = 0; i < 256; i++) {
+            bytes += stats.tx[i].bytes + stats.tx_config[i].bytes;
+        }
+    }
+    return bytes;
+}
+
+// 繪圖場景；staged 時逐部分畫出並停頓，否則一口氣畫完（錄製時用）
+static void draw_scene(int staged) {
     // 設置顏色
     hmi_set_colors(&hmi, COLOR_YELLOW, COLOR_BLUE);
     hmi_clean_screen(&hmi);
     
     // 畫點
-    printf("畫點...\n");
+    if (staged) printf("畫點...\n");
     for (int i = 0; i < 100; i += 5) {
         hmi_draw_point(&hmi, 10 + i, 10 + i/2);
     }
-    hmi_delay_ms(1000);
+    if (staged) hmi_delay_ms(1000);
     
     // 畫線
-    printf("畫線...\n");
+    if (staged) printf("畫線...\n");
     hmi_set_fg_color(&hmi, COLOR_RED);
     hmi_draw_line(&hmi, 50, 50, 200, 100);
     hmi_draw_line(&hmi, 50, 100, 200, 50);
-    hmi_delay_ms(1000);
+    if (staged) hmi_delay_ms(1000);
     
     // 畫矩形
-    printf("畫矩形...\n");
+    if (staged) printf("畫矩形...\n");
     hmi_set_fg_color(&hmi, COLOR_GREEN);
     hmi_draw_rectangle(&hmi, 220, 30, 350, 120, 0); // 空心
     hmi_draw_rectangle(&hmi, 230, 40, 340, 110, 1); // 實心
-    hmi_delay_ms(1000);
+    if (staged) hmi_delay_ms(1000);
     
     // 畫圓
-    printf("畫圓...\n");
+    if (staged) printf("畫圓...\n");
     hmi_set_fg_color(&hmi, COLOR_CYAN);
     hmi_draw_circle(&hmi, 400, 75, 40, 0); // 空心
     hmi_draw_circle(&hmi, 400, 75, 20, 1); // 實心
-    hmi_delay_ms(1000);
+    if (staged) hmi_delay_ms(1000);
     
     // 顯示文字
-    printf("顯示文字...\n");
+    if (staged) printf("顯示文字...\n");
     hmi_set_fg_color(&hmi, COLOR_WHITE);
     hmi_display_text(&hmi, 50, 150, 1, FONT_GBK_16X16, "大彩串口屏測試程式");
     hmi_display_text(&hmi, 50, 180, 0, FONT_ASCII_12X24, "HMI Controller Demo");
+    if (staged) hmi_delay_ms(2000);
+}
+
+// 演示繪圖功能：先逐條發送，再錄製到顯示列表優化後一次發出，對比發送的字節數
+void demo_drawing() {
+    printf("\n=== 繪圖功能演示 ===\n");
+    
+    uint64_t start = tx_bytes();
+    draw_scene(1);
+    uint64_t direct = tx_bytes() - start;
+    
+    printf("以顯示列表重畫...\n");
+    start = tx_bytes();
+    hmi_begin_drawing(&hmi);
+    draw_scene(0);
+    hmi_end_drawing(&hmi);
+    uint64_t listed = tx_bytes() - start;
+    printf("逐條發送 %llu 字節，顯示列表 %llu 字節\n", (unsigned long long)direct, (unsigned long long)listed);
     hmi_delay_ms(2000);
 }
 
@@ -242,23 +258,22 @@ void setup_touch() {
 int main(int argc, char *argv[]) {
     char *device = "/dev/ttyUSB0"; // 默認設備
     baud_rate_t baudrate = BAUD_115200;
+    const char *capture = NULL;       // 抓包文件，可用 hmi_replay 重放
     
     // 處理命令行參數
     if (argc > 1) {
         device = argv[1];
     }
     if (argc > 2) {
-        int baud = atoi(argv[2]);
-        switch (baud) {
-            case 9600: baudrate = BAUD_9600; break;
-            case 19200: baudrate = BAUD_19200; break;
-            case 38400: baudrate = BAUD_38400; break;
-            case 57600: baudrate = BAUD_57600; break;
-            case 115200: baudrate = BAUD_115200; break;
-            default: 
-                printf("不支持的波特率: %d\n", baud);
-                return -1;
+        int baud = hmi_bps_to_baud(atoi(argv[2]));
+        if (baud < 0) {
+            printf("不支持的波特率: %s\n", argv[2]);
+            return -1;
         }
+        baudrate = baud;
+    }
+    if (argc > 3) {
+        capture = argv[3];
     }
     
     // 註冊信號處理
@@ -266,14 +281,12 @@ int main(int argc, char *argv[]) {
     signal(SIGTERM, signal_handler);
     
     printf("大彩串口屏控制演示程式\n");
-    printf("設備: %s, 波特率: %d\n", device, 
-           baudrate == BAUD_9600 ? 9600 :
-           baudrate == BAUD_19200 ? 19200 :
-           baudrate == BAUD_38400 ? 38400 :
-           baudrate == BAUD_57600 ? 57600 : 115200);
-    
-    // 初始化串口屏
-    if (hmi_init(&hmi, device, baudrate) < 0) {
+    printf("設備: %s, 波特率: %u\n", device, hmi_baud_to_bps(baudrate));
+    
+    // 初始化串口屏，高於 115200 時先以 115200 連接再協商切換
+    int ret = baudrate > BAUD_115200 ? hmi_init_fast(&hmi, device, BAUD_115200, baudrate)
+                                     : hmi_init(&hmi, device, baudrate);
+    if (ret < 0) {
         printf("初始化串口屏失敗\n");
         return -1;
     }
@@ -287,9 +300,17 @@ int main(int argc, char *argv[]) {
     // 配置觸摸屏
     setup_touch();
     
-    // 創建觸摸事件處理線程
-    pthread_t touch_thread;
-    pthread_create(&touch_thread, NULL, touch_handler_thread, &hmi);
+    // 訂閱觸摸和控件事件，由接收線程分發（讀控件的回應不會被事件回調取走）
+    hmi_subscribe(&hmi, 0x01, -1, -1, -1, on_touch, NULL);          // 觸摸按下
+    hmi_subscribe(&hmi, 0x03, -1, -1, -1, on_touch, NULL);          // 觸摸釋放
+    hmi_subscribe(&hmi, CMD_CONFIG_BASE, 0x11, -1, -1, on_control_event, NULL);
+
+    // 運行統計導出到共享內存，可在另一個終端用 ./hmi_stat /hmi_demo 查看
+    hmi_stats_export(&hmi, "/hmi_demo");
+    if (capture) {
+        hmi_capture_start(&hmi, capture);
+    }
+    hmi_rx_start(&hmi);
     
     // 交互式選單
     while (running) {
@@ -354,7 +375,7 @@ int main(int argc, char *argv[]) {
     // 清理資源
     printf("正在清理資源...\n");
     running = 0;
-    pthread_join(touch_thread, NULL);
+    hmi_rx_stop(&hmi);
     hmi_close(&hmi);
     
     printf("程式已退出\n");
@@ -0,0 +1,364 @@
+#include "dc_hmi_controller.h"
+#include "hmi_sim.h"
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// 抓包重放程式
+// 用法: hmi_replay [-f] [-s 倍速] [-b 波特率] [-S 模擬器波特率] 抓包文件 [設備]
+// 按抓包中的時間間隔（或 -f 盡快）重新發送所有 TX 幀，比較原始記錄與重放的
+// 吞吐量和回應時間。-S 使用內置模擬器，不需要設備：
+//   ./hmi_demo /dev/ttyUSB0 115200 demo.cap
+//   ./hmi_replay -S 115200 demo.cap
+//   ./hmi_replay -f demo.cap /dev/ttyUSB0
+
+#define PENDING_MAX 256
+
+// 請求與回應按鍵值配對：指令、子指令、畫面ID、控件ID，不適用的部分為 0xFFFF
+typedef struct {
+    uint64_t key;
+    uint64_t sent_ns;
+} pending_t;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint64_t responses;
+    uint64_t missing;
+    uint64_t events;             // 沒有對應請求的接收幀
+    uint32_t *rtt_us;
+    uint32_t rtt_count;
+    uint32_t rtt_size;
+    pending_t pending[PENDING_MAX];
+    int pending_count;
+} replay_stats_t;
+
+static pthread_mutex_t replay_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t make_key(uint8_t cmd, int sub, int screen, int control) {
+    return ((uint64_t)cmd << 48) | ((uint64_t)(sub & 0xFFFF) << 32) |
+           ((uint64_t)(screen & 0xFFFF) << 16) | (uint64_t)(control & 0xFFFF);
+}
+
+// 發送幀（含幀頭幀尾）期待的回應，沒有回應的指令返回 0
+static uint64_t request_key(const uint8_t *frame, uint16_t length) {
+    if (length < 2 + FRAME_TAIL_SIZE) {
+        return 0;
+    }
+    const uint8_t *data = frame + 2;
+    uint16_t data_len = length - 2 - FRAME_TAIL_SIZE;
+
+    switch (frame[1]) {
+        case CMD_HANDSHAKE:
+            return make_key(0x55, -1, -1, -1);
+        case CMD_GET_VERSION:
+            return make_key(CMD_GET_VERSION, -1, -1, -1);
+        case CMD_CONFIG_BASE:
+            if (data_len >= 1 && data[0] == CMD_READ_SCREEN) {
+                return make_key(CMD_CONFIG_BASE, CMD_READ_SCREEN, -1, -1);
+            }
+            if (data_len >= 5 && data[0] == CMD_READ_CONTROL) {
+                return make_key(CMD_CONFIG_BASE, CMD_READ_CONTROL, (data[1] << 8) | data[2],
+                                (data[3] << 8) | data[4]);
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static uint64_t response_key(uint8_t cmd, const uint8_t *data, uint16_t length) {
+    if (cmd != CMD_CONFIG_BASE) {
+        return make_key(cmd, -1, -1, -1);
+    }
+    if (length >= 5 && data[0] == CMD_READ_CONTROL) {
+        return make_key(cmd, CMD_READ_CONTROL, (data[1] << 8) | data[2], (data[3] << 8) | data[4]);
+    }
+    return make_key(cmd, length >= 1 ? data[0] : -1, -1, -1);
+}
+
+static void stats_tx(replay_stats_t *st, const uint8_t *frame, uint16_t length, uint64_t now) {
+    if (st->frames == 0) {
+        st->first_ns = now;
+    }
+    st->frames++;
+    st->bytes += length;
+    st->last_ns = now;
+
+    uint64_t key = request_key(frame, length);
+    if (!key) {
+        return;
+    }
+    if (st->pending_count == PENDING_MAX) {
+        // 最早的請求一直沒有回應
+        memmove(st->pending, st->pending + 1, (PENDING_MAX - 1) * sizeof(pending_t));
+        st->pending_count--;
+        st->missing++;
+    }
+    st->pending[st->pending_count].key = key;
+    st->pending[st->pending_count].sent_ns = now;
+    st->pending_count++;
+}
+
+static void stats_rx(replay_stats_t *st, uint8_t cmd, const uint8_t *data, uint16_t length, uint64_t now) {
+    uint64_t key = response_key(cmd, data, length);
+    for (int i = 0; i < st->pending_count; i++) {
+        if (st->pending[i].key != key) {
+            continue;
+        }
+        if (st->rtt_count == st->rtt_size) {
+            uint32_t size = st->rtt_size ? st->rtt_size * 2 : 1024;
+            uint32_t *samples = realloc(st->rtt_us, size * sizeof(uint32_t));
+            if (!samples) {
+                return;
+            }
+            st->rtt_us = samples;
+            st->rtt_size = size;
+        }
+        st->rtt_us[st->rtt_count++] = (uint32_t)((now - st->pending[i].sent_ns) / 1000);
+        st->responses++;
+        if (now > st->last_ns) {
+            st->last_ns = now; // 耗時算到最後一個回應
+        }
+        memmove(st->pending + i, st->pending + i + 1, (st->pending_count - i - 1) * sizeof(pending_t));
+        st->pending_count--;
+        return;
+    }
+    st->events++;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t rtt_percentile(replay_stats_t *st, int per_mille) {
+    if (st->rtt_count == 0) {
+        return 0;
+    }
+    uint32_t index = (uint32_t)(((uint64_t)st->rtt_count * per_mille + 999) / 1000);
+    return st->rtt_us[index ? index - 1 : 0];
+}
+
+// 逐條讀取記錄，返回下一條的位置；TIME 記錄更新 now 後跳過
+typedef struct {
+    const uint8_t *pos;
+    const uint8_t *end;
+    uint64_t now;                // 相對抓包開始的時間（納秒）
+} cap_reader_t;
+
+static int cap_next(cap_reader_t *reader, hmi_cap_record_t *rec, const uint8_t **data) {
+    while (reader->pos + sizeof(hmi_cap_record_t) <= reader->end) {
+        memcpy(rec, reader->pos, sizeof(*rec));
+        if (reader->pos + sizeof(*rec) + rec->length > reader->end) {
+            break; // 文件在記錄中間截斷
+        }
+        *data = reader->pos + sizeof(*rec);
+        reader->pos += sizeof(*rec) + rec->length;
+        reader->now += (uint64_t)rec->delta_us * 1000;
+
+        if (rec->type == HMI_CAP_TIME) {
+            if (rec->length == sizeof(uint64_t)) {
+                memcpy(&reader->now, *data, sizeof(uint64_t));
+            }
+            continue;
+        }
+        return 0;
+    }
+    return -1;
+}
+
+static void replay_event(hmi_controller_t *hmi, const hmi_response_t *frame, void *user) {
+    (void)hmi;
+    uint64_t now = hmi_time_ns();
+    pthread_mutex_lock(&replay_lock);
+    stats_rx((replay_stats_t*)user, frame->cmd, frame->data, frame->length, now);
+    pthread_mutex_unlock(&replay_lock);
+}
+
+static void print_row(const char *label, replay_stats_t *st) {
+    double seconds = st->frames > 1 ? (st->last_ns - st->first_ns) / 1e9 : 0;
+    qsort(st->rtt_us, st->rtt_count, sizeof(uint32_t), cmp_u32);
+    printf("%-6s %10llu %12llu %9.3f %10.0f %12.0f %8llu %6llu %8llu %9u %9u\n", label,
+           (unsigned long long)st->frames, (unsigned long long)st->bytes, seconds,
+           seconds > 0 ? st->frames / seconds : 0, seconds > 0 ? st->bytes / seconds : 0,
+           (unsigned long long)st->responses, (unsigned long long)(st->missing + st->pending_count),
+           (unsigned long long)st->events, rtt_percentile(st, 500), rtt_percentile(st, 990));
+}
+
+int main(int argc, char *argv[]) {
+    int fast = 0;
+    double speed = 1.0;
+    uint32_t bps = 0;
+    uint32_t sim_bps = 0;
+    int use_sim = 0;
+    const char *path = NULL;
+    const char *device = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0) {
+            fast = 1;
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            bps = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            sim_bps = strtoul(argv[++i], NULL, 10);
+            use_sim = 1;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            device = argv[i];
+        }
+    }
+    if (!path || (!device && !use_sim) || speed <= 0) {
+        printf("用法: %s [-f 盡快] [-s 倍速] [-b 波特率] [-S 模擬器波特率] 抓包文件 [設備]\n", argv[0]);
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("無法打開 %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    struct stat st_file;
+    if (fstat(fd, &st_file) < 0 || (size_t)st_file.st_size < sizeof(hmi_cap_header_t)) {
+        printf("%s 不是抓包文件\n", path);
+        close(fd);
+        return -1;
+    }
+    // 私有可寫映射：hmi_send_command 的參數不是 const
+    uint8_t *map = mmap(NULL, st_file.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        printf("無法映射 %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    hmi_cap_header_t header;
+    memcpy(&header, map, sizeof(header));
+    if (memcmp(header.magic, HMI_CAP_MAGIC, sizeof(header.magic)) != 0 || header.version != HMI_CAP_VERSION) {
+        printf("%s 不是抓包文件（或版本不符）\n", path);
+        munmap(map, st_file.st_size);
+        return -1;
+    }
+    header.device[sizeof(header.device) - 1] = '\0';
+    if (bps == 0) {
+        bps = header.bps;
+    }
+    int baud = hmi_bps_to_baud(bps);
+    if (baud < 0) {
+        printf("不支持的波特率 %u\n", bps);
+        munmap(map, st_file.st_size);
+        return -1;
+    }
+
+    // 原始記錄
+    static replay_stats_t recorded, replayed;
+    cap_reader_t reader = { map + sizeof(header), map + st_file.st_size, 0 };
+    hmi_cap_record_t rec;
+    const uint8_t *data;
+    while (cap_next(&reader, &rec, &data) == 0) {
+        if (rec.type == HMI_CAP_TX) {
+            stats_tx(&recorded, data, rec.length, reader.now);
+        } else if (rec.type == HMI_CAP_RX && rec.length >= 1) {
+            stats_rx(&recorded, data[0], data + 1, rec.length - 1, reader.now);
+        }
+    }
+    printf("抓包: %s，設備 %s，%u bps，%llu 幀\n", path, header.device, header.bps,
+           (unsigned long long)recorded.frames);
+
+    hmi_sim_t *sim = NULL;
+    if (use_sim) {
+        sim = hmi_sim_create(sim_bps);
+        if (!sim || hmi_sim_start(sim) < 0) {
+            printf("無法啟動模擬器\n");
+            munmap(map, st_file.st_size);
+            return -1;
+        }
+        device = hmi_sim_path(sim);
+    }
+
+    hmi_controller_t hmi;
+    if (hmi_init(&hmi, device, (baud_rate_t)baud) < 0) {
+        hmi_sim_destroy(sim);
+        munmap(map, st_file.st_size);
+        return -1;
+    }
+    uint8_t rx_cmds[] = {0x55, CMD_GET_VERSION, CMD_CONFIG_BASE};
+    for (size_t i = 0; i < sizeof(rx_cmds); i++) {
+        hmi_subscribe(&hmi, rx_cmds[i], -1, -1, -1, replay_event, &replayed);
+    }
+    hmi_rx_start(&hmi);
+
+    printf("重放到 %s（%s）...\n", device, fast ? "盡快" : "按記錄時間");
+    fflush(stdout);
+
+    // 按記錄時間發送時以第一幀為起點，speed 倍速
+    reader.pos = map + sizeof(header);
+    reader.now = 0;
+    uint64_t base_rec = 0, base_ns = 0;
+    uint64_t skipped = 0;
+    while (cap_next(&reader, &rec, &data) == 0) {
+        if (rec.type != HMI_CAP_TX) {
+            continue;
+        }
+        // 改波特率會讓主機與串口屏失去同步
+        if (rec.length > 2 && data[1] == CMD_SET_BAUDRATE) {
+            skipped++;
+            continue;
+        }
+        if (base_ns == 0) {
+            base_rec = reader.now;
+            base_ns = hmi_time_ns();
+        } else if (!fast) {
+            uint64_t target = base_ns + (uint64_t)((reader.now - base_rec) / speed);
+            struct timespec ts = { (time_t)(target / 1000000000ULL), (long)(target % 1000000000ULL) };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+
+        uint64_t now = hmi_time_ns();
+        pthread_mutex_lock(&replay_lock);
+        stats_tx(&replayed, data, rec.length, now);
+        pthread_mutex_unlock(&replay_lock);
+        if (hmi_send_command(&hmi, (uint8_t*)data, rec.length) < 0) {
+            printf("發送失敗，停止重放\n");
+            break;
+        }
+    }
+
+    // 等待最後的回應，最多一秒
+    uint64_t deadline = hmi_time_ns() + 1000000000ULL;
+    for (;;) {
+        pthread_mutex_lock(&replay_lock);
+        int waiting = replayed.pending_count;
+        pthread_mutex_unlock(&replay_lock);
+        if (waiting == 0 || hmi_time_ns() > deadline) {
+            break;
+        }
+        usleep(1000);
+    }
+    hmi_rx_stop(&hmi);
+
+    printf("\n%-6s %10s %12s %9s %10s %12s %8s %6s %8s %9s %9s\n", "", "幀", "字節", "秒",
+           "幀/s", "字節/s", "回應", "缺失", "其他接收", "往返p50", "往返p99");
+    print_row("記錄", &recorded);
+    print_row("重放", &replayed);
+    if (skipped) {
+        printf("跳過 %llu 個改波特率指令\n", (unsigned long long)skipped);
+    }
+    if (recorded.rtt_count && replayed.rtt_count) {
+        printf("往返時間變化: p50 %+d 微秒, p99 %+d 微秒\n",
+               (int)rtt_percentile(&replayed, 500) - (int)rtt_percentile(&recorded, 500),
+               (int)rtt_percentile(&replayed, 990) - (int)rtt_percentile(&recorded, 990));
+    }
+
+    hmi_close(&hmi);
+    hmi_sim_destroy(sim);
+    free(recorded.rtt_us);
+    free(replayed.rtt_us);
+    munmap(map, st_file.st_size);
+    return 0;
+}
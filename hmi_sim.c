@@ -0,0 +1,761 @@
+#include "hmi_sim.h"
+#include <poll.h>
+#include <sys/prctl.h>
+
+// ============================================================================
+// 串口屏模擬器
+// ============================================================================
+//
+// 模擬器持有偽終端的主端，從端路徑交給 hmi_init。支持的指令：
+//   - 握手 0x04 回覆 0x55，版本 0xFE 回覆 5.1
+//   - B1 00/01 切換和讀取畫面
+//   - B1 10 更新控件、B1 23 圖標幀，數值存入控件模型
+//   - B1 11 讀控件，按模型回覆 B1 11 screen control type 數據
+//   - B1 52~5C 記錄控件，導出時按發送緩衝區的空間逐行回覆
+//   - 0xA0 設置波特率，之後按新速率模擬
+// 其他指令只計數不回覆。
+//
+// 線路時間：每字節 10 位（8N1）。收發兩個方向各有一個線路時鐘，讀入的數據
+// 在其傳輸時間結束後才解析，回應在傳輸時間結束後才寫給主機端，所以往返
+// 延遲與真實串口一致。線路忙時不再讀取，主機端的數據積壓在偽終端緩衝區
+// （數 KB），緩衝區滿後 write 才會阻塞；吞吐量應以模擬器收到的幀數計算。
+
+#define SIM_MAX_CONTROLS  1024
+#define SIM_VALUE_MAX     256
+#define SIM_OUT_SIZE      65536
+#define SIM_MAX_RECORDS   16     // 記錄控件數
+
+// 未配置的控件按更新數據推斷類型
+#define SIM_TYPE_BUTTON   0x10
+#define SIM_TYPE_TEXT     0x11
+#define SIM_TYPE_PROGRESS 0x12
+#define SIM_TYPE_ICON     0x1A
+
+typedef struct {
+    uint32_t key;                // screen_id << 16 | control_id，0xFFFFFFFF 表示空
+    uint8_t type;
+    uint16_t length;
+    uint8_t value[SIM_VALUE_MAX];
+} sim_control_t;
+
+typedef struct {
+    uint32_t key;                // screen_id << 16 | control_id，capacity 為 0 表示空
+    uint32_t count;
+    uint32_t capacity;
+    char **rows;
+} sim_record_t;
+
+struct hmi_sim {
+    int master_fd;
+    char path[256];
+    uint32_t bps;
+    uint32_t event_rate;
+    uint32_t latency_us;
+    uint64_t next_event_ns;
+    uint32_t event_seq;
+    uint16_t screen;
+
+    uint64_t rx_done_ns;         // 已讀入數據傳輸完成的時刻
+    uint8_t rx_staged;           // 有已讀入但尚未解析的數據
+    uint64_t tx_done_ns;         // 正在發送的數據傳輸完成的時刻
+    uint32_t tx_sending;         // 正在發送的字節數（out 開頭）
+    hmi_parser_t parser;
+    uint8_t out[SIM_OUT_SIZE];
+    uint32_t out_head;
+    uint32_t out_len;
+
+    pthread_mutex_t lock;        // 保護控件模型和統計
+    sim_control_t controls[SIM_MAX_CONTROLS];
+    sim_record_t records[SIM_MAX_RECORDS];
+    hmi_sim_stats_t stats;
+
+    // 進行中的導出（只由模擬器線程訪問）
+    uint32_t export_key;
+    uint32_t export_next;
+    uint32_t export_end;
+    uint8_t exporting;
+
+    pthread_t thread;
+    int running;
+    int threaded;
+};
+
+static void queue_frame(hmi_sim_t *sim, uint8_t cmd, const uint8_t *data, uint16_t length);
+
+// ============================================================================
+// 控件模型
+// ============================================================================
+
+static sim_control_t *find_control(hmi_sim_t *sim, uint16_t screen_id, uint16_t control_id, int create) {
+    uint32_t key = ((uint32_t)screen_id << 16) | control_id;
+    uint32_t slot = (key * 2654435761u) % SIM_MAX_CONTROLS;
+
+    for (int i = 0; i < SIM_MAX_CONTROLS; i++) {
+        sim_control_t *c = &sim->controls[(slot + i) % SIM_MAX_CONTROLS];
+        if (c->key == key) {
+            return c;
+        }
+        if (c->key == 0xFFFFFFFF) {
+            if (!create) {
+                return NULL;
+            }
+            c->key = key;
+            c->type = 0;
+            c->length = 0;
+            return c;
+        }
+    }
+    return NULL;
+}
+
+int hmi_sim_set_control(hmi_sim_t *sim, uint16_t screen_id, uint16_t control_id, uint8_t type,
+                        const uint8_t *value, uint16_t length) {
+    if (length > SIM_VALUE_MAX) {
+        return -1;
+    }
+    pthread_mutex_lock(&sim->lock);
+    sim_control_t *c = find_control(sim, screen_id, control_id, 1);
+    if (c) {
+        c->type = type;
+        c->length = length;
+        memcpy(c->value, value, length);
+    }
+    pthread_mutex_unlock(&sim->lock);
+    return c ? 0 : -1;
+}
+
+int hmi_sim_get_control(hmi_sim_t *sim, uint16_t screen_id, uint16_t control_id, uint8_t *value,
+                        uint16_t *length) {
+    pthread_mutex_lock(&sim->lock);
+    sim_control_t *c = find_control(sim, screen_id, control_id, 0);
+    if (c) {
+        memcpy(value, c->value, c->length);
+        *length = c->length;
+    }
+    pthread_mutex_unlock(&sim->lock);
+    return c ? 0 : -1;
+}
+
+uint16_t hmi_sim_screen(hmi_sim_t *sim) {
+    return __atomic_load_n(&sim->screen, __ATOMIC_RELAXED);
+}
+
+void hmi_sim_get_stats(hmi_sim_t *sim, hmi_sim_stats_t *stats) {
+    pthread_mutex_lock(&sim->lock);
+    *stats = sim->stats;
+    stats->resyncs = sim->parser.resyncs;
+    pthread_mutex_unlock(&sim->lock);
+}
+
+void hmi_sim_set_event_rate(hmi_sim_t *sim, uint32_t per_second) {
+    __atomic_store_n(&sim->event_rate, per_second, __ATOMIC_RELAXED);
+}
+
+void hmi_sim_set_latency(hmi_sim_t *sim, uint32_t latency_us) {
+    __atomic_store_n(&sim->latency_us, latency_us, __ATOMIC_RELAXED);
+}
+
+// ============================================================================
+// 記錄控件模型
+// ============================================================================
+
+// 持鎖呼叫
+static sim_record_t *find_record(hmi_sim_t *sim, uint16_t screen_id, uint16_t control_id, int create) {
+    uint32_t key = ((uint32_t)screen_id << 16) | control_id;
+    sim_record_t *empty = NULL;
+    for (int i = 0; i < SIM_MAX_RECORDS; i++) {
+        if (sim->records[i].capacity > 0 && sim->records[i].key == key) {
+            return &sim->records[i];
+        }
+        if (!empty && sim->records[i].capacity == 0) {
+            empty = &sim->records[i];
+        }
+    }
+    if (!create || !empty) {
+        return NULL;
+    }
+    empty->rows = malloc(16 * sizeof(char*));
+    if (!empty->rows) {
+        return NULL;
+    }
+    empty->key = key;
+    empty->count = 0;
+    empty->capacity = 16;
+    return empty;
+}
+
+static int record_insert(sim_record_t *r, uint32_t index, const uint8_t *row, uint16_t length) {
+    if (r->count == r->capacity) {
+        char **rows = realloc(r->rows, r->capacity * 2 * sizeof(char*));
+        if (!rows) {
+            return -1;
+        }
+        r->rows = rows;
+        r->capacity *= 2;
+    }
+    char *copy = malloc(length + 1);
+    if (!copy) {
+        return -1;
+    }
+    memcpy(copy, row, length);
+    copy[length] = '\0';
+    if (index > r->count) {
+        index = r->count;
+    }
+    memmove(r->rows + index + 1, r->rows + index, (r->count - index) * sizeof(char*));
+    r->rows[index] = copy;
+    r->count++;
+    return 0;
+}
+
+int hmi_sim_record_count(hmi_sim_t *sim, uint16_t screen_id, uint16_t control_id) {
+    pthread_mutex_lock(&sim->lock);
+    sim_record_t *r = find_record(sim, screen_id, control_id, 0);
+    int count = r ? (int)r->count : 0;
+    pthread_mutex_unlock(&sim->lock);
+    return count;
+}
+
+// data: 子指令 screen_id(2) control_id(2) 參數...
+static void handle_record(hmi_sim_t *sim, const uint8_t *data, uint16_t length) {
+    if (length < 5) {
+        return;
+    }
+    uint16_t screen_id = (data[1] << 8) | data[2];
+    uint16_t control_id = (data[3] << 8) | data[4];
+    uint16_t index = length >= 7 ? (data[5] << 8) | data[6] : 0;
+
+    pthread_mutex_lock(&sim->lock);
+    sim_record_t *r = find_record(sim, screen_id, control_id, 1);
+    if (!r) {
+        pthread_mutex_unlock(&sim->lock);
+        return;
+    }
+    switch (data[0]) {
+        case CMD_RECORD_ADD:
+            record_insert(r, r->count, data + 5, length - 5);
+            break;
+        case CMD_RECORD_BATCH: {
+            // 5B screen(2) control(2) 行數(2) 行 00 行 00 ...
+            uint16_t pos = 7;
+            for (uint16_t i = 0; i < index && pos < length; i++) {
+                const uint8_t *end = memchr(data + pos, 0, length - pos);
+                uint16_t row_len = end ? (uint16_t)(end - data - pos) : length - pos;
+                record_insert(r, r->count, data + pos, row_len);
+                pos += row_len + 1;
+            }
+            break;
+        }
+        case CMD_RECORD_INSERT:
+            if (length >= 7) {
+                record_insert(r, index, data + 7, length - 7);
+            }
+            break;
+        case CMD_RECORD_MODIFY:
+            if (length >= 7 && index < r->count) {
+                char *copy = malloc(length - 7 + 1);
+                if (copy) {
+                    memcpy(copy, data + 7, length - 7);
+                    copy[length - 7] = '\0';
+                    free(r->rows[index]);
+                    r->rows[index] = copy;
+                }
+            }
+            break;
+        case CMD_RECORD_DELETE:
+            if (length >= 7 && index < r->count) {
+                free(r->rows[index]);
+                memmove(r->rows + index, r->rows + index + 1, (r->count - index - 1) * sizeof(char*));
+                r->count--;
+            }
+            break;
+        case CMD_RECORD_CLEAR:
+            for (uint32_t i = 0; i < r->count; i++) {
+                free(r->rows[i]);
+            }
+            r->count = 0;
+            break;
+        case CMD_RECORD_COUNT: {
+            uint8_t reply[7];
+            memcpy(reply, data, 5);
+            reply[5] = r->count >> 8;
+            reply[6] = r->count & 0xFF;
+            queue_frame(sim, CMD_CONFIG_BASE, reply, sizeof(reply));
+            break;
+        }
+        case CMD_RECORD_READ:
+            if (length >= 7) {
+                uint8_t reply[HMI_FRAME_MAX];
+                uint16_t row_len = index < r->count ? strlen(r->rows[index]) : 0;
+                row_len = row_len < HMI_FRAME_MAX - 13 ? row_len : HMI_FRAME_MAX - 13;
+                memcpy(reply, data, 7);
+                if (row_len > 0) {
+                    memcpy(reply + 7, r->rows[index], row_len);
+                }
+                queue_frame(sim, CMD_CONFIG_BASE, reply, 7 + row_len);
+            }
+            break;
+        case CMD_RECORD_EXPORT:
+            if (length >= 9) {
+                uint32_t count = (data[7] << 8) | data[8];
+                sim->export_key = ((uint32_t)screen_id << 16) | control_id;
+                sim->export_next = index;
+                sim->export_end = index + count;
+                sim->exporting = 1;
+            }
+            break;
+        default:
+            break;
+    }
+    pthread_mutex_unlock(&sim->lock);
+}
+
+// 發送緩衝區有空間時繼續導出，送完後回覆結束標記
+static void pump_export(hmi_sim_t *sim) {
+    uint8_t reply[HMI_FRAME_MAX];
+    reply[0] = CMD_RECORD_EXPORT;
+    reply[1] = sim->export_key >> 24;
+    reply[2] = (sim->export_key >> 16) & 0xFF;
+    reply[3] = (sim->export_key >> 8) & 0xFF;
+    reply[4] = sim->export_key & 0xFF;
+
+    pthread_mutex_lock(&sim->lock);
+    sim_record_t *r = find_record(sim, sim->export_key >> 16, sim->export_key & 0xFFFF, 0);
+    uint32_t end = r && r->count < sim->export_end ? r->count : r ? sim->export_end : 0;
+    while (sim->export_next < end && sim->out_len + HMI_FRAME_MAX < SIM_OUT_SIZE / 2) {
+        uint16_t row_len = strlen(r->rows[sim->export_next]);
+        row_len = row_len < HMI_FRAME_MAX - 13 ? row_len : HMI_FRAME_MAX - 13;
+        reply[5] = sim->export_next >> 8;
+        reply[6] = sim->export_next & 0xFF;
+        memcpy(reply + 7, r->rows[sim->export_next], row_len);
+        queue_frame(sim, CMD_CONFIG_BASE, reply, 7 + row_len);
+        sim->export_next++;
+    }
+    if (sim->export_next >= end) {
+        reply[5] = HMI_RECORD_END >> 8;
+        reply[6] = HMI_RECORD_END & 0xFF;
+        queue_frame(sim, CMD_CONFIG_BASE, reply, 7);
+        sim->exporting = 0;
+    }
+    pthread_mutex_unlock(&sim->lock);
+}
+
+// ============================================================================
+// 線路速率
+// ============================================================================
+
+static uint64_t wire_ns(hmi_sim_t *sim, uint32_t bytes) {
+    return sim->bps ? (uint64_t)bytes * 10 * 1000000000ULL / sim->bps : 0;
+}
+
+// 每次最多處理約 1ms 的數據（至少 16 字節，相當於 UART FIFO），幀的完成時刻誤差在 1ms 內
+static uint32_t wire_chunk(hmi_sim_t *sim) {
+    uint32_t chunk = sim->bps / 10 / 1000;
+    return sim->bps == 0 ? SIM_OUT_SIZE : chunk < 16 ? 16 : chunk;
+}
+
+// ============================================================================
+// 回應和事件
+// ============================================================================
+
+static void queue_frame(hmi_sim_t *sim, uint8_t cmd, const uint8_t *data, uint16_t length) {
+    uint16_t frame_len = length + 6;
+    if (sim->out_len + frame_len > SIM_OUT_SIZE) {
+        return; // 主機端長時間不讀取，丟棄
+    }
+    if (sim->out_head + sim->out_len + frame_len > SIM_OUT_SIZE) {
+        memmove(sim->out, sim->out + sim->out_head, sim->out_len);
+        sim->out_head = 0;
+    }
+
+    uint8_t *p = sim->out + sim->out_head + sim->out_len;
+    p[0] = FRAME_HEADER;
+    p[1] = cmd;
+    memcpy(p + 2, data, length);
+    uint8_t tail[] = FRAME_TAIL;
+    memcpy(p + 2 + length, tail, FRAME_TAIL_SIZE);
+    sim->out_len += frame_len;
+}
+
+static void reply_read_control(hmi_sim_t *sim, const uint8_t *data, uint16_t length) {
+    if (length < 5) {
+        return;
+    }
+    uint16_t screen_id = (data[1] << 8) | data[2];
+    uint16_t control_id = (data[3] << 8) | data[4];
+    uint8_t reply[6 + SIM_VALUE_MAX];
+    memcpy(reply, data, 5);
+
+    pthread_mutex_lock(&sim->lock);
+    sim_control_t *c = find_control(sim, screen_id, control_id, 0);
+    uint16_t value_len = c ? c->length : 0;
+    reply[5] = c ? c->type : SIM_TYPE_TEXT;
+    if (c) {
+        memcpy(reply + 6, c->value, value_len);
+    }
+    pthread_mutex_unlock(&sim->lock);
+
+    queue_frame(sim, CMD_CONFIG_BASE, reply, 6 + value_len);
+}
+
+// 由持鎖的呼叫者更新一個控件的數值
+static void store_value(hmi_sim_t *sim, uint16_t screen_id, uint16_t control_id, const uint8_t *value,
+                        uint16_t value_len, uint8_t default_type) {
+    if (value_len > SIM_VALUE_MAX) {
+        return;
+    }
+    sim_control_t *c = find_control(sim, screen_id, control_id, 1);
+    if (c) {
+        if (c->type == 0) {
+            c->type = default_type ? default_type :
+                      value_len == 1 ? SIM_TYPE_BUTTON :
+                      value_len == 4 ? SIM_TYPE_PROGRESS : SIM_TYPE_TEXT;
+        }
+        c->length = value_len;
+        memcpy(c->value, value, value_len);
+        sim->stats.updates++;
+    }
+}
+
+static void store_control(hmi_sim_t *sim, const uint8_t *data, uint16_t length, uint8_t default_type) {
+    if (length < 5) {
+        return;
+    }
+    pthread_mutex_lock(&sim->lock);
+    store_value(sim, (data[1] << 8) | data[2], (data[3] << 8) | data[4], data + 5, length - 5, default_type);
+    pthread_mutex_unlock(&sim->lock);
+}
+
+// 批量更新: 12 screen(2) { control(2) 長度(2) 數據 }...
+static void store_batch(hmi_sim_t *sim, const uint8_t *data, uint16_t length) {
+    if (length < 3) {
+        return;
+    }
+    uint16_t screen_id = (data[1] << 8) | data[2];
+    uint16_t pos = 3;
+
+    pthread_mutex_lock(&sim->lock);
+    while (pos + 4 <= length) {
+        uint16_t control_id = (data[pos] << 8) | data[pos + 1];
+        uint16_t value_len = (data[pos + 2] << 8) | data[pos + 3];
+        pos += 4;
+        if (pos + value_len > length) {
+            break;
+        }
+        store_value(sim, screen_id, control_id, data + pos, value_len, 0);
+        pos += value_len;
+    }
+    pthread_mutex_unlock(&sim->lock);
+}
+
+static void set_bps(hmi_sim_t *sim, uint8_t code) {
+    uint32_t bps = hmi_baud_to_bps(code);
+    if (sim->bps != 0 && bps != 0) {
+        sim->bps = bps;
+    }
+}
+
+static void handle_frame(hmi_sim_t *sim, const hmi_response_t *frame) {
+    static const uint8_t version[] = {5, 1, 0, 1, 0, 0};
+    const uint8_t *data = frame->data;
+    uint16_t length = frame->length;
+    int replied = 1;
+
+    switch (frame->cmd) {
+        case CMD_HANDSHAKE:
+            queue_frame(sim, 0x55, NULL, 0);
+            break;
+        case CMD_GET_VERSION:
+            queue_frame(sim, CMD_GET_VERSION, version, sizeof(version));
+            break;
+        case CMD_SET_BAUDRATE:
+            if (length >= 1) {
+                set_bps(sim, data[0]);
+            }
+            replied = 0;
+            break;
+        case CMD_CONFIG_BASE:
+            replied = 0;
+            if (length < 1) {
+                break;
+            }
+            switch (data[0]) {
+                case CMD_SWITCH_SCREEN:
+                    if (length >= 3) {
+                        __atomic_store_n(&sim->screen, (data[1] << 8) | data[2], __ATOMIC_RELAXED);
+                    }
+                    break;
+                case CMD_READ_SCREEN: {
+                    uint16_t screen = hmi_sim_screen(sim);
+                    uint8_t reply[3] = {CMD_READ_SCREEN, screen >> 8, screen & 0xFF};
+                    queue_frame(sim, CMD_CONFIG_BASE, reply, sizeof(reply));
+                    replied = 1;
+                    break;
+                }
+                case CMD_UPDATE_CONTROL:
+                    store_control(sim, data, length, 0);
+                    break;
+                case CMD_BATCH_UPDATE:
+                    store_batch(sim, data, length);
+                    break;
+                case CMD_ANIM_FRAME:
+                    store_control(sim, data, length, SIM_TYPE_ICON);
+                    break;
+                case CMD_READ_CONTROL:
+                    reply_read_control(sim, data, length);
+                    replied = 1;
+                    break;
+                case CMD_RECORD_ADD:
+                case CMD_RECORD_CLEAR:
+                case CMD_RECORD_BATCH:
+                case CMD_RECORD_INSERT:
+                case CMD_RECORD_MODIFY:
+                case CMD_RECORD_DELETE:
+                    handle_record(sim, data, length);
+                    break;
+                case CMD_RECORD_COUNT:
+                case CMD_RECORD_READ:
+                case CMD_RECORD_EXPORT:
+                    handle_record(sim, data, length);
+                    replied = 1;
+                    break;
+                case CMD_CURVE_ADD_DATA:
+                case CMD_CURVE_INSERT:
+                    // 32 screen_id(2) control_id(2) channel(1) count(2) 數據...
+                    if (length >= 8 && ((data[6] << 8) | data[7]) == length - 8) {
+                        pthread_mutex_lock(&sim->lock);
+                        sim->stats.curve_points += length - 8;
+                        pthread_mutex_unlock(&sim->lock);
+                    }
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case CMD_AREA_IMAGE:
+            // 32 x(2) y(2) width(2) height(2) RGB565 像素...
+            if (length >= 8 && ((data[4] << 8) | data[5]) * ((data[6] << 8) | data[7]) * 2 == length - 8) {
+                pthread_mutex_lock(&sim->lock);
+                sim->stats.image_pixels += (length - 8) / 2;
+                pthread_mutex_unlock(&sim->lock);
+            }
+            replied = 0;
+            break;
+        default:
+            // 繪圖、背光等指令（0x01~0x9F）只接收不回覆
+            if (frame->cmd > 0x9F) {
+                pthread_mutex_lock(&sim->lock);
+                sim->stats.unknown++;
+                pthread_mutex_unlock(&sim->lock);
+            }
+            replied = 0;
+            break;
+    }
+
+    pthread_mutex_lock(&sim->lock);
+    sim->stats.frames_rx++;
+    if (replied) {
+        sim->stats.replies++;
+    }
+    pthread_mutex_unlock(&sim->lock);
+}
+
+// 輪流上報觸摸按下、觸摸釋放和按鈕控件事件
+static void inject_event(hmi_sim_t *sim) {
+    uint32_t seq = sim->event_seq++;
+    uint16_t x = (seq * 37) % 800;
+    uint16_t y = (seq * 53) % 480;
+    uint8_t touch[4] = {x >> 8, x & 0xFF, y >> 8, y & 0xFF};
+
+    switch (seq % 3) {
+        case 0:
+            queue_frame(sim, 0x01, touch, sizeof(touch));
+            break;
+        case 1:
+            queue_frame(sim, 0x03, touch, sizeof(touch));
+            break;
+        default: {
+            uint16_t screen = hmi_sim_screen(sim);
+            uint8_t event[8] = {CMD_READ_CONTROL, screen >> 8, screen & 0xFF, 0, 1, SIM_TYPE_BUTTON, 0x01,
+                                seq & 1};
+            queue_frame(sim, CMD_CONFIG_BASE, event, sizeof(event));
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&sim->lock);
+    sim->stats.events++;
+    pthread_mutex_unlock(&sim->lock);
+}
+
+// ============================================================================
+// 主循環
+// ============================================================================
+
+hmi_sim_t *hmi_sim_create(uint32_t bps) {
+    hmi_sim_t *sim = calloc(1, sizeof(hmi_sim_t));
+    if (!sim) {
+        return NULL;
+    }
+
+    sim->master_fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (sim->master_fd < 0 || grantpt(sim->master_fd) < 0 || unlockpt(sim->master_fd) < 0) {
+        printf("無法創建偽終端: %s\n", strerror(errno));
+        if (sim->master_fd >= 0) {
+            close(sim->master_fd);
+        }
+        free(sim);
+        return NULL;
+    }
+    strncpy(sim->path, ptsname(sim->master_fd), sizeof(sim->path) - 1);
+
+    for (int i = 0; i < SIM_MAX_CONTROLS; i++) {
+        sim->controls[i].key = 0xFFFFFFFF;
+    }
+    sim->bps = bps;
+    sim->running = 1;
+    pthread_mutex_init(&sim->lock, NULL);
+    return sim;
+}
+
+void hmi_sim_destroy(hmi_sim_t *sim) {
+    if (!sim) {
+        return;
+    }
+    hmi_sim_stop(sim);
+    close(sim->master_fd);
+    for (int i = 0; i < SIM_MAX_RECORDS; i++) {
+        for (uint32_t r = 0; r < sim->records[i].count; r++) {
+            free(sim->records[i].rows[r]);
+        }
+        free(sim->records[i].rows);
+    }
+    pthread_mutex_destroy(&sim->lock);
+    free(sim);
+}
+
+const char *hmi_sim_path(hmi_sim_t *sim) {
+    return sim->path;
+}
+
+int hmi_sim_run(hmi_sim_t *sim) {
+    // 默認 50us 的定時器餘量在 2Mbaud 下相當於 10 個字節
+    prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+
+    while (__atomic_load_n(&sim->running, __ATOMIC_ACQUIRE)) {
+        uint64_t now = hmi_time_ns();
+        uint64_t wake = now + 50000000ULL; // 定期檢查停止標誌
+
+        // 主動上報事件
+        uint32_t rate = __atomic_load_n(&sim->event_rate, __ATOMIC_RELAXED);
+        if (rate > 0) {
+            if (sim->next_event_ns == 0 || now >= sim->next_event_ns) {
+                inject_event(sim);
+                sim->next_event_ns = (sim->next_event_ns ? sim->next_event_ns : now) + 1000000000ULL / rate;
+            }
+            if (sim->next_event_ns < wake) {
+                wake = sim->next_event_ns;
+            }
+        } else {
+            sim->next_event_ns = 0;
+        }
+
+        if (sim->exporting) {
+            pump_export(sim);
+        }
+
+        // 發送方向：傳輸時間結束後才交給主機端
+        if (sim->tx_sending > 0 && now >= sim->tx_done_ns) {
+            ssize_t written = write(sim->master_fd, sim->out + sim->out_head, sim->tx_sending);
+            if (written > 0) {
+                sim->out_head += written;
+                sim->out_len -= written;
+                sim->tx_sending -= written;
+                pthread_mutex_lock(&sim->lock);
+                sim->stats.bytes_tx += written;
+                pthread_mutex_unlock(&sim->lock);
+            }
+            if (sim->out_len == 0) {
+                sim->out_head = 0;
+            }
+        }
+        if (sim->tx_sending == 0 && sim->out_len > 0) {
+            uint32_t chunk = wire_chunk(sim);
+            sim->tx_sending = sim->out_len < chunk ? sim->out_len : chunk;
+            sim->tx_done_ns = now + wire_ns(sim, sim->tx_sending);
+        }
+        if (sim->tx_sending > 0 && sim->tx_done_ns < wake) {
+            wake = sim->tx_done_ns;
+        }
+
+        // 接收方向：數據傳輸完成後才解析，之後才繼續讀取
+        if (sim->rx_staged && now >= sim->rx_done_ns) {
+            sim->rx_staged = 0;
+            hmi_response_t frame;
+            while (hmi_parser_next(&sim->parser, &frame) == 0) {
+                handle_frame(sim, &frame);
+            }
+            continue; // 可能有新的回應需要發送
+        }
+        if (sim->rx_staged && sim->rx_done_ns < wake) {
+            wake = sim->rx_done_ns;
+        }
+
+        struct pollfd pfd = { .fd = sim->master_fd, .events = sim->rx_staged ? 0 : POLLIN };
+        uint64_t wait = wake > now ? wake - now : 0;
+        struct timespec ts = { .tv_sec = wait / 1000000000ULL, .tv_nsec = wait % 1000000000ULL };
+        int ret = ppoll(&pfd, 1, &ts, NULL);
+        if (ret < 0 && errno != EINTR) {
+            printf("模擬器: poll 失敗: %s\n", strerror(errno));
+            return -1;
+        }
+        if (ret <= 0 || !(pfd.revents & POLLIN)) {
+            if (pfd.revents & POLLHUP) {
+                usleep(10000); // 從端尚未打開或已關閉
+            }
+            continue;
+        }
+
+        uint16_t space;
+        uint8_t *dst = hmi_parser_space(&sim->parser, &space);
+        uint32_t chunk = wire_chunk(sim);
+        ssize_t n = read(sim->master_fd, dst, space < chunk ? space : chunk);
+        if (n <= 0) {
+            continue;
+        }
+        hmi_parser_commit(&sim->parser, n);
+        pthread_mutex_lock(&sim->lock);
+        sim->stats.bytes_rx += n;
+        pthread_mutex_unlock(&sim->lock);
+
+        // 線路空閒時數據從現在開始傳輸，否則接在上一段之後；處理延遲加在傳輸完成之後
+        now = hmi_time_ns();
+        uint64_t start = sim->rx_done_ns > now ? sim->rx_done_ns : now;
+        sim->rx_done_ns = start + wire_ns(sim, n) +
+                          (uint64_t)__atomic_load_n(&sim->latency_us, __ATOMIC_RELAXED) * 1000;
+        sim->rx_staged = 1;
+    }
+    return 0;
+}
+
+static void *sim_thread(void *arg) {
+    hmi_sim_run((hmi_sim_t*)arg);
+    return NULL;
+}
+
+int hmi_sim_start(hmi_sim_t *sim) {
+    if (pthread_create(&sim->thread, NULL, sim_thread, sim) != 0) {
+        sim->running = 0;
+        return -1;
+    }
+    sim->threaded = 1;
+    return 0;
+}
+
+void hmi_sim_stop(hmi_sim_t *sim) {
+    __atomic_store_n(&sim->running, 0, __ATOMIC_RELEASE);
+    if (sim->threaded) {
+        pthread_join(sim->thread, NULL);
+        sim->threaded = 0;
+    }
+}
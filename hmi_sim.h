@@ -0,0 +1,51 @@
+#ifndef HMI_SIM_H
+#define HMI_SIM_H
+
+// 串口屏模擬器：以偽終端(PTY)模擬 V5.1 指令集的串口屏
+// hmi_init 直接打開 hmi_sim_path 返回的設備即可，不需要實際硬件
+
+#include "dc_hmi_controller.h"
+
+typedef struct hmi_sim hmi_sim_t;
+
+// 模擬器統計
+typedef struct {
+    uint64_t frames_rx;          // 收到的幀數
+    uint64_t bytes_rx;
+    uint64_t bytes_tx;
+    uint64_t replies;            // 回應幀數
+    uint64_t events;             // 主動上報的事件數
+    uint64_t unknown;            // 不支持的指令數
+    uint64_t updates;            // 控件數值更新數（批量更新按控件計）
+    uint64_t curve_points;       // 曲線數據點數
+    uint64_t image_pixels;       // 區域圖片收到的像素數
+    uint32_t resyncs;            // 接收時重新同步次數
+} hmi_sim_stats_t;
+
+// bps 為模擬的線路速率，0 表示不限速
+hmi_sim_t *hmi_sim_create(uint32_t bps);
+void hmi_sim_destroy(hmi_sim_t *sim);
+const char *hmi_sim_path(hmi_sim_t *sim);
+
+// 在後台線程運行，或由呼叫線程運行直到 hmi_sim_stop
+int hmi_sim_start(hmi_sim_t *sim);
+int hmi_sim_run(hmi_sim_t *sim);
+void hmi_sim_stop(hmi_sim_t *sim);
+
+// 每秒主動上報的觸摸/控件事件數，0 表示不上報
+void hmi_sim_set_event_rate(hmi_sim_t *sim, uint32_t per_second);
+
+// 處理延遲：每次讀入的數據在傳輸完成後再等 latency_us 才解析和回應
+void hmi_sim_set_latency(hmi_sim_t *sim, uint32_t latency_us);
+
+// 控件模型：type 為讀控件回應中的控件類型
+int hmi_sim_set_control(hmi_sim_t *sim, uint16_t screen_id, uint16_t control_id, uint8_t type,
+                        const uint8_t *value, uint16_t length);
+int hmi_sim_get_control(hmi_sim_t *sim, uint16_t screen_id, uint16_t control_id, uint8_t *value,
+                        uint16_t *length);
+uint16_t hmi_sim_screen(hmi_sim_t *sim);
+int hmi_sim_record_count(hmi_sim_t *sim, uint16_t screen_id, uint16_t control_id);   // 記錄控件的行數
+
+void hmi_sim_get_stats(hmi_sim_t *sim, hmi_sim_stats_t *stats);
+
+#endif // HMI_SIM_H
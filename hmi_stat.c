@@ -0,0 +1,136 @@
+#include "dc_hmi_controller.h"
+#include <sys/mman.h>
+
+// 串口屏運行統計查看程式
+// 用法: hmi_stat [-i 間隔秒數] [-c 次數] 共享內存名稱
+// 被觀察的進程需先呼叫 hmi_stats_export(&hmi, "/hmi0")，然後：
+//   ./hmi_stat /hmi0
+// 每個間隔輸出一行該間隔內的速率和延遲（微秒，直方圖格上限）
+
+static uint64_t sum_frames(const hmi_cmd_stats_t *cmds, uint64_t *bytes) {
+    uint64_t frames = 0;
+    *bytes = 0;
+    for (int i = 0; i < 256; i++) {
+        frames += cmds[i].frames;
+        *bytes += cmds[i].bytes;
+    }
+    return frames;
+}
+
+static void hist_delta(uint64_t *out, const uint64_t *now, const uint64_t *prev) {
+    for (int i = 0; i < HMI_HIST_BUCKETS; i++) {
+        out[i] = now[i] - prev[i];
+    }
+}
+
+// 累計發送最多的指令
+static void print_top_commands(const hmi_stats_t *st) {
+    printf("累計發送（按指令）:\n");
+    for (int i = 0; i < 256; i++) {
+        if (i != CMD_CONFIG_BASE && st->tx[i].frames) {
+            printf("  %02X    %12llu 幀 %14llu 字節\n", i,
+                   (unsigned long long)st->tx[i].frames, (unsigned long long)st->tx[i].bytes);
+        }
+    }
+    for (int i = 0; i < 256; i++) {
+        if (st->tx_config[i].frames) {
+            printf("  B1 %02X %12llu 幀 %14llu 字節\n", i,
+                   (unsigned long long)st->tx_config[i].frames, (unsigned long long)st->tx_config[i].bytes);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    double interval = 1.0;
+    int count = 0;
+    const char *name = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            interval = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        } else {
+            name = argv[i];
+        }
+    }
+    if (!name || interval <= 0) {
+        printf("用法: %s [-i 間隔秒數] [-c 次數] 共享內存名稱（如 /hmi0）\n", argv[0]);
+        return -1;
+    }
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        printf("無法打開共享內存 %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    const hmi_stats_t *shared = mmap(NULL, sizeof(hmi_stats_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shared == MAP_FAILED) {
+        printf("無法映射共享內存: %s\n", strerror(errno));
+        return -1;
+    }
+    if (__atomic_load_n(&shared->magic, __ATOMIC_ACQUIRE) != HMI_STATS_MAGIC ||
+        shared->version != HMI_STATS_VERSION) {
+        printf("%s 不是串口屏統計（或版本不符）\n", name);
+        return -1;
+    }
+
+    static hmi_stats_t prev, now;
+    uint64_t hist[HMI_HIST_BUCKETS];
+    hmi_stats_copy(&prev, shared);
+    uint64_t prev_ns = hmi_time_ns();
+
+    printf("%-8s %9s %11s %9s %6s %6s %6s %7s %9s %9s %9s %9s %15s %15s\n",
+           "時間(s)", "發送幀/s", "發送字節/s", "接收幀/s", "超時", "重同步", "丟棄", "事件",
+           "佇列", "佇列峰值", "省略寫/s", "合併/s", "寫入p50/p99", "往返p50/p99");
+
+    for (int n = 0; count == 0 || n < count; n++) {
+        usleep((useconds_t)(interval * 1e6));
+
+        // 進程結束時共享內存已刪除
+        char path[128];
+        snprintf(path, sizeof(path), "/dev/shm%s", name);
+        if (access(path, F_OK) < 0) {
+            printf("%s 已關閉\n", name);
+            break;
+        }
+
+        hmi_stats_copy(&now, shared);
+        uint64_t now_ns = hmi_time_ns();
+        double seconds = (now_ns - prev_ns) / 1e9;
+
+        uint64_t tx_bytes, prev_tx_bytes, rx_bytes, prev_rx_bytes;
+        uint64_t tx_frames = sum_frames(now.tx, &tx_bytes) - sum_frames(prev.tx, &prev_tx_bytes);
+        uint64_t rx_frames = sum_frames(now.rx, &rx_bytes) - sum_frames(prev.rx, &prev_rx_bytes);
+
+        hist_delta(hist, now.write_hist, prev.write_hist);
+        uint32_t write_p50 = hmi_hist_percentile_us(hist, 500);
+        uint32_t write_p99 = hmi_hist_percentile_us(hist, 990);
+        hist_delta(hist, now.rtt_hist, prev.rtt_hist);
+        uint32_t rtt_p50 = hmi_hist_percentile_us(hist, 500);
+        uint32_t rtt_p99 = hmi_hist_percentile_us(hist, 990);
+
+        char write_lat[32], rtt_lat[32];
+        snprintf(write_lat, sizeof(write_lat), "%u/%u", write_p50, write_p99);
+        snprintf(rtt_lat, sizeof(rtt_lat), "%u/%u", rtt_p50, rtt_p99);
+        printf("%-8.1f %9.0f %11.0f %9.0f %6llu %6llu %6llu %7llu %9llu %9llu %9.0f %9.0f %15s %15s\n",
+               (now_ns - now.start_ns) / 1e9, tx_frames / seconds, (tx_bytes - prev_tx_bytes) / seconds,
+               rx_frames / seconds,
+               (unsigned long long)(now.timeouts - prev.timeouts),
+               (unsigned long long)(now.resyncs - prev.resyncs),
+               (unsigned long long)(now.dropped_bytes - prev.dropped_bytes),
+               (unsigned long long)(now.events - prev.events),
+               (unsigned long long)now.queue_depth, (unsigned long long)now.queue_peak,
+               (now.shadow_suppressed - prev.shadow_suppressed) / seconds,
+               (now.coalesced - prev.coalesced) / seconds, write_lat, rtt_lat);
+        fflush(stdout);
+
+        prev = now;
+        prev_ns = now_ns;
+    }
+
+    print_top_commands(&prev);
+    munmap((void*)shared, sizeof(hmi_stats_t));
+    return 0;
+}